@@ -8,7 +8,29 @@ static void sighandler(int signo)
 
 int main()
 {
+    olc::net::dispatcher<CustomMsgTypes> dispatch;
+    dispatch.on<CustomMsgTypes::ServerAccept>([](auto, auto& msg)
+    {
+        //Server has accepted our connection
+        std::cout<<"Server Accepted Connection\n";
+    });
+    dispatch.on<CustomMsgTypes::ServerPing>([](auto, auto& msg)
+    {
+        std::chrono::system_clock::time_point timeNow=std::chrono::system_clock::now();
+        std::chrono::system_clock::time_point timeThen;
+        msg>>timeThen;
+        std::cout<<"Ping: "<<std::chrono::duration<double>(timeNow-timeThen).count()<<"\n";
+    });
+    dispatch.on<CustomMsgTypes::ServerMessage>([](auto, auto& msg)
+    {
+        //Another client has said hello to everyone
+        uint32_t clientID;
+        msg>>clientID;
+        std::cout<<"Hello from ["<<clientID<<"]\n";
+    });
+
     CustomClient c;
+    c.SetMessageFilter(dispatch.filter());
     c.Connect("127.0.0.1",60000);
 
     //bool key[3]={false,false,false};
@@ -42,34 +64,8 @@ int main()
         {
             if(!c.Incoming().empty())
             {
-                auto msg=c.Incoming().pop_front().msg;
-
-                switch (msg.header.id)
-                {
-                    case CustomMsgTypes::ServerAccept:
-                    {
-                        //Server has responded to a ping request
-                        std::cout<<"Server Accepted Connection\n";
-                    }
-                    break;
-                    case CustomMsgTypes::ServerPing:
-                    {
-                        std::chrono::system_clock::time_point timeNow=std::chrono::system_clock::now();
-                        std::chrono::system_clock::time_point timeThen;
-                        msg>>timeThen;
-                        std::cout<<"Ping: "<<std::chrono::duration<double>(timeNow-timeThen).count()<<"\n";
-                    }
-                    break;
-
-                    case CustomMsgTypes::ServerMessage:
-                    {
-                        //Server has responded to a ping request
-                        uint32_t clientID;
-                        msg>>clientID;
-                        std::cout<<"Hello from ["<<clientID<<"]\n";
-                    }
-                    break;
-                }
+                auto msg=c.Incoming().pop_front();
+                dispatch(msg.remote,msg.msg);
             }
         }
         else
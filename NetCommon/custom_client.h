@@ -10,6 +10,13 @@ enum class CustomMsgTypes : uint32_t
 	ServerMessage,
 };
 
+//pings, accepts and client IDs are a few bytes each, keep them off the heap
+template <>
+struct olc::net::message_body<CustomMsgTypes>
+{
+    using type = olc::net::small_body<64>;
+};
+
 class CustomClient : public olc::net::client_interface<CustomMsgTypes>
 {
     public:
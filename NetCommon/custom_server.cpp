@@ -1,6 +1,31 @@
 #include "custom_server.h"
 
-CustomServer::CustomServer(uint16_t nPort) : olc::net::server_interface<CustomMsgTypes>(nPort){};
+CustomServer::CustomServer(uint16_t nPort) : olc::net::server_interface<CustomMsgTypes>(nPort){
+
+    m_dispatch.on<CustomMsgTypes::ServerPing>([](auto client, auto& msg){
+
+        std::cout << "[" << client -> GetID() << "]: Server Ping\n";
+
+        //simply bounce the message back to client
+        client -> Send(msg);
+    });
+
+    m_dispatch.on<CustomMsgTypes::MessageAll>([this](auto client, auto& msg){
+
+        std::cout << "[" << client -> GetID() << "]: Message All\n";
+        olc::net::message<CustomMsgTypes> msgOut;
+        msgOut.header.id = CustomMsgTypes::ServerMessage;
+        //put in the body the client id that sent the request in the first place
+        msgOut << client -> GetID();   //GetID() is const, so the type of 2nd paramter in "<<" overload should be so
+
+        //specifying the message but also tells it to explicitly ignore the client that 
+        // -- sent the message in the first place
+        MessageAllClients(msgOut, client);     //function from server interface
+    });
+
+    //clients have no business sending anything else, so don't even read it
+    SetMessageFilter(m_dispatch.filter());
+}
 
 bool CustomServer::OnClientConnect(std::shared_ptr<olc::net::connection<CustomMsgTypes>> client){
 
@@ -21,30 +46,5 @@ bool CustomServer::OnClientDisconnect(std::shared_ptr<olc::net::connection<Custo
 
 void CustomServer::OnMessage(std::shared_ptr<olc::net::connection<CustomMsgTypes>> client, olc::net::message<CustomMsgTypes>& msg){
 
-    switch(msg.header.id){
-
-                case CustomMsgTypes::ServerPing:{
-                    
-                    std::cout << "[" << client -> GetID() << "]: Server Ping\n";
-
-                    //simply bounce the message back to client
-                    client -> Send(msg);
-
-                }
-                break;
-
-                case CustomMsgTypes::MessageAll:{
-
-                    std::cout << "[" << client -> GetID() << "]: Message All\n";
-                    olc::net::message<CustomMsgTypes> msg;
-                    msg.header.id = CustomMsgTypes::ServerMessage;
-                    //put in the body the client id that sent the request in the first place
-                    msg << client -> GetID();   //GetID() is const, so the type of 2nd paramter in "<<" overload should be so
-                    
-                    //specifying the message but also tells it to explicitly ignore the client that 
-                    // -- sent the message in the first place
-                    MessageAllClients(msg, client);     //function from server interface
-                }
-                break;
-            }
+    m_dispatch(client, msg);
 }
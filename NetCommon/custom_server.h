@@ -10,6 +10,13 @@ enum class CustomMsgTypes : uint32_t{   //defining custom message types
     ServerMessage
 };
 
+//pings, accepts and client IDs are a few bytes each, keep them off the heap
+template <>
+struct olc::net::message_body<CustomMsgTypes>
+{
+    using type = olc::net::small_body<64>;
+};
+
 class CustomServer : public olc::net::server_interface<CustomMsgTypes>{
 
     public:
@@ -23,4 +30,8 @@ class CustomServer : public olc::net::server_interface<CustomMsgTypes>{
 
         //called when a message arrives
         virtual void OnMessage(std::shared_ptr<olc::net::connection<CustomMsgTypes>> client, olc::net::message<CustomMsgTypes>& msg);
+
+    private:
+        //one handler per message type, anything else is dropped as it arrives
+        olc::net::dispatcher<CustomMsgTypes> m_dispatch;
 };
\ No newline at end of file
@@ -0,0 +1,1407 @@
+#include "olc_net.h"
+#include <future>
+#include <random>
+#include <unordered_set>
+
+using namespace std::chrono_literals;
+
+// Benchmarks for the networking framework. Run all of them with no arguments,
+// or name the ones you want, e.g. "./executeBenchmarks transport"
+
+// Heap allocations made by threads that opted in through tl_bCountAllocations,
+// counted by the replacement operator new below so a benchmark can tell what one
+// side of a connection allocates
+static std::atomic<uint64_t> g_nAllocations{0};
+static thread_local bool tl_bCountAllocations = false;
+static std::atomic<bool> g_bCountAllThreads{false};    //or simply every thread
+
+void* operator new(size_t nBytes)
+{
+    if(tl_bCountAllocations || g_bCountAllThreads.load(std::memory_order_relaxed))
+        g_nAllocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(nBytes ? nBytes : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+enum class BenchMsgTypes : uint32_t
+{
+    Ready,
+    Ping,
+    Data,
+    DataAck,
+};
+
+// The same ping protocol with a body type that keeps up to 64 bytes inline
+enum class SmallBenchMsgTypes : uint32_t
+{
+    Ready,
+    Ping,
+};
+
+template <>
+struct olc::net::message_body<SmallBenchMsgTypes>
+{
+    using type = olc::net::small_body<64>;
+};
+
+class BenchServer : public olc::net::server_interface<BenchMsgTypes>
+{
+    public:
+        BenchServer(uint16_t nPort) : olc::net::server_interface<BenchMsgTypes>(nPort){}
+        BenchServer(const std::string& sPath) : olc::net::server_interface<BenchMsgTypes>(sPath){}
+
+        // Runs Update() on its own thread until Halt() is called
+        void Run()
+        {
+            m_threadUpdate = std::thread([this]()
+            {
+                while(m_bRunning)
+                    Update(-1, true);
+            });
+        }
+
+        void Halt(olc::net::client_interface<BenchMsgTypes>& wake)
+        {
+            m_bRunning = false;
+
+            // Update() may be asleep on the incoming queue, give it something to chew on
+            olc::net::message<BenchMsgTypes> msg;
+            msg.header.id = BenchMsgTypes::Ping;
+            wake.Send(msg);
+
+            if(m_threadUpdate.joinable())
+                m_threadUpdate.join();
+            Stop();
+        }
+
+        void Expect(size_t nMessages)
+        {
+            m_nExpected = nMessages;
+            m_nReceived = 0;
+        }
+
+    protected:
+        bool OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) override
+        {
+            return true;
+        }
+
+        void OnClientValidated(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) override
+        {
+            olc::net::message<BenchMsgTypes> msg;
+            msg.header.id = BenchMsgTypes::Ready;
+            client->Send(msg);
+        }
+
+        void OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client, olc::net::message<BenchMsgTypes>& msg) override
+        {
+            switch(msg.header.id)
+            {
+                case BenchMsgTypes::Ping:
+                    client->Send(msg);
+                    break;
+
+                case BenchMsgTypes::Data:
+                    if(++m_nReceived == m_nExpected)
+                    {
+                        olc::net::message<BenchMsgTypes> ack;
+                        ack.header.id = BenchMsgTypes::DataAck;
+                        client->Send(ack);
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+    private:
+        std::thread m_threadUpdate;
+        std::atomic<bool> m_bRunning{true};
+        size_t m_nExpected = 0;
+        size_t m_nReceived = 0;
+};
+
+class BenchClient : public olc::net::client_interface<BenchMsgTypes>
+{
+    public:
+        // Blocks until a message arrives from the server
+        olc::net::message<BenchMsgTypes> Receive()
+        {
+            Incoming().wait();
+            return Incoming().pop_front().msg;
+        }
+};
+
+// --- helpers:
+
+struct latency_report
+{
+    double p50, p90, p99, p999, max;
+};
+
+static latency_report Percentiles(std::vector<double> vSamples)
+{
+    std::sort(vSamples.begin(), vSamples.end());
+    auto at = [&](double q){ return vSamples[std::min(vSamples.size() - 1, size_t(q * vSamples.size()))]; };
+    return { at(0.50), at(0.90), at(0.99), at(0.999), vSamples.back() };
+}
+
+static void PrintLatency(const std::string& sName, const latency_report& r)
+{
+    std::printf("  %-22s p50 %8.1fus  p90 %8.1fus  p99 %8.1fus  p99.9 %8.1fus  max %8.1fus\n",
+        sName.c_str(), r.p50, r.p90, r.p99, r.p999, r.max);
+}
+
+// Round trip latency of a ping carrying nPayload bytes
+static std::vector<double> MeasureRoundTrips(BenchClient& client, size_t nRounds, size_t nPayload)
+{
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::Ping;
+    msg.body.resize(nPayload);
+    msg.header.size = msg.size();
+
+    std::vector<double> vSamples;
+    vSamples.reserve(nRounds);
+    for(size_t i = 0; i < nRounds; i++)
+    {
+        auto tStart = std::chrono::steady_clock::now();
+        client.Send(msg);
+        client.Receive();
+        vSamples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tStart).count());
+    }
+    return vSamples;
+}
+
+// One way throughput, returns messages per second
+static double MeasureThroughput(BenchServer& server, BenchClient& client, size_t nMessages, size_t nPayload)
+{
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::Data;
+    msg.body.resize(nPayload);
+    msg.header.size = msg.size();
+
+    server.Expect(nMessages);
+    auto tStart = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < nMessages; i++)
+        client.Send(msg);
+    client.Receive();
+    return nMessages / std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+// --- benchmarks:
+
+/*
+    @brief Transport comparison
+    Same framing, handshake and callbacks over TCP loopback, an AF_UNIX socket and
+    the shared memory rings
+*/
+static void BenchTransport()
+{
+    std::printf("transport: TCP loopback vs local socket vs shared memory\n");
+
+    auto run = [](const std::string& sName, BenchServer& server, auto connect)
+    {
+        server.Start();
+        server.Run();
+
+        BenchClient client;
+        connect(client);
+        client.Receive();   //Ready
+
+        MeasureRoundTrips(client, 1000, 16);    //warm up
+        PrintLatency(sName + " rtt 16B", Percentiles(MeasureRoundTrips(client, 20000, 16)));
+
+        for(size_t nPayload : {64, 4096})
+        {
+            double dRate = MeasureThroughput(server, client, 100000, nPayload);
+            std::printf("  %-22s %10.0f msg/s  %8.1f MB/s\n", (sName + " " + std::to_string(nPayload) + "B").c_str(),
+                dRate, dRate * nPayload / 1e6);
+        }
+
+        server.Halt(client);
+    };
+
+    {
+        BenchServer server(uint16_t(60100));
+        run("tcp", server, [](BenchClient& c){ c.Connect("127.0.0.1", 60100); });
+    }
+    {
+        BenchServer server(std::string("/tmp/olc_net_bench.sock"));
+        run("local", server, [](BenchClient& c){ c.ConnectLocal("/tmp/olc_net_bench.sock"); });
+    }
+    {
+        BenchServer server(std::string("/tmp/olc_net_bench.sock"));
+        run("shm", server, [](BenchClient& c){ c.ConnectSharedMemory("/tmp/olc_net_bench.sock"); });
+    }
+}
+
+/*
+    @brief Socket I/O modes
+    One read/write per header and per body against batched reads out of the receive
+    pool and gathered writes. Operations are counted by the connections themselves,
+    each one is a recv/send (or readv/writev) system call when data is ready
+*/
+static void BenchIO()
+{
+    std::printf("io: per-frame vs batched socket I/O (TCP loopback)\n");
+
+    for(bool bBatched : {false, true})
+    {
+        BenchServer server(uint16_t(60101));
+        server.SetBatchedIO(bBatched);
+        server.Start();
+        server.Run();
+
+        BenchClient client;
+        client.SetBatchedIO(bBatched);
+        client.Connect("127.0.0.1", 60101);
+        client.Receive();   //Ready
+
+        for(size_t nPayload : {16, 256})
+        {
+            auto before = client.m_connection->GetIOStats();
+            auto beforeServer = server.m_deqConnections.back()->GetIOStats();
+
+            const size_t nMessages = 200000;
+            double dRate = MeasureThroughput(server, client, nMessages, nPayload);
+
+            auto after = client.m_connection->GetIOStats();
+            auto afterServer = server.m_deqConnections.back()->GetIOStats();
+            std::printf("  %-8s %4zuB %10.0f msg/s  client writes/msg %5.3f  server reads/msg %5.3f\n",
+                bBatched ? "batched" : "frame", nPayload, dRate,
+                double(after.nWrites - before.nWrites) / nMessages,
+                double(afterServer.nReads - beforeServer.nReads) / nMessages);
+        }
+
+        server.Halt(client);
+    }
+}
+
+/*
+    @brief Dispatch modes
+    Closed loop ping-pong. Queued: the server's Update() thread and the benchmark
+    thread pick messages off the incoming queues. Inline: OnMessage runs on the asio
+    threads and the client fires the next ping straight from its handler
+*/
+class InlineBenchClient : public BenchClient
+{
+    public:
+        // Ping-pong nRounds times from the asio thread, timing each round trip
+        std::vector<double> Run(size_t nRounds)
+        {
+            m_nRounds = nRounds;
+            m_vSamples.clear();
+            m_vSamples.reserve(nRounds);
+            m_done = std::promise<void>();
+            auto future = m_done.get_future();
+
+            Ping();
+            future.wait();
+            return m_vSamples;
+        }
+
+    protected:
+        void OnMessage(olc::net::message<BenchMsgTypes>& msg) override
+        {
+            if(msg.header.id != BenchMsgTypes::Ping || m_nRounds == 0)
+                return;
+
+            m_vSamples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_tStart).count());
+            if(m_vSamples.size() == m_nRounds)
+                m_done.set_value();
+            else
+                Ping();
+        }
+
+    private:
+        void Ping()
+        {
+            olc::net::message<BenchMsgTypes> msg;
+            msg.header.id = BenchMsgTypes::Ping;
+            msg.body.resize(16);
+            msg.header.size = msg.size();
+
+            m_tStart = std::chrono::steady_clock::now();
+            Send(msg);
+        }
+
+        size_t m_nRounds = 0;
+        std::vector<double> m_vSamples;
+        std::promise<void> m_done;
+        std::chrono::steady_clock::time_point m_tStart;
+};
+
+static void BenchDispatch()
+{
+    std::printf("dispatch: queued vs inline OnMessage\n");
+
+    {
+        BenchServer server(uint16_t(60103));
+        server.Start();
+        server.Run();
+
+        BenchClient client;
+        client.Connect("127.0.0.1", 60103);
+        client.Receive();   //Ready
+
+        MeasureRoundTrips(client, 1000, 16);
+        PrintLatency("tcp queued rtt 16B", Percentiles(MeasureRoundTrips(client, 20000, 16)));
+        server.Halt(client);
+    }
+
+    for(bool bSharedMemory : {false, true})
+    {
+        BenchServer server(std::string("/tmp/olc_net_bench.sock"));
+        server.SetInlineDispatch(true);
+        server.Start();
+
+        InlineBenchClient client;
+        client.SetInlineDispatch(true);
+        if(bSharedMemory)
+            client.ConnectSharedMemory("/tmp/olc_net_bench.sock");
+        else
+            client.ConnectLocal("/tmp/olc_net_bench.sock");
+        std::this_thread::sleep_for(200ms);
+
+        client.Run(1000);
+        PrintLatency(bSharedMemory ? "shm inline rtt 16B" : "local inline rtt 16B", Percentiles(client.Run(20000)));
+        client.Disconnect();
+        server.Stop();
+    }
+
+    {
+        BenchServer server(uint16_t(60103));
+        server.SetInlineDispatch(true);
+        server.Start();
+
+        InlineBenchClient client;
+        client.SetInlineDispatch(true);
+        client.Connect("127.0.0.1", 60103);
+        std::this_thread::sleep_for(200ms);
+
+        client.Run(1000);
+        PrintLatency("tcp inline rtt 16B", Percentiles(client.Run(20000)));
+        client.Disconnect();
+        server.Stop();
+    }
+}
+
+/*
+    @brief Message serialization
+    Building and reading back a typical record (a dozen scalar fields) and a bulk
+    array of 256 floats, with operator<< / operator>> against message_writer /
+    message_reader. No networking involved
+*/
+static void BenchSerialize()
+{
+    std::printf("serialize: operator<< / >> vs message_writer / message_reader\n");
+
+    const size_t nIterations = 1000000;
+    std::vector<float> vSamples(256, 1.5f);
+    uint64_t nSink = 0;
+
+    auto time = [](const char* sName, size_t nCount, auto fn)
+    {
+        auto tStart = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < nCount; i++)
+            fn(i);
+        double dNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tStart).count() / nCount;
+        std::printf("  %-30s %8.1f ns/msg\n", sName, dNs);
+    };
+
+    time("record operators", nIterations, [&](size_t i)
+    {
+        olc::net::message<BenchMsgTypes> msg;
+        for(uint32_t n = 0; n < 6; n++)
+            msg << uint32_t(i + n) << float(n);
+
+        uint32_t a; float b;
+        for(uint32_t n = 0; n < 6; n++)
+        {
+            msg >> b >> a;
+            nSink += a;
+        }
+    });
+
+    time("record writer/reader", nIterations, [&](size_t i)
+    {
+        olc::net::message<BenchMsgTypes> msg;
+        olc::net::message_writer<BenchMsgTypes> writer(msg);
+        writer.reserve(6 * (sizeof(uint32_t) + sizeof(float)));
+        for(uint32_t n = 0; n < 6; n++)
+            writer << uint32_t(i + n) << float(n);
+
+        olc::net::message_reader<BenchMsgTypes> reader(msg);
+        uint32_t a; float b;
+        for(uint32_t n = 0; n < 6; n++)
+        {
+            reader >> a >> b;
+            nSink += a;
+        }
+    });
+
+    time("256 floats operators", nIterations / 10, [&](size_t i)
+    {
+        olc::net::message<BenchMsgTypes> msg;
+        for(float f : vSamples)
+            msg << f;
+
+        float f;
+        for(size_t n = 0; n < vSamples.size(); n++)
+            msg >> f;
+        nSink += uint64_t(f);
+    });
+
+    time("256 floats writer/reader", nIterations / 10, [&](size_t i)
+    {
+        olc::net::message<BenchMsgTypes> msg;
+        olc::net::message_writer<BenchMsgTypes>(msg).write(vSamples);
+
+        std::vector<float> vOut;
+        olc::net::message_reader<BenchMsgTypes>(msg).read(vOut);
+        nSink += uint64_t(vOut.back());
+    });
+
+    std::printf("  (checksum %llu)\n", (unsigned long long)nSink);
+}
+
+/*
+    @brief Message views
+    One way stream of Data messages handled on the server through the incoming queue,
+    inline as a message (OnMessage) or inline as a view over the receive buffer
+    (OnMessageView). The handler reads one field. Allocations are those made by the
+    server's threads per message
+*/
+class ViewBenchServer : public olc::net::server_interface<BenchMsgTypes>
+{
+    public:
+        ViewBenchServer(uint16_t nPort) : olc::net::server_interface<BenchMsgTypes>(nPort){}
+
+        void Expect(size_t nMessages)
+        {
+            m_nExpected = nMessages;
+            m_nReceived = 0;
+        }
+
+        // Count allocations on the asio thread from now on
+        void CountAllocations()
+        {
+            boost::asio::post(m_asioContext, [](){ tl_bCountAllocations = true; });
+        }
+
+        double AllocationsPerMessage() const
+        {
+            return double(m_nAllocationsEnd - m_nAllocationsStart) / (m_nExpected - 1);
+        }
+
+    protected:
+        bool OnClientConnect(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) override
+        {
+            return true;
+        }
+
+        void OnClientValidated(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client) override
+        {
+            olc::net::message<BenchMsgTypes> msg;
+            msg.header.id = BenchMsgTypes::Ready;
+            client->Send(msg);
+        }
+
+        void OnMessage(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client, olc::net::message<BenchMsgTypes>& msg) override
+        {
+            if(msg.header.id != BenchMsgTypes::Data)
+                return;
+
+            uint64_t nValue;
+            std::memcpy(&nValue, msg.body.data(), sizeof(nValue));
+            Count(client, nValue);
+        }
+
+        void OnMessageView(std::shared_ptr<olc::net::connection<BenchMsgTypes>> client, olc::net::message_view<BenchMsgTypes>& view) override
+        {
+            if(m_bViews && view.header.id == BenchMsgTypes::Data)
+                Count(client, view.get<uint64_t>(0));
+            else
+                olc::net::server_interface<BenchMsgTypes>::OnMessageView(client, view);
+        }
+
+    public:
+        bool m_bViews = false;
+
+    private:
+        void Count(std::shared_ptr<olc::net::connection<BenchMsgTypes>>& client, uint64_t nValue)
+        {
+            m_nSum += nValue;
+            if(++m_nReceived == 1)
+                m_nAllocationsStart = g_nAllocations;
+
+            if(m_nReceived == m_nExpected)
+            {
+                m_nAllocationsEnd = g_nAllocations;
+                olc::net::message<BenchMsgTypes> ack;
+                ack.header.id = BenchMsgTypes::DataAck;
+                client->Send(ack);
+            }
+        }
+
+        size_t m_nExpected = 0;
+        size_t m_nReceived = 0;
+        uint64_t m_nSum = 0;
+        uint64_t m_nAllocationsStart = 0;
+        uint64_t m_nAllocationsEnd = 0;
+};
+
+static void BenchViews()
+{
+    std::printf("views: queued vs inline OnMessage vs OnMessageView (TCP loopback)\n");
+
+    enum class mode { queued, inline_message, view };
+    for(bool bBatched : {false, true})
+    {
+        for(mode m : {mode::queued, mode::inline_message, mode::view})
+        {
+            ViewBenchServer server(uint16_t(60104));
+            server.SetBatchedIO(bBatched);
+            if(m == mode::view)
+            {
+                server.SetViewDispatch(true);
+                server.m_bViews = true;
+            }
+            else if(m == mode::inline_message)
+            {
+                server.SetInlineDispatch(true);
+            }
+            server.Start();
+            server.CountAllocations();
+
+            //queued messages are handled here
+            std::atomic<bool> bUpdating{m == mode::queued};
+            std::thread threadUpdate([&]()
+            {
+                tl_bCountAllocations = true;
+                while(bUpdating)
+                    server.Update(-1, true);
+            });
+
+            BenchClient client;
+            client.Connect("127.0.0.1", 60104);
+            client.Receive();   //Ready
+
+            olc::net::message<BenchMsgTypes> msg;
+            msg.header.id = BenchMsgTypes::Data;
+            msg.body.resize(256);
+            msg.header.size = msg.size();
+
+            const size_t nMessages = 200000;
+            server.Expect(nMessages);
+            auto tStart = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < nMessages; i++)
+                client.Send(msg);
+            client.Receive();
+            double dRate = nMessages / std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+            const char* sMode = m == mode::queued ? "queued" : m == mode::view ? "view" : "inline";
+            std::printf("  %-8s %-8s 256B %10.0f msg/s  server allocations/msg %5.3f\n",
+                bBatched ? "batched" : "frame", sMode, dRate, server.AllocationsPerMessage());
+
+            bUpdating = false;
+            olc::net::message<BenchMsgTypes> wake;
+            wake.header.id = BenchMsgTypes::Ping;
+            client.Send(wake);
+            threadUpdate.join();
+
+            client.Disconnect();
+            server.Stop();
+        }
+    }
+}
+
+/*
+    @brief Message body storage
+    Heap allocations per ServerPing style round trip (client Send, server queue,
+    Update() bouncing it back, client queue) with the default std::vector body and
+    with small_body<64>, counted across every thread in the process
+*/
+template <typename T>
+class EchoServer : public olc::net::server_interface<T>
+{
+    public:
+        EchoServer(uint16_t nPort) : olc::net::server_interface<T>(nPort){}
+
+    protected:
+        bool OnClientConnect(std::shared_ptr<olc::net::connection<T>> client) override
+        {
+            return true;
+        }
+
+        void OnClientValidated(std::shared_ptr<olc::net::connection<T>> client) override
+        {
+            olc::net::message<T> msg;
+            msg.header.id = T::Ready;
+            client->Send(msg);
+        }
+
+        void OnMessage(std::shared_ptr<olc::net::connection<T>> client, olc::net::message<T>& msg) override
+        {
+            client->Send(msg);
+        }
+};
+
+template <typename T>
+static void MeasureBodyAllocations(const char* sName)
+{
+    EchoServer<T> server(60105);
+    server.Start();
+    std::atomic<bool> bUpdating{true};
+    std::thread threadUpdate([&]()
+    {
+        while(bUpdating)
+            server.Update(-1, true);
+    });
+
+    olc::net::client_interface<T> client;
+    client.Connect("127.0.0.1", 60105);
+    client.Incoming().wait();
+    client.Incoming().pop_front();  //Ready
+
+    auto roundTrip = [&]()
+    {
+        //a timestamp, like the demo client's ping
+        olc::net::message<T> msg;
+        msg.header.id = T::Ping;
+        msg << std::chrono::system_clock::now();
+        client.Send(msg);
+        client.Incoming().wait();
+        client.Incoming().pop_front();
+    };
+
+    for(size_t i = 0; i < 1000; i++)
+        roundTrip();
+
+    const size_t nRounds = 20000;
+    uint64_t nBefore = g_nAllocations;
+    g_bCountAllThreads = true;
+    auto tStart = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < nRounds; i++)
+        roundTrip();
+    double dUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tStart).count() / nRounds;
+    g_bCountAllThreads = false;
+
+    std::printf("  %-16s %6.2f allocations/round trip  %6.1fus/round trip\n", sName, double(g_nAllocations - nBefore) / nRounds, dUs);
+
+    bUpdating = false;
+    olc::net::message<T> wake;
+    wake.header.id = T::Ping;
+    client.Send(wake);
+    threadUpdate.join();
+    client.Disconnect();
+    server.Stop();
+}
+
+static void BenchBody()
+{
+    std::printf("body: std::vector vs small_body<64> message bodies (TCP loopback)\n");
+    MeasureBodyAllocations<BenchMsgTypes>("std::vector");
+    MeasureBodyAllocations<SmallBenchMsgTypes>("small_body<64>");
+}
+
+/*
+    @brief Frame checksums
+    CRC32C throughput with the crc32 instruction and with the portable tables, then
+    batched one way throughput over TCP loopback with and without the trailer
+*/
+static void BenchChecksum()
+{
+    std::printf("checksum: CRC32C hardware vs portable, frames with and without trailers\n");
+
+    std::vector<uint8_t> vData(1 << 20);
+    for(size_t i = 0; i < vData.size(); i++)
+        vData[i] = uint8_t(i * 31);
+    uint32_t nSink = 0;
+
+    for(size_t nBlock : {64, 1024, 65536})
+    {
+        auto time = [&](const char* sName, auto fn)
+        {
+            const size_t nTotal = size_t(1) << 30;
+            auto tStart = std::chrono::steady_clock::now();
+            for(size_t nDone = 0; nDone < nTotal; nDone += nBlock)
+                nSink += fn(vData.data() + nDone % vData.size(), nBlock);
+            double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+            std::printf("  %-10s %6zuB blocks %8.2f GB/s\n", sName, nBlock, nTotal / dSeconds / 1e9);
+        };
+
+        if(olc::net::detail::crc32c_hardware())
+            time("sse4.2", [](const uint8_t* p, size_t n){ return olc::net::crc32c(p, n); });
+        time("portable", [](const uint8_t* p, size_t n){ return ~olc::net::detail::crc32c_portable(p, n, ~0u); });
+    }
+
+    for(bool bChecksums : {false, true})
+    {
+        BenchServer server(uint16_t(60106));
+        server.SetBatchedIO(true);
+        server.Start();
+        server.Run();
+
+        BenchClient client;
+        client.SetBatchedIO(true);
+        client.SetFrameChecksums(bChecksums);
+        client.Connect("127.0.0.1", 60106);
+        client.Receive();   //Ready
+
+        for(size_t nPayload : {64, 4096})
+        {
+            double dRate = MeasureThroughput(server, client, 200000, nPayload);
+            std::printf("  %-10s %6zuB %10.0f msg/s  %8.1f MB/s\n", bChecksums ? "crc32c" : "none",
+                nPayload, dRate, dRate * nPayload / 1e6);
+        }
+
+        server.Halt(client);
+    }
+
+    if(nSink == 1)
+        std::printf("\n");
+}
+
+#if defined(OLC_NET_TLS)
+/*
+    @brief TLS transport
+    Connections per second up to a validated client with no TLS, a full TLS handshake
+    and a resumed one, then batched one way throughput with no TLS, TLS in OpenSSL and
+    TLS offloaded to the kernel
+*/
+static void BenchTls()
+{
+    std::printf("tls: handshake rate and bulk throughput, plain vs TLS vs kTLS (TCP loopback)\n");
+
+    const std::string sCerts = NET_CERTS_DIR;
+    auto pServerTls = olc::net::tls_context::CreateServer(sCerts + "/server.pem", sCerts + "/server.key");
+
+    for(int nMode : {0, 1, 2})
+    {
+        const char* aNames[] = { "plain", "tls full", "tls resumed" };
+        auto pClientTls = olc::net::tls_context::CreateClient(sCerts + "/ca.pem", "localhost");
+
+        BenchServer server(uint16_t(60107));
+        if(nMode > 0)
+            server.SetTls(pServerTls);
+        server.Start();
+        server.Run();
+
+        const size_t nConnections = 300;
+        size_t nResumed = 0;
+        auto tStart = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < nConnections; i++)
+        {
+            if(nMode == 1)
+                pClientTls->ForgetSession();
+
+            BenchClient client;
+            if(nMode > 0)
+                client.SetTls(pClientTls);
+            client.Connect("127.0.0.1", 60107);
+            client.Receive();   //Ready
+            nResumed += client.m_connection->IsTlsResumed();
+        }
+        double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        std::printf("  %-12s %8.0f connections/s  %8.1f us each  resumed %zu/%zu\n", aNames[nMode],
+            nConnections / dSeconds, dSeconds * 1e6 / nConnections, nResumed, nConnections);
+
+        BenchClient client;
+        if(nMode > 0)
+            client.SetTls(pClientTls);
+        client.Connect("127.0.0.1", 60107);
+        client.Receive();
+        server.Halt(client);
+    }
+
+    for(int nMode : {0, 1, 2})
+    {
+        const char* aNames[] = { "plain", "tls", "ktls" };
+        if(nMode == 2 && !olc::net::KernelTlsAvailable())
+        {
+            std::printf("  %-12s unavailable, the kernel has no TLS support\n", aNames[nMode]);
+            continue;
+        }
+
+        auto pServerBulk = olc::net::tls_context::CreateServer(sCerts + "/server.pem", sCerts + "/server.key");
+        auto pClientBulk = olc::net::tls_context::CreateClient(sCerts + "/ca.pem", "localhost");
+        pServerBulk->SetKernelOffload(nMode == 2);
+        pClientBulk->SetKernelOffload(nMode == 2);
+
+        BenchServer server(uint16_t(60107));
+        server.SetBatchedIO(true);
+        if(nMode > 0)
+            server.SetTls(pServerBulk);
+        server.Start();
+        server.Run();
+
+        BenchClient client;
+        client.SetBatchedIO(true);
+        if(nMode > 0)
+            client.SetTls(pClientBulk);
+        client.Connect("127.0.0.1", 60107);
+        client.Receive();   //Ready
+
+        for(size_t nPayload : {64, 4096})
+        {
+            double dRate = MeasureThroughput(server, client, 200000, nPayload);
+            std::printf("  %-12s %6zuB %10.0f msg/s  %8.1f MB/s\n", aNames[nMode],
+                nPayload, dRate, dRate * nPayload / 1e6);
+        }
+
+        server.Halt(client);
+    }
+}
+#endif
+
+/*
+    @brief Priority lanes
+    A ping sent right behind a 16MB snapshot of 64 bulk messages. In one queue the
+    ping waits for the whole snapshot, in the control lane only for the message
+    being written and what is already in the socket buffers
+*/
+static void BenchPriority()
+{
+    std::printf("priority: ping latency behind a 16MB snapshot, one queue vs lanes (TCP loopback)\n");
+
+    for(bool bLanes : {false, true})
+    {
+        BenchServer server(uint16_t(60109));
+        server.Start();
+        server.Run();
+
+        BenchClient client;
+        client.Connect("127.0.0.1", 60109);
+        client.Receive();   //Ready
+
+        olc::net::message<BenchMsgTypes> bulk;
+        bulk.header.id = BenchMsgTypes::Data;
+        bulk.body.resize(256 * 1024);
+        bulk.header.size = bulk.size();
+
+        olc::net::message<BenchMsgTypes> ping;
+        ping.header.id = BenchMsgTypes::Ping;
+
+        std::vector<double> vPing, vSnapshot;
+        for(size_t i = 0; i < 50; i++)
+        {
+            server.Expect(64);
+            auto tStart = std::chrono::steady_clock::now();
+            for(size_t j = 0; j < 64; j++)
+                client.Send(bulk, bLanes ? olc::net::send_priority::bulk : olc::net::send_priority::interactive);
+            client.Send(ping, bLanes ? olc::net::send_priority::control : olc::net::send_priority::interactive);
+
+            //the ping echo and the ack for the snapshot, in either order
+            for(size_t nReplies = 0; nReplies < 2; nReplies++)
+            {
+                auto msg = client.Receive();
+                double dElapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tStart).count();
+                (msg.header.id == BenchMsgTypes::Ping ? vPing : vSnapshot).push_back(dElapsed);
+            }
+        }
+        PrintLatency(bLanes ? "control lane ping" : "single queue ping", Percentiles(vPing));
+        PrintLatency(bLanes ? "bulk lane snapshot" : "single queue snapshot", Percentiles(vSnapshot));
+
+        server.Halt(client);
+    }
+}
+
+/*
+    @brief Connection storm
+    Thousands of clients connect at once from several threads and stay quiet, the
+    clock stops when the server has accepted them all. Compares one outstanding
+    accept taking one connection per io loop iteration against batched draining of
+    the listen queue and several outstanding accepts
+*/
+static void BenchStorm()
+{
+    std::printf("storm: connections accepted per second, 4000 simultaneous clients (TCP loopback)\n");
+
+    struct accept_config { size_t nOutstanding; size_t nBatch; };
+    for(auto config : { accept_config{1, 1}, accept_config{1, 16}, accept_config{4, 64} })
+    {
+        //every connection logs, keep that out of the results
+        std::streambuf* pLog = std::cout.rdbuf(nullptr);
+
+        BenchServer server(uint16_t(60108));
+        server.SetAcceptConcurrency(config.nOutstanding, config.nBatch);
+        server.SetHandshakeLimits(30s, 0);
+        server.Start();
+
+        const size_t nThreads = 4, nClients = 4000;
+        boost::asio::io_context context;
+        std::vector<std::vector<boost::asio::ip::tcp::socket>> vSockets(nThreads);
+        std::vector<std::thread> vThreads;
+        std::atomic<size_t> nFailed{0};
+
+        auto endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 60108);
+        auto tStart = std::chrono::steady_clock::now();
+        for(size_t t = 0; t < nThreads; t++)
+            vThreads.emplace_back([&, t]()
+            {
+                for(size_t i = 0; i < nClients / nThreads; i++)
+                {
+                    vSockets[t].emplace_back(context);
+                    boost::system::error_code ec;
+                    vSockets[t].back().connect(endpoint, ec);
+                    nFailed += bool(ec);
+                }
+            });
+
+        //accepted clients sit in the pending state, they never answer validation
+        auto tLimit = tStart + 10s;
+        while(server.GetHandshakeStats().nPending + nFailed < nClients && std::chrono::steady_clock::now() < tLimit)
+            std::this_thread::yield();
+        double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+        size_t nAccepted = server.GetHandshakeStats().nPending;
+
+        for(auto& thread : vThreads)
+            thread.join();
+        vSockets.clear();
+        server.Stop();
+        std::cout.rdbuf(pLog);
+
+        std::printf("  accepts %zu batch %-3zu %8.0f connections/s  %7.1fms for %zu  failed %zu\n",
+            config.nOutstanding, config.nBatch, nAccepted / dSeconds, dSeconds * 1000, nAccepted, size_t(nFailed));
+    }
+}
+
+/*
+    @brief Topics
+    Finding a topic's subscribers among 10k clients and 100k topics with the
+    topic index, against checking every client's subscriptions as a filtered
+    broadcast would. Then fan-out of a 4KB message to 100 subscribers over TCP,
+    one copy per client against one shared copy
+*/
+static void BenchTopics()
+{
+    std::printf("topics: subscriber lookup, 10k clients and 100k topics, then fan-out to 100 clients (TCP loopback)\n");
+
+    const size_t nClients = 10000, nTopics = 100000;
+    auto topic = [](size_t n){ return "t/" + std::to_string(n); };
+
+    //ten topics per client, and one client in a hundred also follows a prefix
+    std::mt19937 rng(7);
+    olc::net::topic_index<uint32_t> topics;
+    std::vector<std::unordered_set<std::string>> vExact(nClients);
+    std::vector<std::vector<std::string>> vPrefixes(nClients);
+    for(uint32_t i = 0; i < nClients; i++)
+    {
+        for(size_t j = 0; j < 10; j++)
+        {
+            std::string sTopic = topic(rng() % nTopics);
+            topics.subscribe(i, sTopic);
+            vExact[i].insert(sTopic);
+        }
+        if(i % 100 == 0)
+        {
+            std::string sPrefix = topic(rng() % 100);
+            topics.subscribe(i, sPrefix + "*");
+            vPrefixes[i].push_back(sPrefix);
+        }
+    }
+
+    std::vector<std::string> vPublish;
+    for(size_t i = 0; i < 100000; i++)
+        vPublish.push_back(topic(rng() % nTopics));
+
+    size_t nFound = 0;
+    auto tStart = std::chrono::steady_clock::now();
+    for(auto& sTopic : vPublish)
+        nFound += topics.for_each(sTopic, [](uint32_t){});
+    double dIndexUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tStart).count() / vPublish.size();
+    std::printf("  topic index      %9.2fus/publish  %5.2f subscribers/publish\n", dIndexUs, double(nFound) / vPublish.size());
+
+    const size_t nScans = 200;
+    nFound = 0;
+    tStart = std::chrono::steady_clock::now();
+    for(size_t n = 0; n < nScans; n++)
+    {
+        const std::string& sTopic = vPublish[n];
+        for(size_t i = 0; i < nClients; i++)
+        {
+            bool bWants = vExact[i].count(sTopic) > 0;
+            for(auto& sPrefix : vPrefixes[i])
+                bWants |= sTopic.compare(0, sPrefix.size(), sPrefix) == 0;
+            nFound += bWants;
+        }
+    }
+    double dScanUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tStart).count() / nScans;
+    std::printf("  scan all clients %9.2fus/publish  %5.2f subscribers/publish\n", dScanUs, double(nFound) / nScans);
+
+    //every connection logs, keep that out of the results
+    std::streambuf* pLog = std::cout.rdbuf(nullptr);
+    EchoServer<BenchMsgTypes> server(60110);
+    server.Start();
+    std::vector<std::unique_ptr<BenchClient>> vSubscribers;
+    for(size_t i = 0; i < 100; i++)
+    {
+        vSubscribers.push_back(std::make_unique<BenchClient>());
+        vSubscribers.back()->Connect("127.0.0.1", 60110);
+        vSubscribers.back()->Receive();     //Ready
+        vSubscribers.back()->Subscribe("feed");
+    }
+    std::this_thread::sleep_for(200ms);
+    std::cout.rdbuf(pLog);
+
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::Data;
+    msg.body.resize(4096);
+    msg.header.size = msg.size();
+
+    for(bool bShared : {false, true})
+    {
+        const size_t nMessages = 1000;
+        uint64_t nBefore = g_nAllocations;
+        g_bCountAllThreads = true;
+        tStart = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < nMessages; i++)
+        {
+            if(bShared)
+                server.Publish("feed", msg);
+            else
+                for(auto& client : server.m_deqConnections)
+                    client->Send(msg);
+        }
+        for(auto& client : vSubscribers)
+            while(client->Incoming().count() < nMessages)
+                std::this_thread::yield();
+        double dMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        g_bCountAllThreads = false;
+        std::printf("  %-16s %9.1fms for %zu x 100  %6.2f allocations/delivery\n", bShared ? "Publish()" : "Send() each", dMs, nMessages,
+            double(g_nAllocations - nBefore) / (nMessages * vSubscribers.size()));
+
+        for(auto& client : vSubscribers)
+            client->Incoming().clear();
+    }
+
+    pLog = std::cout.rdbuf(nullptr);
+    for(auto& client : vSubscribers)
+        client->Disconnect();
+    server.Stop();
+    std::cout.rdbuf(pLog);
+}
+
+/*
+    @brief Area of interest
+    10k entities wandering a 4000x4000 world, each seeing a radius of 100. Per tick:
+    moving them all in the grid and updating every visible set, then finding who
+    should hear each entity's position with the grid against checking everyone
+*/
+static void BenchInterest()
+{
+    std::printf("interest: 10k moving entities, radius 100 in a 4000x4000 world\n");
+
+    const size_t nEntities = 10000, nTicks = 50;
+    const float fWorld = 4000.0f, fRadius = 100.0f;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> place(0.0f, fWorld), step(-5.0f, 5.0f);
+
+    olc::net::interest_grid<uint32_t> grid(fRadius);
+    std::vector<olc::net::grid_position> vPositions(nEntities);
+    for(uint32_t i = 0; i < nEntities; i++)
+    {
+        vPositions[i] = { place(rng), place(rng) };
+        grid.set_position(i, vPositions[i]);
+    }
+    size_t nEvents = 0;
+    auto count = [&](uint32_t, uint32_t){ nEvents++; };
+    grid.update_visibility(fRadius, count, count);
+
+    nEvents = 0;
+    double dMoveMs = 0, dVisibilityMs = 0;
+    for(size_t t = 0; t < nTicks; t++)
+    {
+        auto tStart = std::chrono::steady_clock::now();
+        for(uint32_t i = 0; i < nEntities; i++)
+        {
+            auto& pos = vPositions[i];
+            pos = { std::clamp(pos.x + step(rng), 0.0f, fWorld), std::clamp(pos.y + step(rng), 0.0f, fWorld) };
+            grid.set_position(i, pos);
+        }
+        auto tMoved = std::chrono::steady_clock::now();
+        grid.update_visibility(fRadius, count, count);
+        dMoveMs += std::chrono::duration<double, std::milli>(tMoved - tStart).count();
+        dVisibilityMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tMoved).count();
+    }
+    size_t nVisible = 0;
+    for(uint32_t i = 0; i < nEntities; i++)
+        nVisible += grid.visible_count(i);
+    std::printf("  move all         %8.2fms/tick\n", dMoveMs / nTicks);
+    std::printf("  visible sets     %8.2fms/tick  %6.1f visible each  %6.0f enters+leaves/tick\n",
+        dVisibilityMs / nTicks, double(nVisible) / nEntities, double(nEvents) / nTicks);
+
+    //every entity's position goes to those who can see it
+    size_t nSends = 0;
+    auto tStart = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < nEntities; i++)
+        nSends += grid.for_each_near(vPositions[i], fRadius, [](uint32_t){});
+    double dGridMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+    std::printf("  grid fan-out     %8.2fms/tick  %9zu sends/tick\n", dGridMs, nSends);
+
+    nSends = 0;
+    const float fRadius2 = fRadius * fRadius;
+    tStart = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < nEntities; i++)
+        for(uint32_t j = 0; j < nEntities; j++)
+        {
+            float dx = vPositions[j].x - vPositions[i].x, dy = vPositions[j].y - vPositions[i].y;
+            nSends += dx * dx + dy * dy <= fRadius2;
+        }
+    double dScanMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+    std::printf("  scan everyone    %8.2fms/tick  %9zu sends/tick  (broadcast: %zu)\n", dScanMs, nSends, nEntities * nEntities);
+}
+
+/*
+    @brief Snapshot deltas
+    A 1000 entity world state sent to 100 clients every tick with 5% of the
+    entities moving, in full against deltas on the acked baseline. Acks come
+    back 2 ticks late, as they would with a round trip of a few ticks
+*/
+static void BenchSnapshot()
+{
+    std::printf("snapshot: 1000 entities x 32B to 100 clients, 5%% moving per tick\n");
+
+    struct entity
+    {
+        float x, y, z;
+        float vx, vy, vz;
+        uint32_t nHealth;
+        uint32_t nFlags;
+    };
+    const size_t nEntities = 1000, nClients = 100, nTicks = 200, nAckDelay = 2;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> pick(0, nEntities - 1);
+    std::uniform_real_distribution<float> step(-1.0f, 1.0f);
+
+    std::vector<entity> vWorld(nEntities);
+    for(size_t i = 0; i < nEntities; i++)
+        vWorld[i] = { float(i), float(i), 0, 0, 0, 0, 100, 0 };
+
+    olc::net::message<BenchMsgTypes> state;
+    state.header.id = BenchMsgTypes::Data;
+
+    std::vector<olc::net::snapshot_sender<BenchMsgTypes>> vSenders(nClients);
+    std::vector<olc::net::snapshot_receiver<BenchMsgTypes>> vReceivers(nClients);
+    std::deque<std::vector<uint32_t>> dqAcks;
+    uint64_t nFullBytes = 0, nDeltaBytes = 0;
+    double dFullMs = 0, dDeltaMs = 0, dDecodeMs = 0;
+    for(size_t t = 0; t < nTicks; t++)
+    {
+        for(size_t n = 0; n < nEntities / 20; n++)
+        {
+            entity& e = vWorld[pick(rng)];
+            e.x += step(rng);
+            e.y += step(rng);
+        }
+        state.body.resize(sizeof(entity) * nEntities);
+        std::memcpy(state.body.data(), vWorld.data(), state.body.size());
+
+        //full: a copy of the state per client
+        std::vector<olc::net::message<BenchMsgTypes>> vFrames(nClients);
+        auto tStart = std::chrono::steady_clock::now();
+        for(size_t c = 0; c < nClients; c++)
+        {
+            vFrames[c] = state;
+            nFullBytes += vFrames[c].size();
+        }
+        dFullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+        tStart = std::chrono::steady_clock::now();
+        for(size_t c = 0; c < nClients; c++)
+        {
+            vFrames[c] = vSenders[c].encode(state);
+            nDeltaBytes += vFrames[c].size();
+        }
+        dDeltaMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+        std::vector<uint32_t> vAcks(nClients);
+        tStart = std::chrono::steady_clock::now();
+        for(size_t c = 0; c < nClients; c++)
+            vAcks[c] = vReceivers[c].decode(vFrames[c]);
+        dDecodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+        dqAcks.push_back(std::move(vAcks));
+        if(dqAcks.size() > nAckDelay)
+        {
+            for(size_t c = 0; c < nClients; c++)
+                vSenders[c].ack(dqAcks.front()[c]);
+            dqAcks.pop_front();
+        }
+    }
+
+    std::printf("  full             %8.1fKB/tick  %8.3fms/tick to build\n", nFullBytes / 1024.0 / nTicks, dFullMs / nTicks);
+    std::printf("  delta            %8.1fKB/tick  %8.3fms/tick to encode  %8.3fms/tick to decode  (%llu full, %llu deltas)\n",
+        nDeltaBytes / 1024.0 / nTicks, dDeltaMs / nTicks, dDecodeMs / nTicks,
+        (unsigned long long)vSenders[0].full(), (unsigned long long)vSenders[0].deltas());
+}
+
+/*
+    @brief Late join bootstrap
+    One client is sent a 64MB world state while another keeps pinging. The state
+    goes as one copied message, as one shared message, or as a bootstrap streamed
+    in 64KB chunks. Reports the other client's ping latency meanwhile, and how long
+    the state took to arrive
+*/
+static void BenchBootstrap()
+{
+    std::printf("bootstrap: ping latency while a 64MB state goes to another client (TCP loopback)\n");
+
+    auto pState = std::make_shared<olc::net::message<BenchMsgTypes>>();
+    pState->header.id = BenchMsgTypes::Data;
+    pState->body.resize(64 * 1024 * 1024, 1);
+    pState->header.size = pState->size();
+
+    const char* aNames[] = { "copied message", "shared message", "bootstrap" };
+    for(size_t nMode = 0; nMode < 3; nMode++)
+    {
+        BenchServer server(uint16_t(60111));
+        server.Start();
+        server.Run();
+
+        BenchClient joiner, player;
+        joiner.Connect("127.0.0.1", 60111);
+        joiner.Receive();   //Ready
+        player.Connect("127.0.0.1", 60111);
+        player.Receive();
+        MeasureRoundTrips(player, 1000, 16);
+        auto remote = server.m_deqConnections.front();
+
+        std::vector<double> vPing;
+        auto tStart = std::chrono::steady_clock::now();
+        if(nMode == 0)
+            server.MessageClient(remote, *pState, olc::net::send_priority::bulk);
+        else if(nMode == 1)
+            remote->Send(std::shared_ptr<const olc::net::message<BenchMsgTypes>>(pState), olc::net::send_priority::bulk);
+        else
+            server.BootstrapClient(remote, pState);
+
+        while(joiner.Incoming().empty())
+        {
+            auto vRound = MeasureRoundTrips(player, 1, 16);
+            vPing.push_back(vRound[0]);
+        }
+        double dArrivedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        joiner.Receive();
+
+        PrintLatency(std::string(aNames[nMode]) + " ping", Percentiles(vPing));
+        std::printf("  %-22s %8.1fms to arrive\n", aNames[nMode], dArrivedMs);
+
+        joiner.Disconnect();
+        server.Halt(player);
+    }
+}
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+/*
+    @brief Coroutine request/response
+    Ping round trips through the incoming queues and Update() against a server
+    session coroutine and a client coroutine that co_await each message
+*/
+static void BenchCoroutines()
+{
+    std::printf("coroutines: queued callbacks vs co_await (TCP loopback)\n");
+
+    {
+        BenchServer server(uint16_t(60102));
+        server.Start();
+        server.Run();
+
+        BenchClient client;
+        client.Connect("127.0.0.1", 60102);
+        client.Receive();   //Ready
+
+        MeasureRoundTrips(client, 1000, 16);
+        PrintLatency("queued rtt 16B", Percentiles(MeasureRoundTrips(client, 20000, 16)));
+        server.Halt(client);
+    }
+
+    {
+        BenchServer server(uint16_t(60102));
+        server.SetSessionHandler([](std::shared_ptr<olc::net::connection<BenchMsgTypes>> conn) -> boost::asio::awaitable<void>
+        {
+            for(;;)
+                co_await conn->AsyncSend(co_await conn->AsyncReceive());
+        });
+        server.Start();
+
+        BenchClient client;
+        std::promise<std::vector<double>> samples;
+        client.Spawn([&]() -> boost::asio::awaitable<void>
+        {
+            co_await client.AsyncConnect("127.0.0.1", 60102);
+            co_await client.AsyncReceive();     //Ready
+
+            olc::net::message<BenchMsgTypes> msg;
+            msg.header.id = BenchMsgTypes::Ping;
+            msg.body.resize(16);
+            msg.header.size = msg.size();
+
+            std::vector<double> vSamples;
+            for(size_t i = 0; i < 21000; i++)
+            {
+                auto tStart = std::chrono::steady_clock::now();
+                co_await client.AsyncSend(msg);
+                co_await client.AsyncReceive();
+                if(i >= 1000)
+                    vSamples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tStart).count());
+            }
+            samples.set_value(vSamples);
+        });
+
+        PrintLatency("co_await rtt 16B", Percentiles(samples.get_future().get()));
+        client.Disconnect();
+        server.Stop();
+    }
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    std::vector<std::pair<std::string, void(*)()>> vBenchmarks =
+    {
+        { "transport", BenchTransport },
+        { "io", BenchIO },
+        { "dispatch", BenchDispatch },
+        { "serialize", BenchSerialize },
+        { "views", BenchViews },
+        { "body", BenchBody },
+        { "checksum", BenchChecksum },
+#if defined(OLC_NET_TLS)
+        { "tls", BenchTls },
+#endif
+        { "priority", BenchPriority },
+        { "storm", BenchStorm },
+        { "topics", BenchTopics },
+        { "interest", BenchInterest },
+        { "snapshot", BenchSnapshot },
+        { "bootstrap", BenchBootstrap },
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+        { "coroutines", BenchCoroutines },
+#endif
+    };
+
+    for(auto& [sName, fnBench] : vBenchmarks)
+    {
+        bool bSelected = argc < 2;
+        for(int i = 1; i < argc; i++)
+            bSelected |= sName == argv[i];
+
+        if(bSelected)
+            fnBench();
+    }
+    return 0;
+}
@@ -33,6 +33,22 @@ namespace olc
             private:
                 //This is the thread safe queue of incoming messages from server
                 tsqueue<owned_message<T>> m_qMessagesIn;
+                //Receive block for batched I/O, null when disabled
+                std::shared_ptr<recv_pool> m_pRecvPool;
+                //OnMessage() is called from the asio thread rather than queueing
+                bool m_bInlineDispatch = false;
+                //Blocks for view dispatch, null when disabled
+                std::shared_ptr<recv_pool> m_pViewPool;
+                //Frames the connection accepts, null for all of them
+                std::shared_ptr<const message_filter<T>> m_pFilter;
+                //Messages only worth sending in their latest version, null for none
+                std::shared_ptr<const conflation<T>> m_pConflation;
+                //Extensions asked for on every connection
+                uint32_t m_nFeatures = 0;
+#if defined(OLC_NET_TLS)
+                //Trusted CA and stored session for TLS, null for plain connections
+                std::shared_ptr<tls_context> m_pTls;
+#endif
             public:
                 //Connect to server with hostname/ip-address and port
                 bool Connect(const std::string& host,const uint16_t port)
@@ -41,15 +57,192 @@ namespace olc
                     {
                          //Resolve hostname/ip-address into tangiable physical address
                         boost::asio::ip::tcp::resolver resolver(m_context);
-                        boost::asio::ip::tcp::resolver::results_type endpoints=resolver.resolve(host, std::to_string(port));
+                        boost::asio::ip::tcp::resolver::results_type results=resolver.resolve(host, std::to_string(port));
 
+                        std::vector<typename connection<T>::endpoint_type> endpoints;
+                        for(const auto& entry : results)
+                            endpoints.emplace_back(entry.endpoint());
+
+                        return ConnectTo(endpoints);
+                    }
+                    catch(std::exception& e)
+                    {
+                        std::cerr<<"Client Exception: " << e.what() << "\n";
+                        return false;
+                    }
+                }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+                //Connect to a server on this host through its local (AF_UNIX) socket path
+                bool ConnectLocal(const std::string& sPath)
+                {
+                    return ConnectTo({boost::asio::local::stream_protocol::endpoint(sPath)});
+                }
+
+                //As ConnectLocal(), but once connected frames travel through shared memory.
+                //Falls back to the local socket if the server does not grant it
+                bool ConnectSharedMemory(const std::string& sPath)
+                {
+                    return ConnectTo({boost::asio::local::stream_protocol::endpoint(sPath)}, connection<T>::feature::shared_memory);
+                }
+#endif
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+                // Coroutine API, the awaitable counterparts of Connect(), Send() and
+                // Incoming(). Await them from a coroutine started with Spawn()
+
+                //Run a coroutine on the client's asio thread, starting it if need be
+                void Spawn(std::function<boost::asio::awaitable<void>()> fnTask)
+                {
+                    if(thrContext.joinable() && m_context.stopped())
+                    {
+                        thrContext.join();
+                        m_context.restart();
+                    }
+
+                    boost::asio::co_spawn(m_context, std::move(fnTask), boost::asio::detached);
+
+                    if(!thrContext.joinable())
+                        thrContext=std::thread([this](){m_context.run(); });
+                }
+
+                //Completes once connected and validated, true on success
+                boost::asio::awaitable<bool> AsyncConnect(const std::string& host,const uint16_t port)
+                {
+                    std::vector<typename connection<T>::endpoint_type> endpoints;
+                    try
+                    {
+                        boost::asio::ip::tcp::resolver resolver(m_context);
+                        auto results = co_await resolver.async_resolve(host, std::to_string(port), boost::asio::use_awaitable);
+                        for(const auto& entry : results)
+                            endpoints.emplace_back(entry.endpoint());
+                    }
+                    catch(std::exception& e)
+                    {
+                        std::cerr<<"Client Exception: " << e.what() << "\n";
+                        co_return false;
+                    }
+
+                    m_connection=std::make_unique<connection<T>>(
+                        connection<T>::owner::client,
+                        m_context,
+                        typename connection<T>::socket_type(m_context), m_qMessagesIn);
+                    m_connection->EnableCoroutines();
+#if defined(OLC_NET_TLS)
+                    if(m_pTls)
+                        m_connection->EnableTls(m_pTls);
+#endif
+                    m_connection->RequestFeatures(m_nFeatures);
+                    if(m_pRecvPool)
+                        m_connection->EnableBatchedIO(m_pRecvPool);
+                    m_connection->ConnectToServer(endpoints);
+
+                    co_return co_await m_connection->AsyncHandshake();
+                }
+
+                boost::asio::awaitable<void> AsyncSend(const message<T>& msg, send_priority nPriority = send_priority::interactive)
+                {
+                    if(!m_connection)
+                        throw boost::system::system_error(boost::asio::error::not_connected);
+                    co_await m_connection->AsyncSend(msg, nPriority);
+                }
+
+                boost::asio::awaitable<message<T>> AsyncReceive()
+                {
+                    if(!m_connection)
+                        throw boost::system::system_error(boost::asio::error::not_connected);
+                    co_return co_await m_connection->AsyncReceive();
+                }
+#endif
+
+                //Batched socket I/O for the next connection, see connection::EnableBatchedIO()
+                void SetBatchedIO(bool bEnable)
+                {
+                    m_pRecvPool = bEnable ? recv_pool::Create(1) : nullptr;
+                }
+
+                //Inline dispatch of message views for the next connection, OnMessageView()
+                //is called instead of OnMessage(). Same threading rules as
+                //SetInlineDispatch(), see server_interface::SetViewDispatch()
+                void SetViewDispatch(bool bEnable, size_t nBlocks = 4)
+                {
+                    m_pViewPool = bEnable ? recv_pool::Create(nBlocks) : nullptr;
+                }
+
+#if defined(OLC_NET_TLS)
+                //Connect over TLS from now on, see tls_context::CreateClient(). Keep using
+                //the same context, it holds the session a reconnect resumes
+                void SetTls(std::shared_ptr<tls_context> pContext)
+                {
+                    m_pTls = std::move(pContext);
+                }
+#endif
+
+                //Ask for the compact wire header on the next connection, frames then carry
+                //3 to 10 header bytes instead of 10. Over a plain socket a header costs one
+                //extra read, so it pays off most with SetBatchedIO()
+                void SetCompactHeaders(bool bEnable)
+                {
+                    RequestFeature(connection<T>::feature::compact_header, bEnable);
+                }
+
+                //Ask for a CRC32C trailer on every frame of the next connection. Frames
+                //that fail the check are counted in io_stats::nCorrupt and end the
+                //connection. Ignored over shared memory
+                void SetFrameChecksums(bool bEnable)
+                {
+                    RequestFeature(connection<T>::feature::frame_checksum, bEnable);
+                }
+
+                //Turn away unwanted frames on the next connection, see
+                //connection::SetMessageFilter()
+                void SetMessageFilter(std::shared_ptr<const message_filter<T>> pFilter)
+                {
+                    m_pFilter = std::move(pFilter);
+                }
+
+                //Conflate keyed updates queued on the next connection, see conflation
+                void SetConflation(std::shared_ptr<const conflation<T>> pConflation)
+                {
+                    m_pConflation = std::move(pConflation);
+                }
+
+            private:
+                void RequestFeature(uint32_t nFeature, bool bEnable)
+                {
+                    if(bEnable)
+                        m_nFeatures |= nFeature;
+                    else
+                        m_nFeatures &= ~nFeature;
+                }
+
+                bool ConnectTo(const std::vector<typename connection<T>::endpoint_type>& endpoints, uint32_t nFeatures = 0)
+                {
+                    try
+                    {
                         //Create connection
                         m_connection=std::make_unique<connection<T>>(
                             connection<T>::owner::client,
                             m_context,
-                            boost::asio::ip::tcp::socket(m_context), m_qMessagesIn);
+                            typename connection<T>::socket_type(m_context), m_qMessagesIn);
 
                         //Tell the connection object to connect to server
+                        m_connection->RequestFeatures(m_nFeatures | nFeatures);
+#if defined(OLC_NET_TLS)
+                        if(m_pTls)
+                            m_connection->EnableTls(m_pTls);
+#endif
+                        if(m_pRecvPool)
+                            m_connection->EnableBatchedIO(m_pRecvPool);
+                        if(m_pFilter)
+                            m_connection->SetMessageFilter(m_pFilter);
+                        if(m_pConflation)
+                            m_connection->SetConflation(m_pConflation);
+                        if(m_pViewPool)
+                            m_connection->SetViewHandler([this](std::shared_ptr<connection<T>>, message_view<T>& view){ OnMessageView(view); },
+                                m_pRecvPool ? m_pRecvPool : m_pViewPool);
+                        if(m_bInlineDispatch)
+                            m_connection->SetMessageHandler([this](std::shared_ptr<connection<T>>, message<T>& msg){ OnMessage(msg); });
                         m_connection->ConnectToServer(endpoints);
 
                         //Start Context Thread
@@ -64,6 +257,7 @@ namespace olc
                     return true;
                 }
 
+            public:
                 //Disconnect from server
                 void Disconnect()
                 {
@@ -81,7 +275,7 @@ namespace olc
                         thrContext.join();
 
                     //Destroy the connection object
-                    m_connection.release();
+                    m_connection.reset();
                 }
 
                 //Check if client is actually connected to a server
@@ -93,11 +287,35 @@ namespace olc
                         return false;
                 }
 
-                //send message to server
-                void Send(const message<T>& msg)
+                //send message to server, ahead of anything queued in lower lanes
+                void Send(const message<T>& msg, send_priority nPriority = send_priority::interactive)
+                {
+                    if(IsConnected())
+                        m_connection->Send(msg, nPriority);
+                }
+
+                //Ask the server for messages published to a topic, or to every topic that
+                //starts with a prefix when sPattern ends in '*' (see topic_index). They
+                //arrive like any other message
+                void Subscribe(const std::string& sPattern)
+                {
+                    if(IsConnected())
+                        m_connection->SendControl(connection<T>::control::subscribe, sPattern);
+                }
+
+                void Unsubscribe(const std::string& sPattern)
                 {
                     if(IsConnected())
-                        m_connection->Send(msg);
+                        m_connection->SendControl(connection<T>::control::unsubscribe, sPattern);
+                }
+
+                //Inline dispatch for the next connection. OnMessage() is called on the
+                //client's asio thread (the reader thread for shared memory) as soon as a
+                //message is read, and Incoming() stays empty. Don't block in it, and guard
+                //anything it shares with other threads
+                void SetInlineDispatch(bool bEnable)
+                {
+                    m_bInlineDispatch = bEnable;
                 }
 
                 //Retrieve queue of messages from server
@@ -105,6 +323,21 @@ namespace olc
                 {
                     return m_qMessagesIn;
                 }
+
+            protected:
+                //Called when a message arrives, only in inline dispatch mode
+                virtual void OnMessage(message<T>& msg)
+                {
+
+                }
+
+                //Called when a message arrives in view dispatch mode. By default the view is
+                //copied into a message for OnMessage(), override it to read in place
+                virtual void OnMessageView(message_view<T>& view)
+                {
+                    message<T> msg = view.to_message();
+                    OnMessage(msg);
+                }
         };
     }
 }
\ No newline at end of file
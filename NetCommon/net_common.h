@@ -10,6 +10,15 @@
 #include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <functional>
+#include <atomic>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
 
 #include <boost/asio.hpp>
 #include <boost/asio/ts/buffer.hpp>
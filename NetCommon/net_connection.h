@@ -2,6 +2,17 @@
 #include "net_common.h"
 #include "net_tsqueue.h"
 #include "net_message.h"
+#include "net_shm.h"
+#include "net_pool.h"
+#include "net_dispatcher.h"
+#include "net_wire.h"
+#include "net_crc.h"
+#include "net_tls.h"
+#include "net_ratelimit.h"
+#include "net_sendqueue.h"
+#include "net_snapshot.h"
+
+#include <unordered_map>
 
 namespace olc
 {
@@ -22,20 +33,68 @@ namespace olc
                     server,
                     client
                 };
+
+                // The socket is protocol agnostic, so the same connection can sit on top of
+                // a TCP socket or a local (AF_UNIX) stream socket. Framing, handshake and
+                // callbacks are identical for both.
+                using socket_type = boost::asio::generic::stream_protocol::socket;
+                using endpoint_type = boost::asio::generic::stream_protocol::endpoint;
+
+                // Socket operations issued by this connection, the best proxy we have for
+                // system calls spent per message
+                struct io_stats
+                {
+                    uint64_t nReads = 0;        //reads issued on the socket
+                    uint64_t nWrites = 0;       //writes issued on the socket
+                    uint64_t nMessagesIn = 0;
+                    uint64_t nMessagesOut = 0;
+                    uint64_t nRejected = 0;     //frames turned away by the message filter
+                    uint64_t nCorrupt = 0;      //frames whose checksum did not match
+                    uint64_t nOverLimit = 0;    //frames that found their rate budget spent
+                    uint64_t nThrottledUs = 0;  //time reads were paused for the rate limits
+                    uint64_t nExpired = 0;      //queued messages dropped for their deadline
+                    uint64_t nConflated = 0;    //queued messages replaced by a newer one
+                    uint64_t nSnapshotsFull = 0;    //snapshots sent whole
+                    uint64_t nSnapshotsDelta = 0;   //snapshots sent as a delta
+                    uint64_t nSnapshotBytes = 0;    //body bytes of the snapshots sent
+                };
+
+                // Optional extensions, offered by the server and requested by the client
+                // during the handshake. Only the bits both sides agree on are used
+                enum feature : uint32_t
+                {
+                    //frames travel through a shared memory ring pair instead of the
+                    //socket, only offered on local sockets
+                    shared_memory = 1 << 0,
+                    //frames use the compact wire header, see net_wire.h
+                    compact_header = 1 << 1,
+                    //every frame carries a CRC32C trailer, checked before it is handed
+                    //on. Not used with shared memory, which never leaves the host
+                    frame_checksum = 1 << 2,
+                };
+
                 // Constructor: Specify Owner, connect to context, transfer the socket
 			    //Provide reference to incoming message queue
-                connection(owner parent, boost::asio::io_context& asioContext,boost::asio::ip::tcp::socket socket,tsqueue<owned_message<T>>& qIn)
-                :m_asioContext(asioContext),m_socket(std::move(socket)),m_qMessagesIn(qIn)
+                connection(owner parent, boost::asio::io_context& asioContext,socket_type socket,tsqueue<owned_message<T>>& qIn)
+                :m_asioContext(asioContext),m_socket(std::move(socket)),m_qMessagesIn(qIn),m_timerShm(asioContext),m_timerSignal(asioContext),m_timerHandshake(asioContext),m_timerRate(asioContext)
                 {
+                    m_timerSignal.expires_at(std::chrono::steady_clock::time_point::max());
+
                     m_nOwnerType=parent;
 
+                    //Headers and bodies are written separately, so don't let Nagle hold
+                    //back small frames on TCP (local sockets have no such option)
+                    if(m_socket.is_open() && IsTcp())
+                        m_socket.set_option(boost::asio::ip::tcp::no_delay(true));
+
                     //construct validation check data
                     if(m_nOwnerType == owner::server){  //if the owner is a server
 
                         //I'm expected to generate some random data and then send out to the connection
                         //Connection is Server -> Client, construct random data for the client 
                         // -- to transform and send back to validation
-                        m_nHandshakeOut = uint64_t(std::chrono::system_clock::now().time_since_epoch().count()); //data to send out
+                        //it also names the shared memory region, so it must not be guessable
+                        m_nHandshakeOut = shm::Random(); //data to send out
 
                         //the scrambled version of the data
                         //pre-calculate the result for checking when the client responds
@@ -50,7 +109,19 @@ namespace olc
                     }
                 }
 
-                virtual ~connection(){}
+                virtual ~connection()
+                {
+                    StopSharedMemory();
+                    if(m_threadShm.joinable())
+                    {
+                        //the reader holds the last reference only once it has returned,
+                        //so nothing of this object is in use on that thread any more
+                        if(m_threadShm.get_id()==std::this_thread::get_id())
+                            m_threadShm.detach();
+                        else
+                            m_threadShm.join();
+                    }
+                }
                 // This ID is used system wide - its how clients will understand other clients
 			// exist across the whole system.
                 uint32_t GetID() const
@@ -65,8 +136,17 @@ namespace olc
                         if(m_socket.is_open())
                         {
                             id = uid;  //store the id 
+                            StartHandshakeTimer();
                         //was: ReadHeader();
 
+                        //both ends share this host, so offer to move frames into shared memory
+                        //(coroutines read the socket themselves, so not for them)
+                        if(!IsTcp() && !m_bAwaitable && !IsSecure())
+                            m_nFeaturesOut |= feature::shared_memory;
+                        m_nFeaturesOut |= feature::compact_header | feature::frame_checksum;
+
+                        StartTls([this, server]()
+                        {
                         //a client has attempted to connect to server, but we wish the client to first
                         // -- validate itself, so first write out the handshake data to be validated
                         WriteValidation();
@@ -74,27 +154,35 @@ namespace olc
                         //next, issue a task to sit and wait asynchronously for precisely 
                         // -- the validation data sent back from the client
                         ReadValidation(server); 
+                        });
                         }
                     }
                 }
-                void ConnectToServer(const boost::asio::ip::tcp::resolver::results_type &endpoints)
+                void ConnectToServer(const std::vector<endpoint_type>& endpoints)
                 {
                     //Only clients can connect to servers
                     if(m_nOwnerType == owner::client)
                     {
                         //Request asio context attempts to connect to an endpoint
                         boost::asio::async_connect(m_socket,endpoints,
-                        [this](std::error_code ec, boost::asio::ip::tcp::endpoint endpoint)
+                        [this](std::error_code ec, endpoint_type endpoint)
                         {
                             if(!ec)
                             {
+                                if(IsTcp())
+                                    m_socket.set_option(boost::asio::ip::tcp::no_delay(true));
+
                                //was:
                                     // //issue the task to read the header
                                     // ReadHeader();
 
                                     //first thing server will do is send packet to be validated
                                     //so wait for that and respond
-                                    ReadValidation();
+                                    StartTls([this](){ ReadValidation(); });
+                            }
+                            else
+                            {
+                                CloseSocket();
                             }
                         }
                         );
@@ -103,95 +191,609 @@ namespace olc
                 void Disconnect()
                 {
                     if(IsConnected())
-                        boost::asio::post(m_asioContext,[this](){m_socket.close();});
+                        boost::asio::post(m_asioContext,[this](){CloseSocket();});
+                }
+
+                //Stop the shared memory reader and wait for it to finish, for when the
+                //asio thread that would notice the socket close is gone. Not from the
+                //reader thread itself
+                void JoinSharedMemory()
+                {
+                    StopSharedMemory();
+                    if(m_threadShm.joinable() && m_threadShm.get_id() != std::this_thread::get_id())
+                        m_threadShm.join();
                 }
                 bool IsConnected() const
                 {
                     return m_socket.is_open();
                 }
+
+                //Extensions agreed on during the handshake
+                uint32_t GetFeatures() const
+                {
+                    return m_nFeatures;
+                }
+
+                //Client only - ask for extensions before connecting, the server decides
+                //which of them it will grant
+                void RequestFeatures(uint32_t nFeatures)
+                {
+                    m_nFeaturesWanted = nFeatures;
+                }
+
+                //Switch to batched socket I/O before connecting. Reads go into a block from
+                //the pool and every frame that arrived is cut out of it, so a busy stream
+                //costs one read for many messages. Writes gather every queued message into
+                //a single write.
+                void EnableBatchedIO(std::shared_ptr<recv_pool> pPool)
+                {
+                    m_pRecvPool = std::move(pPool);
+                }
+
+#if defined(OLC_NET_TLS)
+                //Run the connection over TLS, set before connecting. The TLS handshake
+                //comes first, everything after it (validation included) is encrypted
+                void EnableTls(std::shared_ptr<tls_context> pContext)
+                {
+                    m_pTlsContext = std::move(pContext);
+                    m_pTls = std::make_unique<tls_stream>(m_socket, m_pTlsContext->native());
+                }
+#endif
+
+                bool IsSecure() const
+                {
+#if defined(OLC_NET_TLS)
+                    return m_pTls != nullptr || m_pKtls != nullptr;
+#else
+                    return false;
+#endif
+                }
+
+                //True if the kernel encrypts and decrypts this connection's records, see
+                //tls_context::SetKernelOffload()
+                bool IsKernelTls() const
+                {
+#if defined(OLC_NET_TLS)
+                    return m_pKtls != nullptr && m_pTls == nullptr;
+#else
+                    return false;
+#endif
+                }
+
+                //True if the TLS handshake resumed an earlier session
+                bool IsTlsResumed() const
+                {
+                    return m_bTlsResumed;
+                }
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+                // Coroutine API. Instead of filling the incoming queue the connection waits
+                // for AsyncReceive() calls, so a request/response protocol can be written as
+                // straight line code running on the asio thread with no queue hand-off.
+                // All of these must be awaited from a coroutine on the connection's context.
+                using session_handler = std::function<boost::asio::awaitable<void>(std::shared_ptr<connection<T>>)>;
+
+                //Switch to coroutine mode before connecting. On a server, fnSession is
+                //spawned once the client has been validated
+                void EnableCoroutines(session_handler fnSession = nullptr)
+                {
+                    m_bAwaitable = true;
+                    m_fnSession = std::move(fnSession);
+                }
+
+                //Completes with the next message from the remote side, throws
+                //boost::system::system_error once the connection has gone
+                boost::asio::awaitable<message<T>> AsyncReceive()
+                {
+                    //control frames, pieces of a larger message and snapshots that can't be
+                    //rebuilt are taken care of here, the loop reads on until a message is whole
+                    for(;;)
+                    {
+                        message<T> msg;
+                        boost::system::error_code ec;
+
+                        co_await AsyncReadHeader(msg.header, ec);
+
+                        //skip over rejected frames until one we want turns up, waiting out the
+                        //rate limits where they say so
+                        typename rate_meter<T>::verdict verdict = rate_meter<T>::verdict::pass;
+                        while(!ec && (!AcceptFrame(msg.header) || (verdict = ChargeFrame(msg.header)) != rate_meter<T>::verdict::pass))
+                        {
+                            if(verdict == rate_meter<T>::verdict::delay)
+                            {
+                                m_timerRate.expires_after(m_tRateWait);
+                                co_await m_timerRate.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                                verdict = rate_meter<T>::verdict::pass;
+                                continue;
+                            }
+
+                            if(verdict == rate_meter<T>::verdict::disconnect || (verdict == rate_meter<T>::verdict::pass && !DropRejected()))
+                                ec = boost::asio::error::connection_aborted;
+                            verdict = rate_meter<T>::verdict::pass;
+
+                            for(size_t nLeft = msg.header.size + TrailerSize(); !ec && nLeft > 0; )
+                            {
+                                size_t n = std::min(nLeft, DiscardBuffer().size());
+                                m_stats.nReads++;
+                                co_await AsyncRead(boost::asio::buffer(m_vDiscard.data(), n),
+                                    boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                                nLeft -= n;
+                            }
+
+                            if(!ec)
+                                co_await AsyncReadHeader(msg.header, ec);
+                        }
+
+                        if(!ec && msg.header.size + TrailerSize() > 0)
+                        {
+                            msg.body.resize(msg.header.size);
+                            std::array<boost::asio::mutable_buffer, 2> buffers = {
+                                boost::asio::buffer(msg.body.data(), msg.body.size()),
+                                boost::asio::buffer(m_aTrailerIn.data(), TrailerSize()) };
+                            m_stats.nReads++;
+                            co_await AsyncRead(buffers,
+                                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+                            if(!ec && !VerifyTrailer(m_aHeaderIn.data(), msg.body.data(), msg.body.size(), m_aTrailerIn.data()))
+                                ec = boost::system::errc::make_error_code(boost::system::errc::protocol_error);
+                        }
+
+                        if(ec)
+                        {
+                            CloseSocket();
+                            throw boost::system::system_error(ec);
+                        }
+
+                        if(DeliverControl(msg.header, msg.body.data(), msg.body.size()))
+                            continue;
+                        if(!Reassemble(msg) || (IsSnapshotIn() && !DecodeSnapshot(msg)))
+                            continue;
+
+                        m_stats.nMessagesIn++;
+                        co_return msg;
+                    }
+                }
+
+                //Completes once the message has been written, or dropped for its deadline.
+                //It joins the same queue as Send(), so the two can be mixed and ordering
+                //within a lane is kept
+                boost::asio::awaitable<void> AsyncSend(const message<T>& msg, send_priority nPriority = send_priority::interactive)
+                {
+                    bool bWritingMessage=!m_qMessagesOut.empty();
+                    auto pDone = std::make_shared<bool>(false);
+                    m_qMessagesOut.push(msg, nPriority, pDone);
+                    OnQueued();
+                    if(!bWritingMessage && m_bHandshakeDone)
+                        WriteHeader();
+
+                    while(!*pDone)
+                    {
+                        if(!IsConnected())
+                            throw boost::system::system_error(boost::asio::error::not_connected);
+                        co_await AwaitSignal();
+                    }
+                }
+
+                //Client only - completes when the handshake is over, true if it succeeded
+                boost::asio::awaitable<bool> AsyncHandshake()
+                {
+                    while(!m_bHandshakeDone && IsConnected())
+                        co_await AwaitSignal();
+                    co_return m_bHandshakeDone && IsConnected();
+                }
+
+            private:
+                //Coroutine counterpart of ReadHeader(), fills h from the next wire header
+                boost::asio::awaitable<void> AsyncReadHeader(message_header<T>& h, boost::system::error_code& ec)
+                {
+                    m_stats.nReads++;
+                    size_t n = co_await AsyncRead(boost::asio::buffer(m_aHeaderIn.data(), FirstHeaderRead()),
+                        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+                    size_t nRest = ec ? 0 : wire::Length(m_aHeaderIn.data(), CompactHeaders()) - n;
+                    if(nRest > 0)
+                    {
+                        m_stats.nReads++;
+                        co_await AsyncRead(boost::asio::buffer(m_aHeaderIn.data() + n, nRest),
+                            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                    }
+
+                    if(!ec && !wire::Decode(m_aHeaderIn.data(), CompactHeaders(), h, &m_nFlagsIn))
+                        ec = boost::system::errc::make_error_code(boost::system::errc::protocol_error);
+                }
+
+                boost::asio::awaitable<void> AwaitSignal()
+                {
+                    boost::system::error_code ec;
+                    m_nSignalWaiters++;
+                    co_await m_timerSignal.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                    m_nSignalWaiters--;
+                }
+
+                void StartSession()
+                {
+                    auto self = this->shared_from_this();
+                    boost::asio::co_spawn(m_asioContext, m_fnSession(self),
+                    [self](std::exception_ptr e)
+                    {
+                        //a session usually ends because the client went away
+                        if(e)
+                            std::cout<<"["<<self->GetID()<<"] Session Ended.\n";
+                    });
+                }
+
+            public:
+#else
+            private:
+                void StartSession() {}
+
+            public:
+#endif
+
+                //Handler for inline dispatch. When set, complete messages are passed to it
+                //on the thread that read them instead of going to the incoming queue
+                using message_handler = std::function<void(std::shared_ptr<connection<T>>, message<T>&)>;
+
+                void SetMessageHandler(message_handler fnOnMessage)
+                {
+                    m_fnOnMessage = std::move(fnOnMessage);
+                }
+
+                //Handler for inline dispatch of message views. Like SetMessageHandler(),
+                //but bodies are read into blocks from pPool (or cut out of the batched
+                //receive block in place) and handed over without being copied into a
+                //message. Takes precedence over the message handler
+                using view_handler = std::function<void(std::shared_ptr<connection<T>>, message_view<T>&)>;
+
+                void SetViewHandler(view_handler fnOnView, std::shared_ptr<recv_pool> pPool)
+                {
+                    m_fnOnView = std::move(fnOnView);
+                    m_pViewPool = std::move(pPool);
+                }
+
+                //Requests to the library itself rather than the application, sent as frames
+                //flagged wire::control with the code in place of the message ID. They skip
+                //the message filter and never reach OnMessage
+                enum class control : uint32_t
+                {
+                    subscribe = 1,      //body is the topic or prefix pattern
+                    unsubscribe = 2,
+                    snapshot_ack = 3,   //message ID and sequence number of a rebuilt snapshot,
+                                        //sequence 0 asks for the next one in full
+                };
+
+                //Server only - handler for incoming control frames, called on the thread
+                //that read them. Without one, control frames are rejected like filtered ones
+                using control_handler = std::function<void(std::shared_ptr<connection<T>>, control, const std::string&)>;
+
+                void SetControlHandler(control_handler fnOnControl)
+                {
+                    m_fnOnControl = std::move(fnOnControl);
+                }
+
+                //Server only - called once, on the thread that closes the socket, when
+                //the connection is finished with for whatever reason
+                using close_handler = std::function<void(std::shared_ptr<connection<T>>)>;
+
+                void SetCloseHandler(close_handler fnOnClose)
+                {
+                    m_fnOnClose = std::move(fnOnClose);
+                }
+
+                //How the server side of a handshake ended, reported once per connection
+                enum class handshake_result
+                {
+                    validated,
+                    failed,     //wrong answer, or the socket went away
+                    timed_out,
+                    refused,    //turned away by server_interface::OnClientAdmission()
+                };
+
+                using handshake_handler = std::function<void(handshake_result)>;
+
+                //Completion handler for server_interface::OnClientAdmission(), true lets
+                //the client in. Callable from any thread, only the first call counts
+                using admission_handler = std::function<void(bool)>;
+
+                //Server only - set before ConnectToClient(). A client that hasn't been
+                //validated tTimeout after the connection started is dropped (zero waits
+                //forever), and fnDone hears how the handshake ended
+                void SetHandshakeHandler(std::chrono::milliseconds tTimeout, handshake_handler fnDone)
+                {
+                    m_tHandshakeTimeout = tTimeout;
+                    m_fnHandshakeDone = std::move(fnDone);
+                }
+
+                //Check every incoming frame header against pFilter before its body is read.
+                //Rejected frames are counted and, depending on the filter, skipped without
+                //being allocated or end the connection. Set it before connecting
+                void SetMessageFilter(std::shared_ptr<const message_filter<T>> pFilter)
+                {
+                    m_pFilter = std::move(pFilter);
+                }
+
+                //Limit how fast the remote may send, see rate_limits. Frames are charged as
+                //their header arrives, before anything is allocated or queued for them.
+                //Set it before connecting
+                void SetRateLimits(std::shared_ptr<const rate_limits<T>> pLimits)
+                {
+                    m_rate.reset(std::move(pLimits));
+                }
+
+                //Keep only the latest queued message per key for the IDs in pConflation,
+                //see conflation. Set it before connecting
+                void SetConflation(std::shared_ptr<const conflation<T>> pConflation)
+                {
+                    m_qMessagesOut.set_conflation(std::move(pConflation));
+                }
+
+                //Only meaningful while the asio thread is idle, or for a rough reading
+                const io_stats& GetIOStats() const
+                {
+                    return m_stats;
+                }
+
+                //Messages with this ID dropped from the outgoing queue for their deadline,
+                //same caveat as GetIOStats()
+                uint64_t GetExpiredCount(T id) const
+                {
+                    return m_qMessagesOut.expired(id);
+                }
+
+                //True if the connection runs over TCP rather than a local socket
+                bool IsTcp() const
+                {
+                    boost::system::error_code ec;
+                    int nFamily = m_socket.local_endpoint(ec).protocol().family();
+                    return !ec && (nFamily == AF_INET || nFamily == AF_INET6);
+                }
             public:
             // ASYNC - Send a message, connections are one-to-one so no need to specifiy
 			// the target, for a client, the target is the server and vice versa
-                void Send(const message<T>& msg)
+            // The message goes out after everything queued in higher lanes, see
+            // send_priority
+                void Send(const message<T>& msg, send_priority nPriority = send_priority::interactive)
                 {
                     boost::asio::post(m_asioContext,
-                    [this, msg]()
+                    [this, msg, nPriority]()
                     {
                         // If the queue has a message in it, then we must 
 						// assume that it is in the process of asynchronously being written.
 						// Either way add the message to the queue to be output. If no messages
 						// were available to be written, then start the process of writing the
 						// message at the front of the queue.
+                        // Nothing is written until the handshake is over, the queue is
+                        // flushed once it is.
                         bool bWritingMessage=!m_qMessagesOut.empty();
-                        m_qMessagesOut.push_back(msg);
-                        if(!bWritingMessage)
+                        m_qMessagesOut.push(msg, nPriority);
+                        OnQueued();
+                        if(!bWritingMessage && m_bHandshakeDone)
                         {
                             WriteHeader();
                         }
                     }
                     );
                 }
+
+            // ASYNC - Send a message shared with other connections, e.g. one published to
+            // many clients. The body is written from pMsg itself, never copied
+                void Send(std::shared_ptr<const message<T>> pMsg, send_priority nPriority = send_priority::interactive)
+                {
+                    boost::asio::post(m_asioContext,
+                    [this, pMsg = std::move(pMsg), nPriority]() mutable
+                    {
+                        bool bWritingMessage=!m_qMessagesOut.empty();
+                        m_qMessagesOut.push(std::move(pMsg), nPriority);
+                        OnQueued();
+                        if(!bWritingMessage && m_bHandshakeDone)
+                            WriteHeader();
+                    });
+                }
+
+            // ASYNC - Send state as a snapshot on the stream for its message ID, as a
+            // delta against the last one the remote acked when that is smaller, see
+            // net_snapshot.h. The remote's OnMessage gets the whole state, rebuilt. Each
+            // connection keeps its own baseline, so a new one starts with a full state.
+            // Only servers send snapshots, a server refuses them like a filtered frame.
+            // The state is encoded and numbered on the asio thread as it is queued, so
+            // snapshots from any number of threads go out in sequence order. The frame
+            // keeps the state's deadline, and conflates by the state's key
+                void SendSnapshot(const message<T>& state, send_priority nPriority = send_priority::interactive)
+                {
+                    boost::asio::post(m_asioContext,
+                    [this, state, nPriority]()
+                    {
+                        message<T> frame;
+                        {
+                            std::scoped_lock lock(m_muxSnapshots);
+                            frame = m_mapSnapshotsOut[wire::IdValue(state.header.id)].encode(state);
+                        }
+                        frame.deadline = state.deadline;
+                        (wire::Get(frame.body.data() + 4, 4) == 0 ? m_stats.nSnapshotsFull : m_stats.nSnapshotsDelta)++;
+                        m_stats.nSnapshotBytes += frame.size();
+
+                        bool bWritingMessage=!m_qMessagesOut.empty();
+                        m_qMessagesOut.push(frame, nPriority, nullptr, wire::snapshot, &state);
+                        OnQueued();
+                        if(!bWritingMessage && m_bHandshakeDone)
+                            WriteHeader();
+                    });
+                }
+
+            // ASYNC - Bring a remote that joined late up to date with pState. It goes out
+            // in chunks of up to nChunk bytes on the bulk lane, and only one chunk is
+            // queued at a time, so the asio thread copies a chunk per write rather than
+            // the whole state at once. Messages already queued are written first, and
+            // everything sent after this call is held back until the last chunk is
+            // written, then follows in order. The remote receives the state as one
+            // message. Meant for once per connection, as it joins
+                void SendBootstrap(std::shared_ptr<const message<T>> pState, size_t nChunk = 64 * 1024)
+                {
+                    boost::asio::post(m_asioContext,
+                    [this, pState = std::move(pState), nChunk]() mutable
+                    {
+                        bool bWritingMessage=!m_qMessagesOut.empty();
+                        m_dqBootstraps.push_back({ std::move(pState), std::max<size_t>(nChunk, 1) });
+                        m_qMessagesOut.hold();
+                        PumpBootstrap();
+                        if(!bWritingMessage && m_bHandshakeDone)
+                            WriteHeader();
+                    });
+                }
+
+            // ASYNC - Send a control frame with sBody as its body, ahead of any data
+                void SendControl(control nCode, const std::string& sBody)
+                {
+                    message<T> msg;
+                    msg.header.id = static_cast<T>(static_cast<std::underlying_type_t<T>>(nCode));
+                    msg.body.resize(sBody.size());
+                    std::memcpy(msg.body.data(), sBody.data(), sBody.size());
+                    msg.header.size = msg.size();
+
+                    boost::asio::post(m_asioContext,
+                    [this, msg]()
+                    {
+                        bool bWritingMessage=!m_qMessagesOut.empty();
+                        m_qMessagesOut.push_ahead(msg, send_priority::control, nullptr, wire::control);
+                        if(!bWritingMessage && m_bHandshakeDone)
+                            WriteHeader();
+                    });
+                }
             private:
                 //ASYNC - Prime context ready to read a message header
                 void ReadHeader()
                 {
+                    if(m_pRecvPool)
+                    {
+                        ReadBatch();
+                        return;
+                    }
+
                     // If this function is called, we are expecting asio to wait until it receives
 				// enough bytes to form a header of a message. We know the headers are a fixed
 				// size, so allocate a transmission buffer large enough to store it. In fact, 
 				// we will construct the message in a "temporary" message object as it's 
 				// convenient to work with.
-                    boost::asio::async_read(m_socket,boost::asio::buffer(&m_msgTemporaryIn.header, sizeof(message_header<T>)),
+                    m_stats.nReads++;
+                    AsyncRead(boost::asio::buffer(m_aHeaderIn.data(), FirstHeaderRead()),
                     [this](std::error_code ec, std::size_t length)
                     {
                         if(!ec)
                         {
-                            // A complete message header has been read, check if this message
-							// has a body to follow...
-                            if(m_msgTemporaryIn.header.size>0)
-                            {
-                                // ...it does, so allocate enough space in the messages' body
-								// vector, and issue asio with the task to read the body.
-                                m_msgTemporaryIn.body.resize(m_msgTemporaryIn.header.size);
-                                ReadBody();
-                            }
+                            // A compact header only says how long it is in its first bytes,
+                            // so the rest of it may still have to be read
+                            size_t nRest = wire::Length(m_aHeaderIn.data(), CompactHeaders()) - length;
+                            if(nRest > 0)
+                                ReadHeaderRest(nRest);
                             else
-                            {
-                                // it doesn't, so add this bodyless message to the connections
-								// incoming message queue
-                                AddToIncomingMessageQueue();
-                            }
+                                OnHeaderRead();
                         }
                         else
                         {
                             // Reading form the client went wrong, most likely a disconnect
 							// has occurred. Close the socket and let the system tidy it up later.
                             std::cout<<"["<<id<<"] Read Header Fail.\n";
-                            m_socket.close();
+                            CloseSocket();
                         }
                     }
                     );
                 }
 
+                //ASYNC - Read the remainder of a compact header
+                void ReadHeaderRest(size_t nBytes)
+                {
+                    m_stats.nReads++;
+                    AsyncRead(boost::asio::buffer(m_aHeaderIn.data() + wire::nPrefix, nBytes),
+                    [this](std::error_code ec, std::size_t length)
+                    {
+                        if(!ec)
+                        {
+                            OnHeaderRead();
+                        }
+                        else
+                        {
+                            std::cout<<"["<<id<<"] Read Header Fail.\n";
+                            CloseSocket();
+                        }
+                    });
+                }
+
+                //A complete wire header is in m_aHeaderIn, decide what to do with its body
+                void OnHeaderRead()
+                {
+                    if(!wire::Decode(m_aHeaderIn.data(), CompactHeaders(), m_msgTemporaryIn.header, &m_nFlagsIn))
+                    {
+                        std::cout<<"["<<id<<"] Bad Frame Version.\n";
+                        CloseSocket();
+                    }
+                    // A complete message header has been read, make sure we want it
+                    // before committing any memory to its body
+                    else if(!AcceptFrame(m_msgTemporaryIn.header))
+                    {
+                        if(DropRejected())
+                            DiscardBody(m_msgTemporaryIn.header.size + TrailerSize());
+                        else
+                            CloseSocket();
+                    }
+                    // Over its rate budget, the body stays in the socket while we wait
+                    else if(auto verdict = ChargeFrame(m_msgTemporaryIn.header); verdict != rate_meter<T>::verdict::pass)
+                    {
+                        if(verdict == rate_meter<T>::verdict::delay)
+                            PauseReads([this](){ OnHeaderRead(); });
+                        else if(verdict == rate_meter<T>::verdict::drop)
+                            DiscardBody(m_msgTemporaryIn.header.size + TrailerSize());
+                        else
+                            CloseSocket();
+                    }
+                    // Views want the body in a pooled block, if it fits in one
+                    else if(m_fnOnView && m_msgTemporaryIn.header.size > 0 && m_msgTemporaryIn.header.size <= m_pViewPool->BlockSize())
+                    {
+                        ReadBodyPooled();
+                    }
+                    // Otherwise check if this message has a body (or a trailer) to follow...
+                    else if(m_msgTemporaryIn.header.size + TrailerSize() > 0)
+                    {
+                        // ...it does, so allocate enough space in the messages' body
+								// vector, and issue asio with the task to read the body.
+                        m_msgTemporaryIn.body.resize(m_msgTemporaryIn.header.size);
+                        ReadBody();
+                    }
+                    else
+                    {
+                        // it doesn't, so add this bodyless message to the connections
+								// incoming message queue
+                        m_msgTemporaryIn.body.clear();
+                        AddToIncomingMessageQueue();
+                    }
+                }
+
                 //ASYNC - Prime context ready to read a message body
                 void ReadBody()
                 {
                     // If this function is called, a header has already been read, and that header
 				// request we read a body, The space for that body has already been allocated
 				// in the temporary message object, so just wait for the bytes to arrive...
-                    boost::asio::async_read(m_socket, boost::asio::buffer(m_msgTemporaryIn.body.data(),m_msgTemporaryIn.body.size()),
+                    std::array<boost::asio::mutable_buffer, 2> buffers = {
+                        boost::asio::buffer(m_msgTemporaryIn.body.data(),m_msgTemporaryIn.body.size()),
+                        boost::asio::buffer(m_aTrailerIn.data(), TrailerSize()) };
+                    m_stats.nReads++;
+                    AsyncRead(buffers,
                     [this](std::error_code ec, std::size_t length)
                     {
                         if(!ec)
                         {
                             // ...and they have! The message is now complete, so add
 							// the whole message to incoming queue
-                            AddToIncomingMessageQueue();
+                            if(VerifyTrailer(m_aHeaderIn.data(), m_msgTemporaryIn.body.data(), m_msgTemporaryIn.body.size(), m_aTrailerIn.data()))
+                                AddToIncomingMessageQueue();
+                            else
+                                CloseSocket();
                         }
                         else
                         {
                             //As above!
                             std::cout<<"["<<id<<"] Read Body Fail.\n";
-                            m_socket.close();
+                            CloseSocket();
                         }
                     }
                     );
@@ -200,10 +802,34 @@ namespace olc
                 //ASYNC - Prime context to write a message header
                 void WriteHeader()
                 {
+                    if(m_pShm)
+                    {
+                        WriteSharedMemory();
+                        return;
+                    }
+
+                    if(m_pRecvPool)
+                    {
+                        WriteBatch();
+                        return;
+                    }
+
                     // If this function is called, we know the outgoing message queue must have 
-				// at least one message to send. So allocate a transmission buffer to hold
-				// the message, and issue the work - asio, send these bytes
-                    boost::asio::async_write(m_socket, boost::asio::buffer(&m_qMessagesOut.front().header, sizeof(message_header<T>)),
+				// at least one message to send, unless every one left has expired. So allocate
+				// a transmission buffer to hold the message, and issue the work - asio, send these bytes
+                    if(ClaimOutgoing(1) == 0)
+                        return;
+                    const message<T>& msg = m_qMessagesOut.front();
+                    size_t nHeader = wire::Encode(msg.header, CompactHeaders(), m_aHeadersOut.data(), m_qMessagesOut.claimed_flags(0));
+                    if(FrameChecksums())
+                        EncodeTrailer(m_aHeadersOut.data(), nHeader, msg.body.data(), msg.body.size(), m_aTrailersOut.data());
+
+                    //a bodyless frame takes its trailer along, otherwise WriteBody() does
+                    std::array<boost::asio::const_buffer, 2> buffers = {
+                        boost::asio::buffer(m_aHeadersOut.data(), nHeader),
+                        boost::asio::buffer(m_aTrailersOut.data(), msg.body.empty() ? TrailerSize() : 0) };
+                    m_stats.nWrites++;
+                    AsyncWrite(buffers,
                     [this](std::error_code ec, std::size_t length)
                     {
                         // asio has now sent the bytes - if there was a problem
@@ -222,6 +848,7 @@ namespace olc
                                 // ...it didnt, so we are done with this message. Remove it from 
 								// the outgoing message queue
                                 m_qMessagesOut.pop_front();
+                                OnMessagesWritten(1);
 
                                 // If the queue is not empty, there are more messages to send, so
 								// make this happen by issuing the task to send the next header.
@@ -239,7 +866,7 @@ namespace olc
 							// socket. When a future attempt to write to this client fails due
 							// to the closed socket, it will be tidied up.
                             std::cout<<"["<<id<<"] Write Header Fail.\n";
-                            m_socket.close();
+                            CloseSocket();
                         }
                     }
                     );
@@ -251,7 +878,11 @@ namespace olc
                     // If this function is called, a header has just been sent, and that header
 				// indicated a body existed for this message. Fill a transmission buffer
 				// with the body data, and send it!
-                    boost::asio::async_write(m_socket, boost::asio::buffer(m_qMessagesOut.front().body.data(),m_qMessagesOut.front().body.size()),
+                    std::array<boost::asio::const_buffer, 2> buffers = {
+                        boost::asio::buffer(m_qMessagesOut.front().body.data(),m_qMessagesOut.front().body.size()),
+                        boost::asio::buffer(m_aTrailersOut.data(), TrailerSize()) };
+                    m_stats.nWrites++;
+                    AsyncWrite(buffers,
                     [this](std::error_code ec,std::size_t length)
                     {
                         if(!ec)
@@ -259,6 +890,7 @@ namespace olc
                             // Sending was successful, so we are done with the message
 							// and remove it from the queue
                             m_qMessagesOut.pop_front();
+                            OnMessagesWritten(1);
                             // If the queue still has messages in it, then issue the task to 
 							// send the next messages' header.
                             if(!m_qMessagesOut.empty())
@@ -270,30 +902,1047 @@ namespace olc
                         {
                             // Sending failed, see WriteHeader() equivalent for description
                             std::cout<<"["<<id<<"] Write Body Fail.\n";
-                            m_socket.close();
+                            CloseSocket();
                         }
                     }
                     );
                 }
-                // Once a full message is received, add it to the incoming queue
-                void AddToIncomingMessageQueue()
+                //ASYNC - View counterpart of ReadBody(), the body goes straight into a
+                //block from the pool and the view handed out keeps the block
+                void ReadBodyPooled()
                 {
-                    // Shove it in queue, converting it to an "owned message", by initialising
-				// with the a shared pointer from this connection object
-                    if(m_nOwnerType == owner::server)
-                        m_qMessagesIn.push_back({this->shared_from_this(), m_msgTemporaryIn});
-                    else
-                        m_qMessagesIn.push_back({nullptr,m_msgTemporaryIn});
-                        // We must now prime the asio context to receive the next message. It 
-				// wil just sit and wait for bytes to arrive, and the message construction
-				// process repeats itself.
-                    ReadHeader();
-                }
-
-                //"encrypt" data
-            uint64_t scramble(uint64_t nInput){
+                    m_pViewBlock = m_pViewPool->Acquire();
+                    std::array<boost::asio::mutable_buffer, 2> buffers = {
+                        boost::asio::buffer(m_pViewBlock->data, m_msgTemporaryIn.header.size),
+                        boost::asio::buffer(m_aTrailerIn.data(), TrailerSize()) };
+                    m_stats.nReads++;
+                    AsyncRead(buffers,
+                    [this](std::error_code ec, std::size_t length)
+                    {
+                        if(!ec)
+                        {
+                            const uint8_t* pBody = m_pViewBlock->data;
+                            size_t nBody = m_msgTemporaryIn.header.size;
+                            if(!VerifyTrailer(m_aHeaderIn.data(), pBody, nBody, m_aTrailerIn.data()))
+                            {
+                                CloseSocket();
+                                return;
+                            }
 
-                uint64_t out = nInput ^ 0xDEADBEEFC0DECAFE;
+                            message_view<T> view(m_msgTemporaryIn.header, std::shared_ptr<const uint8_t>(std::move(m_pViewBlock), pBody), nBody);
+                            DeliverView(view);
+                            ReadHeader();
+                        }
+                        else
+                        {
+                            std::cout<<"["<<id<<"] Read Body Fail.\n";
+                            CloseSocket();
+                        }
+                    });
+                }
+
+                //ASYNC - Read and throw away the body of a rejected frame, a chunk at a time
+                void DiscardBody(size_t nBytes)
+                {
+                    if(nBytes == 0)
+                    {
+                        ReadHeader();
+                        return;
+                    }
+
+                    size_t n = std::min(nBytes, DiscardBuffer().size());
+                    m_stats.nReads++;
+                    AsyncRead(boost::asio::buffer(m_vDiscard.data(), n),
+                    [this, nBytes, n](std::error_code ec, std::size_t length)
+                    {
+                        if(!ec)
+                        {
+                            DiscardBody(nBytes - n);
+                        }
+                        else
+                        {
+                            std::cout<<"["<<id<<"] Read Body Fail.\n";
+                            CloseSocket();
+                        }
+                    });
+                }
+
+                // Once a full message is received, add it to the incoming queue
+                void AddToIncomingMessageQueue()
+                {
+                    // Shove it in queue, converting it to an "owned message", by initialising
+				// with the a shared pointer from this connection object
+                    QueueIncoming(m_msgTemporaryIn);
+                        // We must now prime the asio context to receive the next message. It 
+				// wil just sit and wait for bytes to arrive, and the message construction
+				// process repeats itself.
+                    ReadHeader();
+                }
+
+                //ASYNC - Batched counterpart of ReadHeader()/ReadBody(). Read whatever the
+                //socket has into the receive block, as many frames as fit at once
+                void ReadBatch()
+                {
+                    if(!m_pRecvBlock)
+                    {
+                        m_pRecvBlock = m_pRecvPool->Acquire();
+                        m_nRecvBegin = m_nRecvEnd = 0;
+                    }
+
+                    m_stats.nReads++;
+                    AsyncReadSome(boost::asio::buffer(m_pRecvBlock->data + m_nRecvEnd, m_pRecvBlock->capacity - m_nRecvEnd),
+                    [this](std::error_code ec, std::size_t length)
+                    {
+                        if(!ec)
+                        {
+                            m_nRecvEnd += length;
+                            ParseBatch();
+                        }
+                        else
+                        {
+                            std::cout<<"["<<id<<"] Read Batch Fail.\n";
+                            CloseSocket();
+                        }
+                    });
+                }
+
+                //Cut every complete frame out of the receive block, then go back for more
+                void ParseBatch()
+                {
+                    const size_t nTrailer = TrailerSize();
+
+                    //the rest of a rejected body may have arrived with this read
+                    size_t nSkip = std::min(m_nRecvDiscard, m_nRecvEnd - m_nRecvBegin);
+                    m_nRecvBegin += nSkip;
+                    m_nRecvDiscard -= nSkip;
+
+                    while(m_nRecvEnd - m_nRecvBegin >= wire::nPrefix)
+                    {
+                        uint8_t* pFrame = m_pRecvBlock->data + m_nRecvBegin;
+                        const size_t nHeader = wire::Length(pFrame, CompactHeaders());
+                        if(m_nRecvEnd - m_nRecvBegin < nHeader)
+                            break;
+
+                        if(!wire::Decode(pFrame, CompactHeaders(), m_msgTemporaryIn.header, &m_nFlagsIn))
+                        {
+                            std::cout<<"["<<id<<"] Bad Frame Version.\n";
+                            CloseSocket();
+                            return;
+                        }
+                        size_t nBody = m_msgTemporaryIn.header.size;
+                        size_t nAvailable = m_nRecvEnd - m_nRecvBegin - nHeader;
+
+                        bool bWanted = AcceptFrame(m_msgTemporaryIn.header);
+                        if(!bWanted && !DropRejected())
+                        {
+                            CloseSocket();
+                            return;
+                        }
+
+                        //a frame is parsed again each time more of it arrives, but only
+                        //charged the first time
+                        if(bWanted && !m_bFrameCharged)
+                        {
+                            auto verdict = ChargeFrame(m_msgTemporaryIn.header);
+                            if(verdict == rate_meter<T>::verdict::delay)
+                            {
+                                PauseReads([this](){ ParseBatch(); });
+                                return;
+                            }
+                            if(verdict == rate_meter<T>::verdict::disconnect)
+                            {
+                                CloseSocket();
+                                return;
+                            }
+                            bWanted = verdict == rate_meter<T>::verdict::pass;
+                            m_bFrameCharged = bWanted;
+                        }
+
+                        if(!bWanted)
+                        {
+                            //step over the body, whatever hasn't arrived yet is skipped
+                            //as it comes in
+                            nSkip = std::min(nBody + nTrailer, nAvailable);
+                            m_nRecvBegin += nHeader + nSkip;
+                            m_nRecvDiscard = nBody + nTrailer - nSkip;
+                        }
+                        else if(nBody + nTrailer <= nAvailable)
+                        {
+                            m_bFrameCharged = false;
+                            if(!VerifyTrailer(pFrame, pFrame + nHeader, nBody, pFrame + nHeader + nBody))
+                            {
+                                CloseSocket();
+                                return;
+                            }
+                            m_nRecvBegin += nHeader + nBody + nTrailer;
+
+                            if(m_fnOnView)
+                            {
+                                //no copy at all, the view shares the receive block
+                                message_view<T> view(m_msgTemporaryIn.header, std::shared_ptr<const uint8_t>(m_pRecvBlock, pFrame + nHeader), nBody);
+                                DeliverView(view);
+                            }
+                            else
+                            {
+                                m_msgTemporaryIn.body.assign(pFrame + nHeader, pFrame + nHeader + nBody);
+                                QueueIncoming(m_msgTemporaryIn);
+                            }
+                        }
+                        else if(nHeader + nBody + nTrailer > m_pRecvBlock->capacity)
+                        {
+                            //The frame can never fit in a block, so take what has arrived
+                            //and read the rest of the body straight into the message. The
+                            //header and trailer bytes are kept aside for the checksum
+                            m_bFrameCharged = false;
+                            size_t nCopy = std::min(nBody, nAvailable);
+                            size_t nTrailerHave = nAvailable - nCopy;
+                            m_msgTemporaryIn.body.resize(nBody);
+                            std::memcpy(m_msgTemporaryIn.body.data(), pFrame + nHeader, nCopy);
+                            std::memcpy(m_aHeaderIn.data(), pFrame, nHeader);
+                            std::memcpy(m_aTrailerIn.data(), pFrame + nHeader + nCopy, nTrailerHave);
+                            m_nRecvBegin = m_nRecvEnd = 0;
+                            if(m_pRecvBlock.use_count() > 1)
+                                m_pRecvBlock.reset();   //views still point into it
+
+                            std::array<boost::asio::mutable_buffer, 2> buffers = {
+                                boost::asio::buffer(m_msgTemporaryIn.body.data() + nCopy, nBody - nCopy),
+                                boost::asio::buffer(m_aTrailerIn.data() + nTrailerHave, nTrailer - nTrailerHave) };
+                            m_stats.nReads++;
+                            AsyncRead(buffers,
+                            [this](std::error_code ec, std::size_t length)
+                            {
+                                if(!ec && !VerifyTrailer(m_aHeaderIn.data(), m_msgTemporaryIn.body.data(), m_msgTemporaryIn.body.size(), m_aTrailerIn.data()))
+                                {
+                                    CloseSocket();
+                                }
+                                else if(!ec)
+                                {
+                                    QueueIncoming(m_msgTemporaryIn);
+                                    ReadBatch();
+                                }
+                                else
+                                {
+                                    std::cout<<"["<<id<<"] Read Body Fail.\n";
+                                    CloseSocket();
+                                }
+                            });
+                            return;
+                        }
+                        else
+                        {
+                            break;
+                        }
+                    }
+
+                    //Views still point into the block, so carry the partial frame over to a
+                    //fresh one rather than overwrite what they see
+                    if(m_nRecvBegin > 0 && m_pRecvBlock.use_count() > 1)
+                    {
+                        auto pBlock = m_pRecvPool->Acquire();
+                        std::memcpy(pBlock->data, m_pRecvBlock->data + m_nRecvBegin, m_nRecvEnd - m_nRecvBegin);
+                        m_pRecvBlock = std::move(pBlock);
+                        m_nRecvEnd -= m_nRecvBegin;
+                        m_nRecvBegin = 0;
+                    }
+
+                    //Move the partial frame, if any, to the front of the block
+                    if(m_nRecvBegin > 0)
+                    {
+                        //the last view may have gone on another thread, see its writes first
+                        std::atomic_thread_fence(std::memory_order_acquire);
+                        std::memmove(m_pRecvBlock->data, m_pRecvBlock->data + m_nRecvBegin, m_nRecvEnd - m_nRecvBegin);
+                        m_nRecvEnd -= m_nRecvBegin;
+                        m_nRecvBegin = 0;
+                    }
+                    ReadBatch();
+                }
+
+                //ASYNC - Batched counterpart of WriteHeader()/WriteBody(). Every queued
+                //message goes out in one gathered write
+                void WriteBatch()
+                {
+                    //a frame with a trailer takes three buffers rather than two
+                    const size_t nTrailer = TrailerSize();
+                    const size_t nMaxCount = nTrailer ? nMaxWriteBatch * 2 / 3 : nMaxWriteBatch;
+
+                    m_vWriteBuffers.clear();
+                    size_t nCount = ClaimOutgoing(nMaxCount);
+                    if(nCount == 0)
+                        return;
+                    for(size_t i = 0; i < nCount; i++)
+                    {
+                        const message<T>& msg = m_qMessagesOut.claimed(i);
+                        uint8_t* pHeader = m_aHeadersOut.data() + i * wire::nMaxHeader;
+                        size_t nHeader = wire::Encode(msg.header, CompactHeaders(), pHeader, m_qMessagesOut.claimed_flags(i));
+                        m_vWriteBuffers.push_back(boost::asio::buffer(pHeader, nHeader));
+                        if(!msg.body.empty())
+                            m_vWriteBuffers.push_back(boost::asio::buffer(msg.body.data(), msg.body.size()));
+                        if(nTrailer)
+                        {
+                            uint8_t* pTrailer = m_aTrailersOut.data() + i * nTrailer;
+                            EncodeTrailer(pHeader, nHeader, msg.body.data(), msg.body.size(), pTrailer);
+                            m_vWriteBuffers.push_back(boost::asio::buffer(pTrailer, nTrailer));
+                        }
+                    }
+
+                    m_stats.nWrites++;
+                    AsyncWrite(m_vWriteBuffers,
+                    [this, nCount](std::error_code ec, std::size_t length)
+                    {
+                        if(!ec)
+                        {
+                            for(size_t i = 0; i < nCount; i++)
+                                m_qMessagesOut.pop_front();
+                            OnMessagesWritten(nCount);
+
+                            if(!m_qMessagesOut.empty())
+                                WriteBatch();
+                        }
+                        else
+                        {
+                            std::cout<<"["<<id<<"] Write Batch Fail.\n";
+                            CloseSocket();
+                        }
+                    });
+                }
+
+                //Socket I/O goes through these, so TLS can sit between the framing and
+                //the socket
+                template <typename Buffers, typename Token>
+                auto AsyncRead(const Buffers& buffers, Token&& token)
+                {
+#if defined(OLC_NET_TLS)
+                    if(m_pTls)
+                        return boost::asio::async_read(*m_pTls, buffers, std::forward<Token>(token));
+#endif
+                    return boost::asio::async_read(m_socket, buffers, std::forward<Token>(token));
+                }
+
+                template <typename Buffers, typename Token>
+                auto AsyncReadSome(const Buffers& buffers, Token&& token)
+                {
+#if defined(OLC_NET_TLS)
+                    if(m_pTls)
+                        return m_pTls->async_read_some(buffers, std::forward<Token>(token));
+#endif
+                    return m_socket.async_read_some(buffers, std::forward<Token>(token));
+                }
+
+                template <typename Buffers, typename Token>
+                auto AsyncWrite(const Buffers& buffers, Token&& token)
+                {
+#if defined(OLC_NET_TLS)
+                    //TLS writes one buffer at a time, each a record of its own, so a
+                    //gathered write is copied into one buffer first
+                    if(m_pTls)
+                    {
+                        m_vTlsOut.resize(boost::asio::buffer_size(buffers));
+                        boost::asio::buffer_copy(boost::asio::buffer(m_vTlsOut), buffers);
+                        return boost::asio::async_write(*m_pTls, boost::asio::buffer(m_vTlsOut), std::forward<Token>(token));
+                    }
+#endif
+                    return boost::asio::async_write(m_socket, buffers, std::forward<Token>(token));
+                }
+
+                //ASYNC - Do the TLS handshake, if enabled, then carry on with fnNext
+                void StartTls(std::function<void()> fnNext)
+                {
+#if defined(OLC_NET_TLS)
+                    if(m_pTls && IsTcp() && m_pTlsContext->KernelOffload())
+                    {
+                        StartKernelTls(std::move(fnNext));
+                        return;
+                    }
+
+                    if(m_pTls)
+                    {
+                        bool bServer = m_nOwnerType == owner::server;
+                        if(!bServer)
+                            m_pTlsContext->Prepare(m_pTls->native_handle());
+
+                        m_pTls->async_handshake(bServer ? boost::asio::ssl::stream_base::server : boost::asio::ssl::stream_base::client,
+                        [this, fnNext](std::error_code ec)
+                        {
+                            if(!ec)
+                            {
+                                m_bTlsResumed = SSL_session_reused(m_pTls->native_handle());
+                                fnNext();
+                            }
+                            else
+                            {
+                                std::cout<<"["<<id<<"] TLS Handshake Fail: "<<ec.message()<<"\n";
+                                CloseSocket();
+                            }
+                        });
+                        return;
+                    }
+#endif
+                    fnNext();
+                }
+
+#if defined(OLC_NET_TLS)
+                //ASYNC - kTLS handshake. asio's TLS stream keeps OpenSSL away from the
+                //socket, so here OpenSSL runs the handshake on the socket itself, which
+                //lets it hand the session keys to the kernel with setsockopt(SOL_TLS).
+                //From then on the connection reads and writes plaintext on the socket,
+                //gathered writes included. TLS 1.2 only: OpenSSL 3.0 offloads TLS 1.3
+                //sends but not receives
+                void StartKernelTls(std::function<void()> fnNext)
+                {
+                    m_pTls.reset();
+                    m_pKtls.reset(SSL_new(m_pTlsContext->native().native_handle()));
+                    SSL* pSsl = m_pKtls.get();
+                    SSL_set_fd(pSsl, int(m_socket.native_handle()));
+                    SSL_set_options(pSsl, SSL_OP_ENABLE_KTLS);
+                    SSL_set_max_proto_version(pSsl, TLS1_2_VERSION);
+                    SSL_set_cipher_list(pSsl, "ECDHE+AESGCM:ECDHE+CHACHA20");
+
+                    if(m_nOwnerType == owner::server)
+                        SSL_set_accept_state(pSsl);
+                    else
+                    {
+                        SSL_set_connect_state(pSsl);
+                        m_pTlsContext->Prepare(pSsl);
+                    }
+
+                    m_socket.native_non_blocking(true);
+                    StepKernelTls(std::move(fnNext));
+                }
+
+                //ASYNC - Push the handshake as far as it goes, then wait for the socket
+                void StepKernelTls(std::function<void()> fnNext)
+                {
+                    SSL* pSsl = m_pKtls.get();
+                    int nResult = SSL_do_handshake(pSsl);
+                    if(nResult == 1)
+                    {
+                        m_socket.native_non_blocking(false);
+                        if(!BIO_get_ktls_send(SSL_get_wbio(pSsl)) || !BIO_get_ktls_recv(SSL_get_rbio(pSsl)))
+                        {
+                            //OpenSSL has started the session in user space and the socket
+                            //can't be switched back to asio's stream
+                            std::cout<<"["<<id<<"] kTLS Setup Fail.\n";
+                            CloseSocket();
+                            return;
+                        }
+
+                        m_bTlsResumed = SSL_session_reused(pSsl);
+                        fnNext();
+                        return;
+                    }
+
+                    int nError = SSL_get_error(pSsl, nResult);
+                    if(nError == SSL_ERROR_WANT_READ || nError == SSL_ERROR_WANT_WRITE)
+                    {
+                        m_socket.async_wait(nError == SSL_ERROR_WANT_READ ? socket_type::wait_read : socket_type::wait_write,
+                        [this, fnNext](std::error_code ec)
+                        {
+                            if(!ec)
+                                StepKernelTls(fnNext);
+                            else
+                                CloseSocket();
+                        });
+                        return;
+                    }
+
+                    std::cout<<"["<<id<<"] TLS Handshake Fail.\n";
+                    CloseSocket();
+                }
+#endif
+
+                bool CompactHeaders() const
+                {
+                    return m_nFeatures & feature::compact_header;
+                }
+
+                bool FrameChecksums() const
+                {
+                    return m_nFeatures & feature::frame_checksum;
+                }
+
+                size_t TrailerSize() const
+                {
+                    return FrameChecksums() ? wire::nTrailer : 0;
+                }
+
+                //Write the checksum of an encoded header and its body to pTrailer
+                void EncodeTrailer(const uint8_t* pHeader, size_t nHeader, const uint8_t* pBody, size_t nBody, uint8_t* pTrailer) const
+                {
+                    wire::Put(pTrailer, crc32c(pBody, nBody, crc32c(pHeader, nHeader)), wire::nTrailer);
+                }
+
+                //False, and counted, if the frame's trailer doesn't match its bytes. The
+                //caller drops the connection, as the frame boundaries can't be trusted
+                bool VerifyTrailer(const uint8_t* pHeader, const uint8_t* pBody, size_t nBody, const uint8_t* pTrailer)
+                {
+                    if(!FrameChecksums())
+                        return true;
+
+                    uint32_t nCrc = crc32c(pBody, nBody, crc32c(pHeader, wire::Length(pHeader, CompactHeaders())));
+                    if(nCrc == uint32_t(wire::Get(pTrailer, wire::nTrailer)))
+                        return true;
+
+                    m_stats.nCorrupt++;
+                    std::cout<<"["<<id<<"] Corrupt Frame.\n";
+                    return false;
+                }
+
+                //Bytes to read before the length of a wire header is known
+                size_t FirstHeaderRead() const
+                {
+                    return CompactHeaders() ? wire::nPrefix : wire::nMaxHeader;
+                }
+
+                //False if the filter turns the frame away, the caller then skips its body
+                //or drops the connection as DropRejected() says. Control frames are up to
+                //the control handler instead, and must be small. Servers take no snapshots
+                bool AcceptFrame(const message_header<T>& header)
+                {
+                    bool bAccept = IsControlIn()
+                        ? m_fnOnControl && header.size <= nMaxControlBody
+                        : !m_pFilter || m_pFilter->accepts(header);
+
+                    //snapshots only go from servers to clients
+                    if(IsSnapshotIn() && m_nOwnerType == owner::server)
+                        bAccept = false;
+                    if(!bAccept)
+                        m_stats.nRejected++;
+                    return bAccept;
+                }
+
+                bool DropRejected() const
+                {
+                    return !m_pFilter || m_pFilter->on_reject() == message_filter<T>::action::drop;
+                }
+
+                //The frame being read is a control frame
+                bool IsControlIn() const
+                {
+                    return (m_nFlagsIn & wire::control) != 0;
+                }
+
+                //Hand a control frame to the control handler, true if the frame was one
+                bool DeliverControl(const message_header<T>& header, const uint8_t* pBody, size_t nBody)
+                {
+                    if(!IsControlIn())
+                        return false;
+                    if(control(wire::IdValue(header.id)) == control::snapshot_ack)
+                    {
+                        if(nBody == 8)
+                            OnSnapshotAck(uint32_t(wire::Get(pBody, 4)), uint32_t(wire::Get(pBody + 4, 4)));
+                        return true;
+                    }
+                    m_fnOnControl(this->shared_from_this(), control(wire::IdValue(header.id)), std::string(reinterpret_cast<const char*>(pBody), nBody));
+                    return true;
+                }
+
+                //The frame being read is a snapshot frame
+                bool IsSnapshotIn() const
+                {
+                    return (m_nFlagsIn & wire::snapshot) != 0;
+                }
+
+                //The frame being read continues in the next one
+                bool IsFragmentIn() const
+                {
+                    return (m_nFlagsIn & wire::fragment) != 0;
+                }
+
+                //Client side - gather a message that came in fragments, such as a
+                //bootstrap, see wire::nFragmentHeader. False while msg was only a part,
+                //true once it holds the whole message or if it was never fragmented.
+                //Servers take no fragments
+                bool Reassemble(message<T>& msg)
+                {
+                    if(m_nOwnerType == owner::server)
+                        return true;
+
+                    //a frame from outside the stream ends it, the pieces so far are no good
+                    if(!IsFragmentIn())
+                    {
+                        if(m_nFragmentTagIn != 0)
+                            DropFragments();
+                        return true;
+                    }
+
+                    if(msg.body.size() < wire::nFragmentHeader)
+                    {
+                        DropFragments();
+                        return false;
+                    }
+                    const uint32_t nTag = uint32_t(wire::Get(msg.body.data(), 4));
+                    const size_t nTotal = size_t(wire::Get(msg.body.data() + 4, 4));
+                    const size_t nPiece = msg.body.size() - wire::nFragmentHeader;
+                    if(nTag != m_nFragmentTagIn || nTotal != m_nFragmentTotalIn)
+                    {
+                        //a new stream, any before it was cut short
+                        DropFragments();
+                        if(nTag == 0)
+                            return false;
+                        m_nFragmentTagIn = nTag;
+                        m_nFragmentTotalIn = nTotal;
+                    }
+                    if(m_vFragmentsIn.size() + nPiece > nTotal)
+                    {
+                        DropFragments();
+                        return false;
+                    }
+
+                    m_vFragmentsIn.insert(m_vFragmentsIn.end(), msg.body.data() + wire::nFragmentHeader, msg.body.data() + msg.body.size());
+                    if(m_vFragmentsIn.size() < nTotal)
+                        return false;
+
+                    //from here on msg is the whole message, not a piece
+                    m_nFlagsIn &= ~wire::fragment;
+
+                    //a plain vector body takes the gathered bytes over without a copy
+                    if constexpr(std::is_same_v<typename message_body<T>::type, std::vector<uint8_t>>)
+                        msg.body.swap(m_vFragmentsIn);
+                    else
+                        msg.body.assign(m_vFragmentsIn.data(), m_vFragmentsIn.data() + m_vFragmentsIn.size());
+                    msg.header.size = msg.size();
+                    DropFragments();
+                    return true;
+                }
+
+                void DropFragments()
+                {
+                    std::vector<uint8_t>().swap(m_vFragmentsIn);
+                    m_nFragmentTagIn = 0;
+                    m_nFragmentTotalIn = 0;
+                }
+
+                //Rebuild the state a snapshot frame carries into msg and ack it. False if
+                //it can't be, the remote is then asked to start over and msg is dropped
+                bool DecodeSnapshot(message<T>& msg)
+                {
+                    m_nFlagsIn &= ~wire::snapshot;
+                    const uint32_t nId = wire::IdValue(msg.header.id);
+                    const uint32_t nSeq = m_mapSnapshotsIn[nId].decode(msg);
+
+                    std::string sAck(8, '\0');
+                    wire::Put(reinterpret_cast<uint8_t*>(sAck.data()), nId, 4);
+                    wire::Put(reinterpret_cast<uint8_t*>(sAck.data()) + 4, nSeq, 4);
+                    SendControl(control::snapshot_ack, sAck);
+                    return nSeq != 0;
+                }
+
+                //Server side - the remote has rebuilt snapshot nSeq, or lost track if 0
+                void OnSnapshotAck(uint32_t nId, uint32_t nSeq)
+                {
+                    std::scoped_lock lock(m_muxSnapshots);
+                    auto it = m_mapSnapshotsOut.find(nId);
+                    if(it == m_mapSnapshotsOut.end())
+                        return;
+                    if(nSeq == 0)
+                        it->second.reset();
+                    else
+                        it->second.ack(nSeq);
+                }
+
+                //Charge a frame the filter let through to the rate limits. On delay,
+                //m_tRateWait says for how long
+                typename rate_meter<T>::verdict ChargeFrame(const message_header<T>& header)
+                {
+                    if(!m_rate)
+                        return rate_meter<T>::verdict::pass;
+
+                    auto verdict = m_rate.charge(header, m_tRateWait, !IsControlIn());
+                    if(verdict != rate_meter<T>::verdict::pass)
+                        m_stats.nOverLimit++;
+                    if(verdict == rate_meter<T>::verdict::delay)
+                        m_stats.nThrottledUs += std::chrono::duration_cast<std::chrono::microseconds>(m_tRateWait).count();
+                    return verdict;
+                }
+
+                //ASYNC - Stop reading for m_tRateWait, then carry on with fnResume
+                void PauseReads(std::function<void()> fnResume)
+                {
+                    m_timerRate.expires_after(m_tRateWait);
+                    m_timerRate.async_wait([this, fnResume](std::error_code ec)
+                    {
+                        if(!ec && m_socket.is_open())
+                            fnResume();
+                    });
+                }
+
+                //Scratch space rejected bodies are read into, only allocated if needed
+                std::vector<uint8_t>& DiscardBuffer()
+                {
+                    if(m_vDiscard.empty())
+                        m_vDiscard.resize(4096);
+                    return m_vDiscard;
+                }
+
+                //Hand a view to the inline view handler
+                void DeliverView(message_view<T>& view)
+                {
+                    if(DeliverControl(view.header, view.data(), view.size()))
+                        return;
+                    if(IsSnapshotIn() || (m_nOwnerType == owner::client && (IsFragmentIn() || m_nFragmentTagIn != 0)))
+                    {
+                        //the message is rebuilt into a body of its own
+                        message<T> msg = view.to_message();
+                        QueueIncoming(msg);
+                        return;
+                    }
+                    DispatchView(view);
+                }
+
+                //Hand a whole message, already past reassembly and decoding, to the view handler
+                void DispatchView(message_view<T>& view)
+                {
+                    m_stats.nMessagesIn++;
+                    m_fnOnView(m_nOwnerType == owner::server ? this->shared_from_this() : nullptr, view);
+                }
+
+                void QueueIncoming(message<T>& msg)
+                {
+                    if(DeliverControl(msg.header, msg.body.data(), msg.body.size()))
+                        return;
+                    if(!Reassemble(msg))
+                        return;
+                    if(IsSnapshotIn() && !DecodeSnapshot(msg))
+                        return;
+
+                    //a body that could not go into a pooled block, the view takes it over
+                    if(m_fnOnView)
+                    {
+                        std::shared_ptr<const uint8_t> pBody;
+                        size_t nSize = msg.body.size();
+                        if(nSize > 0)
+                        {
+                            auto pOwned = std::make_shared<typename message_body<T>::type>(std::move(msg.body));
+                            pBody = std::shared_ptr<const uint8_t>(pOwned, pOwned->data());
+                        }
+                        message_view<T> view(msg.header, std::move(pBody), nSize);
+                        DispatchView(view);
+                        return;
+                    }
+
+                    m_stats.nMessagesIn++;
+
+                    //inline dispatch, hand the message over right here on the reading thread
+                    if(m_fnOnMessage)
+                    {
+                        m_fnOnMessage(m_nOwnerType == owner::server ? this->shared_from_this() : nullptr, msg);
+                        return;
+                    }
+
+                    if(m_nOwnerType == owner::server)
+                        m_qMessagesIn.push_back({this->shared_from_this(), msg});
+                    else
+                        m_qMessagesIn.push_back({nullptr,msg});
+                }
+
+                // The handshake is over, anything queued up meanwhile can go out now
+                void OnHandshakeComplete()
+                {
+                    m_bHandshakeDone = true;
+                    if(!m_qMessagesOut.empty())
+                        WriteHeader();
+                    Signal();
+                }
+
+                //A message replaced by a newer one with the same key counts as sent, so an
+                //AsyncSend() waiting on it completes
+                void OnQueued()
+                {
+                    if(m_qMessagesOut.conflated() != m_stats.nConflated)
+                    {
+                        m_stats.nConflated = m_qMessagesOut.conflated();
+                        Signal();
+                    }
+                }
+
+                //Claims queued messages for the writer, dropping the expired ones. An
+                //AsyncSend() of a dropped message completes as well
+                size_t ClaimOutgoing(size_t nMax)
+                {
+                    size_t nCount = m_qMessagesOut.claim(nMax);
+                    if(m_qMessagesOut.expired() != m_stats.nExpired)
+                    {
+                        m_stats.nExpired = m_qMessagesOut.expired();
+                        Signal();
+                    }
+                    return nCount;
+                }
+
+                void OnMessagesWritten(size_t nCount)
+                {
+                    m_stats.nMessagesOut += nCount;
+                    PumpBootstrap();
+                    Signal();
+                }
+
+                //Queue the next chunk of a bootstrap once the queue has drained, so the
+                //one before it is written and nothing queued earlier can fall between
+                //chunks. After the last, the messages held back meanwhile are let go
+                void PumpBootstrap()
+                {
+                    if(!m_qMessagesOut.held() || !m_qMessagesOut.empty())
+                        return;
+
+                    while(!m_dqBootstraps.empty())
+                    {
+                        bootstrap& b = m_dqBootstraps.front();
+                        const message<T>& state = *b.pState;
+                        if(b.bLast)
+                        {
+                            m_dqBootstraps.pop_front();
+                            continue;
+                        }
+
+                        if(b.nSent == 0 && ++m_nFragmentTagOut == 0)
+                            m_nFragmentTagOut = 1;
+
+                        size_t n = std::min(b.nChunk, state.body.size() - b.nSent);
+                        message<T> chunk;
+                        chunk.header.id = state.header.id;
+                        chunk.body.resize(wire::nFragmentHeader + n);
+                        wire::Put(chunk.body.data(), m_nFragmentTagOut, 4);
+                        wire::Put(chunk.body.data() + 4, state.body.size(), 4);
+                        if(n > 0)
+                            std::memcpy(chunk.body.data() + wire::nFragmentHeader, state.body.data() + b.nSent, n);
+                        chunk.header.size = chunk.size();
+                        b.nSent += n;
+                        b.bLast = b.nSent == state.body.size();
+
+                        m_qMessagesOut.push_ahead(chunk, send_priority::bulk, nullptr, wire::fragment);
+                        return;
+                    }
+                    m_qMessagesOut.release();
+                }
+
+                //Every error path ends up here, the connection is finished with
+                void CloseSocket()
+                {
+                    FinishHandshake(handshake_result::failed);
+                    //a client refused before the server opened its region leaves the name behind
+                    if(m_pShm)
+                        m_pShm->Unlink();
+                    bool bWasOpen = m_socket.is_open();
+                    m_socket.close();
+                    Signal();
+
+                    //a completion may run after the server has let go of the connection
+                    if(bWasOpen && m_fnOnClose)
+                        if(auto self = this->weak_from_this().lock())
+                            m_fnOnClose(self);
+                }
+
+                //Server only - the handshake has this long to finish, from TLS to validation
+                void StartHandshakeTimer()
+                {
+                    m_bHandshaking = true;
+                    if(m_tHandshakeTimeout.count() <= 0)
+                        return;
+
+                    m_timerHandshake.expires_after(m_tHandshakeTimeout);
+                    m_timerHandshake.async_wait([this](std::error_code ec)
+                    {
+                        if(!ec && m_bHandshaking)
+                        {
+                            std::cout<<"["<<id<<"] Handshake Timeout\n";
+                            FinishHandshake(handshake_result::timed_out);
+                            CloseSocket();
+                        }
+                    });
+                }
+
+                //Server only - report the end of the handshake, the first call counts
+                void FinishHandshake(handshake_result nResult)
+                {
+                    if(!m_bHandshaking)
+                        return;
+
+                    m_bHandshaking = false;
+                    m_timerHandshake.cancel();
+                    if(m_fnHandshakeDone)
+                        m_fnHandshakeDone(nResult);
+                }
+
+                //Wake any coroutine waiting on this connection's state to change
+                void Signal()
+                {
+                    if(m_nSignalWaiters > 0)
+                        m_timerSignal.cancel();
+                }
+
+                //Switch the connection over to the shared memory rings. The socket stays
+                //open purely to notice when the other side goes away
+                void StartSharedMemory()
+                {
+                    bool bServer = m_nOwnerType == owner::server;
+                    m_shmOut = m_pShm->Outgoing(bServer);
+                    m_shmIn = m_pShm->Incoming(bServer);
+
+                    m_bShmRunning = true;
+                    //a server's connection may be let go of while the reader is busy in
+                    //OnMessage(), so the reader keeps it alive until it returns
+                    m_threadShm = std::thread([this, self = this->weak_from_this().lock()](){ ReadSharedMemory(); });
+
+                    //no bytes are expected on the socket any more, only an error or end of file
+                    boost::asio::async_read(m_socket, boost::asio::buffer(&m_nSocketWatch, sizeof(m_nSocketWatch)),
+                    [this](std::error_code ec, std::size_t length)
+                    {
+                        std::cout<<"["<<id<<"] Shared Memory Peer Gone.\n";
+                        StopSharedMemory();
+                        CloseSocket();
+                    });
+                }
+
+                void StopSharedMemory()
+                {
+                    if(m_bShmRunning.exchange(false))
+                        m_shmIn.wake();
+                }
+
+                //Runs on its own thread - frames are assembled straight out of the incoming
+                //ring and queued like any other message
+                void ReadSharedMemory()
+                {
+                    message<T> msg;
+                    std::array<uint8_t, wire::nMaxHeader> aHeader;
+                    while(ReadSharedBytes(aHeader.data(), wire::nPrefix))
+                    {
+                        if(!ReadSharedBytes(aHeader.data() + wire::nPrefix, wire::Length(aHeader.data(), CompactHeaders()) - wire::nPrefix))
+                            break;
+
+                        if(!wire::Decode(aHeader.data(), CompactHeaders(), msg.header, &m_nFlagsIn))
+                        {
+                            std::cout<<"["<<id<<"] Bad Frame Version.\n";
+                            StopSharedMemory();
+                            Disconnect();
+                            break;
+                        }
+
+                        //this thread has nothing else to do, so waiting for the rate
+                        //limits is a plain sleep
+                        bool bWanted = AcceptFrame(msg.header);
+                        auto verdict = bWanted ? ChargeFrame(msg.header) : rate_meter<T>::verdict::pass;
+                        for(; verdict == rate_meter<T>::verdict::delay; verdict = ChargeFrame(msg.header))
+                            std::this_thread::sleep_for(m_tRateWait);
+
+                        if(!bWanted || verdict != rate_meter<T>::verdict::pass)
+                        {
+                            if(bWanted ? verdict == rate_meter<T>::verdict::disconnect : !DropRejected())
+                            {
+                                std::cout<<"["<<id<<"] Rejected Frame.\n";
+                                StopSharedMemory();
+                                Disconnect();
+                                break;
+                            }
+
+                            //nothing else reads on this connection, so the scratch buffer
+                            //is ours
+                            bool bSkipped = true;
+                            for(size_t nLeft = msg.header.size; bSkipped && nLeft > 0; )
+                            {
+                                size_t n = std::min(nLeft, DiscardBuffer().size());
+                                bSkipped = ReadSharedBytes(m_vDiscard.data(), n);
+                                nLeft -= n;
+                            }
+                            if(!bSkipped)
+                                break;
+                            continue;
+                        }
+
+                        //views get the body copied out of the ring into a pooled block
+                        if(m_fnOnView && msg.header.size > 0 && msg.header.size <= m_pViewPool->BlockSize())
+                        {
+                            auto pBlock = m_pViewPool->Acquire();
+                            if(!ReadSharedBytes(pBlock->data, msg.header.size))
+                                break;
+
+                            const uint8_t* pBody = pBlock->data;
+                            message_view<T> view(msg.header, std::shared_ptr<const uint8_t>(std::move(pBlock), pBody), msg.header.size);
+                            DeliverView(view);
+                            continue;
+                        }
+
+                        msg.body.resize(msg.header.size);
+                        if(msg.header.size>0 && !ReadSharedBytes(msg.body.data(), msg.body.size()))
+                            break;
+
+                        QueueIncoming(msg);
+                    }
+                }
+
+                bool ReadSharedBytes(uint8_t* pDst, size_t nBytes)
+                {
+                    size_t nRead = 0;
+                    while(m_bShmRunning)
+                    {
+                        nRead += m_shmIn.read(pDst + nRead, nBytes - nRead);
+                        if(nRead == nBytes)
+                            return true;
+                        if(m_shmIn.corrupt())
+                        {
+                            std::cout<<"["<<id<<"] Shared Memory Corrupt.\n";
+                            StopSharedMemory();
+                            Disconnect();
+                            return false;
+                        }
+
+                        //bounded, so a peer that died without a wake up is still noticed
+                        m_shmIn.wait(std::chrono::milliseconds(100));
+                    }
+                    return false;
+                }
+
+                //Shared memory counterpart of WriteHeader()/WriteBody(). Copies queued
+                //frames into the outgoing ring, if the ring fills up the rest is retried
+                //shortly rather than blocking the asio thread
+                void WriteSharedMemory()
+                {
+                    while(ClaimOutgoing(1) > 0)
+                    {
+                        const message<T>& msg = m_qMessagesOut.front();
+                        //encoded once per message, a retry carries on from the same bytes
+                        if(m_nShmWritten == 0)
+                            m_nShmHeader = wire::Encode(msg.header, CompactHeaders(), m_aHeadersOut.data(), m_qMessagesOut.claimed_flags(0));
+                        size_t nHeader = m_nShmHeader;
+                        size_t nTotal = nHeader + msg.body.size();
+
+                        while(m_nShmWritten < nTotal)
+                        {
+                            size_t n;
+                            if(m_nShmWritten < nHeader)
+                                n = m_shmOut.write(m_aHeadersOut.data() + m_nShmWritten, nHeader - m_nShmWritten);
+                            else
+                                n = m_shmOut.write(msg.body.data() + (m_nShmWritten - nHeader), nTotal - m_nShmWritten);
+
+                            if(n == 0 && m_shmOut.corrupt())
+                            {
+                                std::cout<<"["<<id<<"] Shared Memory Corrupt.\n";
+                                StopSharedMemory();
+                                CloseSocket();
+                                return;
+                            }
+                            if(n == 0)
+                            {
+                                m_timerShm.expires_after(std::chrono::microseconds(50));
+                                m_timerShm.async_wait([this](std::error_code ec)
+                                {
+                                    if(!ec && IsConnected())
+                                        WriteSharedMemory();
+                                });
+                                return;
+                            }
+                            m_nShmWritten += n;
+                        }
+
+                        m_nShmWritten = 0;
+                        m_qMessagesOut.pop_front();
+                        OnMessagesWritten(1);
+                    }
+                }
+
+                //"encrypt" data
+            uint64_t scramble(uint64_t nInput){
+
+                uint64_t out = nInput ^ 0xDEADBEEFC0DECAFE;
                 out = (out & 0xF0F0F0F0F0F0F0) >> 4 | (out & 0x0F0F0F0F0F0F0F) << 4;
                 return out ^ 0xC0DEFACE12345678;
             }
@@ -301,7 +1950,11 @@ namespace olc
             //ASYNC - used by both client and server to write validation packet
             void WriteValidation(){
 
-                boost::asio::async_write(m_socket, boost::asio::buffer(&m_nHandshakeOut, sizeof(uint64_t)), 
+                //little endian, like the wire header
+                wire::Put(m_aValidationOut.data(), m_nHandshakeOut, 8);
+                wire::Put(m_aValidationOut.data() + 8, m_nFeaturesOut, 4);
+
+                AsyncWrite(boost::asio::buffer(m_aValidationOut), 
                             [this](std::error_code ec, std::size_t length){
 
                                 if(!ec){
@@ -309,20 +1962,55 @@ namespace olc
                                     //validation data sent, clients should sit and wait for a response (or a closure)
                                     if(m_nOwnerType == owner::client){
                                         
-                                        ReadHeader();
+                                        if(m_pShm)
+                                            StartSharedMemory();
+                                        else if(!m_bAwaitable)
+                                            ReadHeader();
+
+                                        OnHandshakeComplete();
                                     }
                                 }else{
-                                    m_socket.close();
+                                    CloseSocket();
                                 }
                             });
             }
 
+            //Server only - the admission decision is in, back on the asio thread
+            void Admit(olc::net::server_interface<T>* server, bool bAdmit){
+
+                //timed out or gone while the server was deciding, or answered twice
+                if(!m_bHandshaking)
+                    return;
+
+                if(!bAdmit){
+                    std::cout << "Client Disconnected (Not Admitted)" << std::endl;
+                    FinishHandshake(handshake_result::refused);
+                    CloseSocket();
+                    return;
+                }
+
+                FinishHandshake(handshake_result::validated);
+                server -> OnClientValidated(this -> shared_from_this()); 
+
+                //sit waiting to receive data now
+                if(m_pShm)
+                    StartSharedMemory();
+                else if(m_bAwaitable)
+                    StartSession();
+                else
+                    ReadHeader();
+
+                OnHandshakeComplete();
+            }
+
             void ReadValidation(olc::net::server_interface<T>* server = nullptr){
 
-                boost::asio::async_read(m_socket, boost::asio::buffer(&m_nHandshakeIn, sizeof(uint64_t)),
+                AsyncRead(boost::asio::buffer(m_aValidationIn),
                             [this, server](std::error_code ec, std::size_t length){
 
                                 if(!ec){
+                                    m_nHandshakeIn = wire::Get(m_aValidationIn.data(), 8);
+                                    m_nFeaturesIn = uint32_t(wire::Get(m_aValidationIn.data() + 8, 4));
                                     
                                     //if we're a server, we're expecting ReadValidation() to read the data that
                                     // -- has been computed by the client 
@@ -333,21 +2021,54 @@ namespace olc
                                         //client has provided valid solution, so allow it to connect properly
                                         if(m_nHandshakeIn == m_nHandshakeCheck){
                                             
+                                            //client may only have asked for what we offered
+                                            m_nFeatures = m_nFeaturesIn & m_nFeaturesOut;
+                                            if(m_nFeatures & feature::shared_memory){
+
+                                                //the client created the region before answering
+                                                uid_t nPeer = 0;
+                                                m_pShm = std::make_unique<shm::region>();
+                                                if(!shm::PeerUid(int(m_socket.native_handle()), nPeer) || !m_pShm->Open(shm::region::Name(m_nHandshakeOut), nPeer)){
+                                                    std::cout << "Client Disconnected (Shared Memory)" << std::endl;
+                                                    CloseSocket();
+                                                    return;
+                                                }
+                                            }
+
                                             std::cout << "Client validated" << std::endl;
-                                            server -> OnClientValidated(this -> shared_from_this()); 
 
-                                            //sit waiting to receive data now
-                                            ReadHeader();
+                                            //the server may take its time to let the client in, the
+                                            //connection stays pending until it answers
+                                            auto self = this -> shared_from_this();
+                                            server -> OnClientAdmission(self, [self, server](bool bAdmit)
+                                            {
+                                                boost::asio::post(self -> m_asioContext, [self, server, bAdmit](){ self -> Admit(server, bAdmit); });
+                                            });
                                         }else{
                                             //client gave incorrect data, so disconnect
                                             std::cout << "Client Disconnected (Fail Validation)" << std::endl;
-                                            m_socket.close();
+                                            CloseSocket();
                                         }
                                     }
                                     else{
                                         //connection to client, so solve puzzle
                                         m_nHandshakeOut = scramble(m_nHandshakeIn);
 
+                                        //take whatever we wanted of what the server offers
+                                        m_nFeatures = m_nFeaturesIn & m_nFeaturesWanted;
+                                        if(m_nFeatures & feature::shared_memory){
+
+                                            //the region must exist before the server reads our answer
+                                            m_pShm = std::make_unique<shm::region>();
+                                            if(!m_pShm->Create(shm::region::Name(m_nHandshakeIn))){
+                                                m_pShm.reset();
+                                                m_nFeatures &= ~uint32_t(feature::shared_memory);
+                                            }
+                                        }
+                                        if(m_pShm)
+                                            m_nFeatures &= ~uint32_t(feature::frame_checksum);
+                                        m_nFeaturesOut = m_nFeatures;
+
                                         //write the result
                                         WriteValidation();
                                     }
@@ -356,7 +2077,7 @@ namespace olc
                                 }else{
                                     //some biggerfailure occured
                                     std::cout << "Client Disconnected (ReadValidation)" << std::endl;
-                                    m_socket.close();
+                                    CloseSocket();
                                 }
                             });
             }
@@ -364,14 +2085,14 @@ namespace olc
 
             protected:
                 //Each connection has a unique socket to a remote
-                boost::asio::ip::tcp::socket m_socket;
+                socket_type m_socket;
 
                 //This context is shared with the whole asio instance
                 boost::asio::io_context& m_asioContext;
 
                 //This queue holds all messages to be sent to the remote side of this
-                //connection
-                tsqueue<message<T>> m_qMessagesOut;  
+                //connection, in priority lanes. It is only ever touched from the asio thread
+                send_queue<T> m_qMessagesOut;  
 
                 //This queue holds all messages that have been recieved from
                 //the remote side of this connection. Note it is a reference
@@ -389,6 +2110,120 @@ namespace olc
             uint64_t m_nHandshakeOut = 0; //what the connection will send outwards
             uint64_t m_nHandshakeIn = 0; //what the connection has received as a result or data to scramble in the first place
             uint64_t m_nHandshakeCheck = 0; //used by the server to perform the comparison to see if the client is valid or not 
+            bool m_bHandshakeDone = false;  //outgoing messages are held back until this is set
+
+                //handshake extensions
+            uint32_t m_nFeaturesOut = 0;    //server: offered, client: accepted
+            uint32_t m_nFeaturesIn = 0;     //what the other side sent
+            uint32_t m_nFeaturesWanted = 0; //client: what the application asked for
+            uint32_t m_nFeatures = 0;       //agreed by both sides
+            std::array<uint8_t, 12> m_aValidationOut{};   //nonce and features as sent
+            std::array<uint8_t, 12> m_aValidationIn{};
+
+                //shared memory transport, only set up when negotiated
+            std::unique_ptr<shm::region> m_pShm;
+            shm::ring m_shmOut;
+            shm::ring m_shmIn;
+            std::thread m_threadShm;
+            std::atomic<bool> m_bShmRunning{false};
+            size_t m_nShmWritten = 0;   //bytes of the front message already in the ring
+            size_t m_nShmHeader = 0;    //length of its encoded header
+            boost::asio::steady_timer m_timerShm;
+            uint8_t m_nSocketWatch = 0;
+
+                //batched socket I/O, only set up when enabled
+            std::shared_ptr<recv_pool> m_pRecvPool;
+            std::shared_ptr<recv_block> m_pRecvBlock;
+            size_t m_nRecvBegin = 0;    //first unparsed byte in the receive block
+            size_t m_nRecvEnd = 0;      //one past the last received byte
+            size_t m_nRecvDiscard = 0;  //bytes of a rejected body still to come
+            std::vector<boost::asio::const_buffer> m_vWriteBuffers;
+            static constexpr size_t nMaxWriteBatch = 32;    //asio gathers at most 64 buffers per write, two a message
+
+                //wire headers, encoded on the way out and decoded on the way in. Batched
+                //writes use one slot per message, the other paths the first
+            std::array<uint8_t, nMaxWriteBatch * wire::nMaxHeader> m_aHeadersOut;
+            std::array<uint8_t, wire::nMaxHeader> m_aHeaderIn;
+
+                //frame checksums, laid out like the headers
+            std::array<uint8_t, nMaxWriteBatch * wire::nTrailer> m_aTrailersOut;
+            std::array<uint8_t, wire::nTrailer> m_aTrailerIn;
+
+            io_stats m_stats;
+
+                //TLS, only set up when enabled
+#if defined(OLC_NET_TLS)
+            using tls_stream = boost::asio::ssl::stream<socket_type&>;
+            std::shared_ptr<tls_context> m_pTlsContext;
+            std::unique_ptr<tls_stream> m_pTls;
+            std::vector<uint8_t> m_vTlsOut;     //gathered writes, flattened
+
+                //kTLS: the session OpenSSL handed to the kernel
+            struct ssl_free { void operator()(SSL* pSsl) const { SSL_free(pSsl); } };
+            std::unique_ptr<SSL, ssl_free> m_pKtls;
+#endif
+            bool m_bTlsResumed = false;
+
+                //frames the application has no use for are turned away before their body
+                //is read, null accepts everything
+            std::shared_ptr<const message_filter<T>> m_pFilter;
+            std::vector<uint8_t> m_vDiscard;
+
+                //inline dispatch, empty when messages go to the incoming queue
+            message_handler m_fnOnMessage;
+
+                //control frames, and the wire flags of the frame being read
+            control_handler m_fnOnControl;
+            close_handler m_fnOnClose;
+            uint8_t m_nFlagsIn = 0;
+            static constexpr size_t nMaxControlBody = 1024;
+
+                //snapshot streams by message ID. Those sent are encoded on the caller's
+                //thread and acked on the asio thread, those received are only touched there
+            std::mutex m_muxSnapshots;
+            std::unordered_map<uint32_t, snapshot_sender<T>> m_mapSnapshotsOut;
+            std::unordered_map<uint32_t, snapshot_receiver<T>> m_mapSnapshotsIn;
+
+                //bootstraps going out, the first one chunk by chunk, and the tag of its
+                //stream. On the client, the stream coming in and its pieces so far
+            struct bootstrap
+            {
+                std::shared_ptr<const message<T>> pState;
+                size_t nChunk;
+                size_t nSent = 0;
+                bool bLast = false;     //the last chunk is queued
+            };
+            std::deque<bootstrap> m_dqBootstraps;
+            uint32_t m_nFragmentTagOut = 0;
+            uint32_t m_nFragmentTagIn = 0;
+            size_t m_nFragmentTotalIn = 0;
+            std::vector<uint8_t> m_vFragmentsIn;
+
+                //inline dispatch of views, with the blocks bodies are read into
+            view_handler m_fnOnView;
+            std::shared_ptr<recv_pool> m_pViewPool;
+            std::shared_ptr<recv_block> m_pViewBlock;   //body being read
+
+                //coroutine support, waiters sleep on a timer that never expires and is
+                //cancelled whenever something they might be waiting for happens
+            bool m_bAwaitable = false;
+            boost::asio::steady_timer m_timerSignal;
+            size_t m_nSignalWaiters = 0;
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+            session_handler m_fnSession;
+#endif
+
+                //server side handshake deadline, and who hears how the handshake ended
+            std::chrono::milliseconds m_tHandshakeTimeout{0};
+            handshake_handler m_fnHandshakeDone;
+            boost::asio::steady_timer m_timerHandshake;
+            bool m_bHandshaking = false;
+
+                //rate limits on incoming frames, metering is off until they are set
+            rate_meter<T> m_rate;
+            typename rate_meter<T>::clock::duration m_tRateWait{};
+            boost::asio::steady_timer m_timerRate;
+            bool m_bFrameCharged = false;   //batched reads: the frame at m_nRecvBegin is paid for
 
             //effectively, the connection object is the glue       
         };
@@ -0,0 +1,98 @@
+#pragma once
+#include "net_common.h"
+
+#include <array>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define OLC_NET_CRC32C_SSE42
+#endif
+
+namespace olc
+{
+    namespace net
+    {
+        // CRC32C (Castagnoli), the checksum behind the frame_checksum feature. Uses the
+        // SSE4.2 crc32 instruction when the CPU has it, slicing-by-8 tables otherwise.
+        // Calls chain: crc32c(b, nb, crc32c(a, na)) is the CRC of a followed by b
+        namespace detail
+        {
+            // Table k advances a byte through k further zero bytes, so eight input
+            // bytes are folded in with eight lookups and no carried dependency
+            inline const std::array<std::array<uint32_t, 256>, 8>& crc32c_tables()
+            {
+                static const auto aTables = []()
+                {
+                    std::array<std::array<uint32_t, 256>, 8> t{};
+                    for(uint32_t i = 0; i < 256; i++)
+                    {
+                        uint32_t c = i;
+                        for(int k = 0; k < 8; k++)
+                            c = (c >> 1) ^ (0x82F63B78 & (0u - (c & 1)));
+                        t[0][i] = c;
+                    }
+                    for(size_t k = 1; k < 8; k++)
+                        for(uint32_t i = 0; i < 256; i++)
+                            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+                    return t;
+                }();
+                return aTables;
+            }
+
+            // Works on the inverted CRC, as do the other variants
+            inline uint32_t crc32c_portable(const uint8_t* p, size_t nBytes, uint32_t crc)
+            {
+                const auto& t = crc32c_tables();
+                for(; nBytes >= 8; p += 8, nBytes -= 8)
+                {
+                    //little endian loads, which compilers turn into plain ones on x86
+                    uint32_t lo = (uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24) ^ crc;
+                    uint32_t hi = uint32_t(p[4]) | uint32_t(p[5]) << 8 | uint32_t(p[6]) << 16 | uint32_t(p[7]) << 24;
+                    crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+                        ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+                }
+                for(; nBytes > 0; p++, nBytes--)
+                    crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+                return crc;
+            }
+
+#if defined(OLC_NET_CRC32C_SSE42)
+            __attribute__((target("sse4.2")))
+            inline uint32_t crc32c_sse42(const uint8_t* p, size_t nBytes, uint32_t crc)
+            {
+                uint64_t c = crc;
+                for(; nBytes >= 8; p += 8, nBytes -= 8)
+                {
+                    uint64_t v;
+                    std::memcpy(&v, p, 8);
+                    c = _mm_crc32_u64(c, v);
+                }
+                crc = uint32_t(c);
+                for(; nBytes > 0; p++, nBytes--)
+                    crc = _mm_crc32_u8(crc, *p);
+                return crc;
+            }
+#endif
+
+            // True if crc32c() runs on the crc32 instruction
+            inline bool crc32c_hardware()
+            {
+#if defined(OLC_NET_CRC32C_SSE42)
+                static const bool bSupported = __builtin_cpu_supports("sse4.2");
+                return bSupported;
+#else
+                return false;
+#endif
+            }
+        }
+
+        inline uint32_t crc32c(const uint8_t* p, size_t nBytes, uint32_t crc = 0)
+        {
+#if defined(OLC_NET_CRC32C_SSE42)
+            if(detail::crc32c_hardware())
+                return ~detail::crc32c_sse42(p, nBytes, ~crc);
+#endif
+            return ~detail::crc32c_portable(p, nBytes, ~crc);
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include "net_common.h"
+#include "net_message.h"
+
+namespace olc
+{
+    namespace net
+    {
+        //Forward declare the connection
+        template <typename T>
+        class connection;
+
+        // The message IDs a connection is willing to accept. It is checked as soon as a
+        // frame header has been read, so a frame that would only be thrown away later
+        // never gets its body allocated.
+        template <typename T>
+        class message_filter
+        {
+            public:
+                // What happens to a frame that fails the check
+                enum class action
+                {
+                    drop,       //skip its body and carry on
+                    disconnect  //treat the remote as broken
+                };
+
+                // nMaxBody of 0 means no limit on body size
+                message_filter(action onReject = action::drop, uint32_t nMaxBody = 0)
+                : m_onReject(onReject), m_nMaxBody(nMaxBody)
+                {
+
+                }
+
+                void allow(T id)
+                {
+                    size_t i = IdSlot(id);
+                    if(i >= m_vAllowed.size())
+                        m_vAllowed.resize(i + 1, false);
+                    m_vAllowed[i] = true;
+                }
+
+                bool accepts(const message_header<T>& header) const
+                {
+                    size_t i = index(header.id);
+                    return i < m_vAllowed.size() && m_vAllowed[i] && (m_nMaxBody == 0 || header.size <= m_nMaxBody);
+                }
+
+                action on_reject() const
+                {
+                    return m_onReject;
+                }
+
+            private:
+                static size_t index(T id)
+                {
+                    return IdIndex(id);
+                }
+
+                std::vector<bool> m_vAllowed;
+                action m_onReject;
+                uint32_t m_nMaxBody;
+        };
+
+        // Dispatch table keyed by the message enum. Handlers are registered per ID and
+        // stored in a flat array indexed by the ID's value, so dispatching is a bounds
+        // check and an indirect call rather than a chain of comparisons. nIds is the
+        // size of the table, IDs must be smaller than it, which on<>() checks at
+        // compile time.
+        template <typename T, size_t nIds = 256>
+        class dispatcher
+        {
+            public:
+                // On a client the remote is always nullptr, it can only be the server
+                using handler = std::function<void(std::shared_ptr<connection<T>>, message<T>&)>;
+
+                template <T id>
+                dispatcher& on(handler fnHandler)
+                {
+                    static_assert(size_t(static_cast<std::underlying_type_t<T>>(id)) < nIds, "Message ID does not fit in the dispatch table");
+                    m_aHandlers[index(id)] = std::move(fnHandler);
+                    return *this;
+                }
+
+                // Call the handler for msg, false (and counted) if there isn't one
+                bool operator()(std::shared_ptr<connection<T>> remote, message<T>& msg)
+                {
+                    size_t i = index(msg.header.id);
+                    if(i >= nIds || !m_aHandlers[i])
+                    {
+                        m_nUnknown++;
+                        return false;
+                    }
+
+                    m_aHandlers[i](std::move(remote), msg);
+                    return true;
+                }
+
+                bool handles(T id) const
+                {
+                    size_t i = index(id);
+                    return i < nIds && m_aHandlers[i];
+                }
+
+                // A filter accepting exactly the IDs with a handler, hand it to the server or
+                // client so unknown frames are turned away at read time
+                std::shared_ptr<const message_filter<T>> filter(typename message_filter<T>::action onReject = message_filter<T>::action::drop, uint32_t nMaxBody = 0) const
+                {
+                    static_assert(nIds <= nMaxIdIndex, "Dispatch table too large for a message filter");
+                    auto pFilter = std::make_shared<message_filter<T>>(onReject, nMaxBody);
+                    for(size_t i = 0; i < nIds; i++)
+                        if(m_aHandlers[i])
+                            pFilter->allow(static_cast<T>(i));
+                    return pFilter;
+                }
+
+                // Messages that reached the dispatcher without a handler
+                uint64_t unknown() const
+                {
+                    return m_nUnknown;
+                }
+
+            private:
+                static size_t index(T id)
+                {
+                    return size_t(static_cast<std::underlying_type_t<T>>(id));
+                }
+
+                std::array<handler, nIds> m_aHandlers;
+                std::atomic<uint64_t> m_nUnknown{0};
+        };
+    }
+}
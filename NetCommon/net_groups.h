@@ -0,0 +1,96 @@
+#pragma once
+#include "net_common.h"
+
+#include <unordered_map>
+
+namespace olc
+{
+    namespace net
+    {
+        // Clients grouped by an ID, such as a room or a match. Each group's members are
+        // a sorted vector, so sending to a group walks contiguous memory and costs the
+        // group's size whatever the number of clients, and joining or leaving is a
+        // binary search and a short move. Every client also lists its groups, so all its
+        // memberships go at once when it leaves. Client is any hashable, ordered handle,
+        // e.g. std::shared_ptr<connection<T>>. Not thread safe
+        template <typename Client>
+        class group_index
+        {
+            public:
+                // False if the client was already a member
+                bool join(uint32_t nGroup, const Client& client)
+                {
+                    auto& vMembers = m_mapGroups[nGroup];
+                    auto it = std::lower_bound(vMembers.begin(), vMembers.end(), client);
+                    if(it != vMembers.end() && *it == client)
+                        return false;
+
+                    vMembers.insert(it, client);
+                    m_mapClients[client].push_back(nGroup);
+                    return true;
+                }
+
+                // False if the client wasn't a member
+                bool leave(uint32_t nGroup, const Client& client)
+                {
+                    if(!Erase(nGroup, client))
+                        return false;
+
+                    auto it = m_mapClients.find(client);
+                    auto& vGroups = it->second;
+                    vGroups.erase(std::find(vGroups.begin(), vGroups.end(), nGroup));
+                    if(vGroups.empty())
+                        m_mapClients.erase(it);
+                    return true;
+                }
+
+                // Take a client out of every group it is in, e.g. once it has gone
+                void remove(const Client& client)
+                {
+                    auto it = m_mapClients.find(client);
+                    if(it == m_mapClients.end())
+                        return;
+
+                    for(uint32_t nGroup : it->second)
+                        Erase(nGroup, client);
+                    m_mapClients.erase(it);
+                }
+
+                // A group's members in order, empty if it has none
+                const std::vector<Client>& members(uint32_t nGroup) const
+                {
+                    static const std::vector<Client> vNone;
+                    auto it = m_mapGroups.find(nGroup);
+                    return it == m_mapGroups.end() ? vNone : it->second;
+                }
+
+                // Groups with at least one member
+                size_t groups() const
+                {
+                    return m_mapGroups.size();
+                }
+
+            private:
+                bool Erase(uint32_t nGroup, const Client& client)
+                {
+                    auto itGroup = m_mapGroups.find(nGroup);
+                    if(itGroup == m_mapGroups.end())
+                        return false;
+
+                    auto& vMembers = itGroup->second;
+                    auto it = std::lower_bound(vMembers.begin(), vMembers.end(), client);
+                    if(it == vMembers.end() || !(*it == client))
+                        return false;
+
+                    vMembers.erase(it);
+                    if(vMembers.empty())
+                        m_mapGroups.erase(itGroup);
+                    return true;
+                }
+
+                std::unordered_map<uint32_t, std::vector<Client>> m_mapGroups;
+                //the groups each member is in
+                std::unordered_map<Client, std::vector<uint32_t>> m_mapClients;
+        };
+    }
+}
@@ -0,0 +1,272 @@
+#pragma once
+#include "net_common.h"
+
+#include <climits>
+#include <cmath>
+#include <unordered_map>
+
+namespace olc
+{
+    namespace net
+    {
+        // A point on the plane the interest grid works in
+        struct grid_position
+        {
+            float x = 0;
+            float y = 0;
+        };
+
+        // Where clients are, for sending only to those near something. Positions are
+        // hashed into square cells, so a radius query only looks at the cells it
+        // overlaps and costs the local density rather than the number of clients. With
+        // update_visibility() each client also keeps the set of clients within a radius,
+        // and every change to it is reported as an enter or a leave. Client is any
+        // hashable handle, e.g. std::shared_ptr<connection<T>>. Not thread safe
+        template <typename Client>
+        class interest_grid
+        {
+            public:
+                // Cells about the size of the usual query radius work best
+                explicit interest_grid(float fCellSize = 64.0f)
+                : m_fCellSize(fCellSize)
+                {
+
+                }
+
+                // Add a client, or move it
+                void set_position(const Client& client, grid_position pos)
+                {
+                    auto [it, bNew] = m_mapSlots.try_emplace(client, 0);
+                    if(bNew)
+                    {
+                        if(m_vFree.empty())
+                        {
+                            it->second = uint32_t(m_vEntries.size());
+                            m_vEntries.emplace_back();
+                        }
+                        else
+                        {
+                            it->second = m_vFree.back();
+                            m_vFree.pop_back();
+                        }
+                        entry& e = m_vEntries[it->second];
+                        e.client = client;
+                        e.bUsed = true;
+                        e.pos = pos;
+                        e.nCell = CellKey(pos);
+                        m_mapCells[e.nCell].push_back(it->second);
+                        return;
+                    }
+
+                    entry& e = m_vEntries[it->second];
+                    e.pos = pos;
+                    uint64_t nCell = CellKey(pos);
+                    if(nCell != e.nCell)
+                    {
+                        Unlink(it->second, e.nCell);
+                        e.nCell = nCell;
+                        m_mapCells[nCell].push_back(it->second);
+                    }
+                }
+
+                // Take a client out. Those that could see it get a leave from the next
+                // update_visibility(). False if it wasn't in
+                bool remove(const Client& client)
+                {
+                    auto it = m_mapSlots.find(client);
+                    if(it == m_mapSlots.end())
+                        return false;
+
+                    uint32_t nSlot = it->second;
+                    entry& e = m_vEntries[nSlot];
+                    Unlink(nSlot, e.nCell);
+
+                    //visibility is symmetric, so its own set names everyone who sees it
+                    for(uint32_t nObserver : e.vVisible)
+                    {
+                        auto& vSeen = m_vEntries[nObserver].vVisible;
+                        *std::find(vSeen.begin(), vSeen.end(), nSlot) = vSeen.back();
+                        vSeen.pop_back();
+                        m_vLeft.push_back({ m_vEntries[nObserver].client, e.client });
+                    }
+
+                    e = entry();
+                    m_vFree.push_back(nSlot);
+                    m_mapSlots.erase(it);
+                    return true;
+                }
+
+                // Call fn(client) for every client within fRadius of pos. Returns how
+                // many there were
+                template <typename Fn>
+                size_t for_each_near(grid_position pos, float fRadius, Fn&& fn) const
+                {
+                    size_t nFound = 0;
+                    VisitNear(pos, fRadius, [&](uint32_t nSlot)
+                    {
+                        nFound++;
+                        fn(m_vEntries[nSlot].client);
+                    });
+                    return nFound;
+                }
+
+                // Work out every client's visible set anew, the clients within fRadius
+                // of it, and report the changes since the last call as fnEnter(observer,
+                // target) and fnLeave(observer, target). Meant to run once per tick
+                template <typename FnEnter, typename FnLeave>
+                void update_visibility(float fRadius, FnEnter&& fnEnter, FnLeave&& fnLeave)
+                {
+                    for(auto& left : m_vLeft)
+                        fnLeave(left.first, left.second);
+                    m_vLeft.clear();
+
+                    //the old set is stamped nStamp, and anything the new one finds is
+                    //raised to nStamp + 1, so neither set needs sorting
+                    m_vStamps.resize(m_vEntries.size());
+                    std::vector<uint32_t> vNow;
+                    for(uint32_t nSlot = 0; nSlot < m_vEntries.size(); nSlot++)
+                    {
+                        entry& e = m_vEntries[nSlot];
+                        if(!e.bUsed)
+                            continue;
+
+                        m_nStamp += 2;
+                        if(m_nStamp < 2)
+                        {
+                            //wrapped, stale stamps could now look current
+                            std::fill(m_vStamps.begin(), m_vStamps.end(), 0);
+                            m_nStamp = 2;
+                        }
+                        const uint32_t nOld = m_nStamp, nKept = m_nStamp + 1;
+                        for(uint32_t nOther : e.vVisible)
+                            m_vStamps[nOther] = nOld;
+
+                        vNow.clear();
+                        VisitNear(e.pos, fRadius, [&](uint32_t nOther)
+                        {
+                            if(nOther == nSlot)
+                                return;
+                            vNow.push_back(nOther);
+                            if(m_vStamps[nOther] == nOld)
+                                m_vStamps[nOther] = nKept;
+                            else
+                                fnEnter(e.client, m_vEntries[nOther].client);
+                        });
+
+                        for(uint32_t nOther : e.vVisible)
+                            if(m_vStamps[nOther] == nOld)
+                                fnLeave(e.client, m_vEntries[nOther].client);
+                        e.vVisible.swap(vNow);
+                    }
+                }
+
+                // Clients the last update_visibility() found near this one
+                size_t visible_count(const Client& client) const
+                {
+                    auto it = m_mapSlots.find(client);
+                    return it == m_mapSlots.end() ? 0 : m_vEntries[it->second].vVisible.size();
+                }
+
+                size_t size() const
+                {
+                    return m_mapSlots.size();
+                }
+
+            private:
+                // Slots are reused but never move, so cells and visible sets can name
+                // clients by slot
+                struct entry
+                {
+                    Client client{};
+                    bool bUsed = false;
+                    grid_position pos;
+                    uint64_t nCell = 0;
+                    std::vector<uint32_t> vVisible;     //slots, in no order
+                };
+
+                // Far off positions share the outermost cells, and NaN gets cell 0,
+                // rather than overflowing the cast
+                int32_t Cell(float f) const
+                {
+                    double d = std::floor(double(f) / m_fCellSize);
+                    if(!(d > double(INT32_MIN)))
+                        return std::isnan(d) ? 0 : INT32_MIN;
+                    return d < double(INT32_MAX) ? int32_t(d) : INT32_MAX;
+                }
+
+                static uint64_t CellKey(int32_t nX, int32_t nY)
+                {
+                    return (uint64_t(uint32_t(nX)) << 32) | uint32_t(nY);
+                }
+
+                uint64_t CellKey(grid_position pos) const
+                {
+                    return CellKey(Cell(pos.x), Cell(pos.y));
+                }
+
+                void Unlink(uint32_t nSlot, uint64_t nCell)
+                {
+                    auto it = m_mapCells.find(nCell);
+                    auto& vSlots = it->second;
+                    *std::find(vSlots.begin(), vSlots.end(), nSlot) = vSlots.back();
+                    vSlots.pop_back();
+                    if(vSlots.empty())
+                        m_mapCells.erase(it);
+                }
+
+                template <typename Fn>
+                void VisitNear(grid_position pos, float fRadius, Fn&& fn) const
+                {
+                    if(!(fRadius >= 0))
+                        return;
+
+                    const float fRadius2 = fRadius * fRadius;
+                    auto visit = [&](const std::vector<uint32_t>& vSlots)
+                    {
+                        for(uint32_t nSlot : vSlots)
+                        {
+                            float dx = m_vEntries[nSlot].pos.x - pos.x;
+                            float dy = m_vEntries[nSlot].pos.y - pos.y;
+                            if(dx * dx + dy * dy <= fRadius2)
+                                fn(nSlot);
+                        }
+                    };
+
+                    const int64_t nX0 = Cell(pos.x - fRadius), nX1 = Cell(pos.x + fRadius);
+                    const int64_t nY0 = Cell(pos.y - fRadius), nY1 = Cell(pos.y + fRadius);
+
+                    //a box with more cells than are occupied is cheaper to check the
+                    //other way round, one occupied cell at a time
+                    if(double(nX1 - nX0 + 1) * double(nY1 - nY0 + 1) > double(m_mapCells.size()))
+                    {
+                        for(auto& [nCell, vSlots] : m_mapCells)
+                        {
+                            int64_t nX = int32_t(uint32_t(nCell >> 32)), nY = int32_t(uint32_t(nCell));
+                            if(nX >= nX0 && nX <= nX1 && nY >= nY0 && nY <= nY1)
+                                visit(vSlots);
+                        }
+                        return;
+                    }
+
+                    for(int64_t nX = nX0; nX <= nX1; nX++)
+                        for(int64_t nY = nY0; nY <= nY1; nY++)
+                        {
+                            auto it = m_mapCells.find(CellKey(int32_t(nX), int32_t(nY)));
+                            if(it != m_mapCells.end())
+                                visit(it->second);
+                        }
+                }
+
+                float m_fCellSize;
+                std::vector<entry> m_vEntries;
+                std::vector<uint32_t> m_vFree;
+                std::unordered_map<Client, uint32_t> m_mapSlots;
+                std::unordered_map<uint64_t, std::vector<uint32_t>> m_mapCells;
+                //scratch marks for update_visibility(), one per slot
+                std::vector<uint32_t> m_vStamps;
+                uint32_t m_nStamp = 0;
+                //leaves owed to observers of removed clients
+                std::vector<std::pair<Client, Client>> m_vLeft;
+        };
+    }
+}
@@ -14,6 +14,180 @@ namespace olc
             uint32_t size=0;
         };
 
+        // Tables kept per message ID, such as filters, rate limits and conflation, are
+        // flat vectors indexed by the ID's value. Configuring one for an ID at
+        // nMaxIdIndex or above throws std::out_of_range rather than allocating for it
+        constexpr size_t nMaxIdIndex = 4096;
+
+        // The ID's value as an index into such a table. Only unsigned IDs, a negative
+        // one would wrap to a huge index
+        template <typename T>
+        size_t IdIndex(T id)
+        {
+            static_assert(std::is_unsigned_v<std::underlying_type_t<T>>, "Message IDs need an unsigned underlying type");
+            return size_t(static_cast<std::underlying_type_t<T>>(id));
+        }
+
+        // IdIndex() for an ID a table is being configured for
+        template <typename T>
+        size_t IdSlot(T id)
+        {
+            size_t i = IdIndex(id);
+            if(i >= nMaxIdIndex)
+                throw std::out_of_range("Message ID too large for a per ID table");
+            return i;
+        }
+
+        // Byte buffer with room for N bytes inside the object itself. A body of up to N
+        // bytes never touches the heap; once it grows past that it moves to a heap
+        // buffer, grown geometrically like a vector. Offers the part of the
+        // std::vector<uint8_t> interface the framework and message operators use.
+        template <size_t N>
+        class small_body
+        {
+            public:
+                using value_type = uint8_t;
+                using size_type = size_t;
+                using iterator = uint8_t*;
+                using const_iterator = const uint8_t*;
+
+                small_body() = default;
+
+                small_body(const small_body& other)
+                {
+                    assign(other.begin(), other.end());
+                }
+
+                small_body(small_body&& other) noexcept
+                {
+                    Steal(other);
+                }
+
+                small_body& operator=(const small_body& other)
+                {
+                    if(this != &other)
+                        assign(other.begin(), other.end());
+                    return *this;
+                }
+
+                small_body& operator=(small_body&& other) noexcept
+                {
+                    if(this != &other)
+                    {
+                        delete[] m_pHeap;
+                        Steal(other);
+                    }
+                    return *this;
+                }
+
+                ~small_body()
+                {
+                    delete[] m_pHeap;
+                }
+
+                size_t size() const { return m_nSize; }
+                size_t capacity() const { return m_pHeap ? m_nCapacity : N; }
+                bool empty() const { return m_nSize == 0; }
+
+                uint8_t* data() { return m_pHeap ? m_pHeap : m_aInline; }
+                const uint8_t* data() const { return m_pHeap ? m_pHeap : m_aInline; }
+
+                iterator begin() { return data(); }
+                iterator end() { return data() + m_nSize; }
+                const_iterator begin() const { return data(); }
+                const_iterator end() const { return data() + m_nSize; }
+
+                uint8_t& operator[](size_t i) { return data()[i]; }
+                const uint8_t& operator[](size_t i) const { return data()[i]; }
+                uint8_t& front() { return data()[0]; }
+                uint8_t& back() { return data()[m_nSize - 1]; }
+
+                void reserve(size_t nCapacity)
+                {
+                    if(nCapacity <= capacity())
+                        return;
+
+                    uint8_t* pHeap = new uint8_t[nCapacity];
+                    std::memcpy(pHeap, data(), m_nSize);
+                    delete[] m_pHeap;
+                    m_pHeap = pHeap;
+                    m_nCapacity = nCapacity;
+                }
+
+                //New bytes are zeroed, as with a vector
+                void resize(size_t nSize, uint8_t nValue = 0)
+                {
+                    if(nSize > m_nSize)
+                    {
+                        Grow(nSize);
+                        std::memset(data() + m_nSize, nValue, nSize - m_nSize);
+                    }
+                    m_nSize = nSize;
+                }
+
+                //Keeps whatever capacity there is, like a vector
+                void clear()
+                {
+                    m_nSize = 0;
+                }
+
+                void assign(const uint8_t* pFirst, const uint8_t* pLast)
+                {
+                    m_nSize = 0;
+                    insert(end(), pFirst, pLast);
+                }
+
+                iterator insert(const_iterator pos, const uint8_t* pFirst, const uint8_t* pLast)
+                {
+                    size_t nOffset = pos - begin();
+                    size_t nCount = pLast - pFirst;
+                    if(nCount == 0)
+                        return begin() + nOffset;
+
+                    Grow(m_nSize + nCount);
+                    uint8_t* p = data() + nOffset;
+                    std::memmove(p + nCount, p, m_nSize - nOffset);
+                    std::memcpy(p, pFirst, nCount);
+                    m_nSize += nCount;
+                    return p;
+                }
+
+            private:
+                void Grow(size_t nSize)
+                {
+                    if(nSize > capacity())
+                        reserve(std::max(nSize, capacity() * 2));
+                }
+
+                void Steal(small_body& other)
+                {
+                    m_nSize = other.m_nSize;
+                    m_nCapacity = other.m_nCapacity;
+                    m_pHeap = other.m_pHeap;
+                    if(!m_pHeap)
+                        std::memcpy(m_aInline, other.m_aInline, m_nSize);
+
+                    other.m_pHeap = nullptr;
+                    other.m_nSize = 0;
+                    other.m_nCapacity = 0;
+                }
+
+                uint8_t* m_pHeap = nullptr;     //set once the body has outgrown m_aInline
+                size_t m_nSize = 0;
+                size_t m_nCapacity = 0;         //of m_pHeap
+                uint8_t m_aInline[N];
+        };
+
+        // Storage type of message<T>::body. A std::vector unless specialised for an ID
+        // type, e.g. to keep the small messages of a protocol off the heap:
+        //     template <> struct olc::net::message_body<MyMsgTypes> { using type = olc::net::small_body<64>; };
+        // The specialisation has to be seen before message<MyMsgTypes> is first used.
+        template <typename T>
+        struct message_body
+        {
+            using type = std::vector<uint8_t>;
+        };
+
         // Message Body contains a header and a std::vector, containing raw bytes
 		// of infomation. This way the message can be variable length, but the size
 		// in the header must be updated.
@@ -22,7 +196,11 @@ namespace olc
         {
             // Header & Body vector
             message_header<T> header{};
-            std::vector<uint8_t> body;
+            typename message_body<T>::type body;
+
+            // Local to this side, never sent. A message still waiting in the outgoing
+            // queue when its deadline passes is dropped instead of written
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
 
             //returns size of entire message packet in bytes
             size_t size() const
@@ -30,6 +208,14 @@ namespace olc
                 return body.size();
             }
 
+            // Give the message tTtl from now to start being written
+            template <typename Rep, typename Period>
+            message<T>& expire_after(std::chrono::duration<Rep, Period> tTtl)
+            {
+                deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(tTtl);
+                return *this;
+            }
+
             //Override for std::cout compatibility - produces friendly description of message
             friend std::ostream& operator << (std::ostream& os,const message<T>& msg)
             {
@@ -87,6 +273,247 @@ namespace olc
                 return msg;
             }
         };
+
+        // Builds a message body front to back. Unlike operator<< the body is not resized
+        // per field - reserve() once and every write is a plain append. Fields come back
+        // out of a message_reader in the order they were written.
+        template <typename T>
+        class message_writer
+        {
+            public:
+                explicit message_writer(message<T>& msg) : m_msg(msg)
+                {
+
+                }
+
+                //Make room for nBytes more so the writes that follow never reallocate
+                message_writer& reserve(size_t nBytes)
+                {
+                    m_msg.body.reserve(m_msg.body.size() + nBytes);
+                    return *this;
+                }
+
+                //Any trivially copyable value, copied as is
+                template <typename DataType>
+                message_writer& write(const DataType& data)
+                {
+                    static_assert(std::is_trivially_copyable<DataType>::value, "Data is too complex to be written into the message");
+                    return write_bytes(&data, sizeof(DataType));
+                }
+
+                //A 32 bit length followed by the characters
+                message_writer& write(const std::string& s)
+                {
+                    write(uint32_t(s.size()));
+                    return write_bytes(s.data(), s.size());
+                }
+
+                //String literals too, rather than as a raw char array
+                message_writer& write(const char* s)
+                {
+                    size_t nLength = std::strlen(s);
+                    write(uint32_t(nLength));
+                    return write_bytes(s, nLength);
+                }
+
+                //A 32 bit element count followed by the elements in one copy
+                template <typename DataType>
+                message_writer& write(const std::vector<DataType>& v)
+                {
+                    static_assert(std::is_trivially_copyable<DataType>::value, "Vector elements are too complex to be written into the message");
+                    write(uint32_t(v.size()));
+                    return write_bytes(v.data(), v.size() * sizeof(DataType));
+                }
+
+                //Raw bytes, no length prefix - the reader has to know how many to expect
+                message_writer& write_bytes(const void* pData, size_t nBytes)
+                {
+                    const uint8_t* p = static_cast<const uint8_t*>(pData);
+                    m_msg.body.insert(m_msg.body.end(), p, p + nBytes);
+                    m_msg.header.size = m_msg.size();
+                    return *this;
+                }
+
+                template <typename DataType>
+                message_writer& operator<<(const DataType& data)
+                {
+                    return write(data);
+                }
+
+            private:
+                message<T>& m_msg;
+        };
+
+        // Reads a message body front to back through a cursor, the message itself is left
+        // untouched. Reading past the end of the body throws std::out_of_range, so a short
+        // or malformed message from the other side can't read beyond its buffer.
+        template <typename T>
+        class message_reader
+        {
+            public:
+                explicit message_reader(const message<T>& msg) : m_pData(msg.body.data()), m_nSize(msg.body.size())
+                {
+
+                }
+
+                //Any body held elsewhere, e.g. by a message_view
+                message_reader(const uint8_t* pData, size_t nSize) : m_pData(pData), m_nSize(nSize)
+                {
+
+                }
+
+                template <typename DataType>
+                message_reader& read(DataType& data)
+                {
+                    static_assert(std::is_trivially_copyable<DataType>::value, "Data is too complex to be read from the message");
+                    return read_bytes(&data, sizeof(DataType));
+                }
+
+                message_reader& read(std::string& s)
+                {
+                    uint32_t nLength = 0;
+                    read(nLength);
+                    s.assign(reinterpret_cast<const char*>(Take(nLength)), nLength);
+                    return *this;
+                }
+
+                template <typename DataType>
+                message_reader& read(std::vector<DataType>& v)
+                {
+                    static_assert(std::is_trivially_copyable<DataType>::value, "Vector elements are too complex to be read from the message");
+                    uint32_t nCount = 0;
+                    read(nCount);
+                    if(nCount > remaining() / sizeof(DataType))
+                        throw std::out_of_range("message_reader: vector runs past the end of the message");
+
+                    v.resize(nCount);
+                    if(nCount > 0)
+                        std::memcpy(v.data(), Take(nCount * sizeof(DataType)), nCount * sizeof(DataType));
+                    return *this;
+                }
+
+                message_reader& read_bytes(void* pData, size_t nBytes)
+                {
+                    std::memcpy(pData, Take(nBytes), nBytes);
+                    return *this;
+                }
+
+                template <typename DataType>
+                DataType read()
+                {
+                    DataType data{};
+                    read(data);
+                    return data;
+                }
+
+                template <typename DataType>
+                message_reader& operator>>(DataType& data)
+                {
+                    return read(data);
+                }
+
+                //Bytes not read yet
+                size_t remaining() const
+                {
+                    return m_nSize - m_nCursor;
+                }
+
+            private:
+                //Claim the next nBytes of the body
+                const uint8_t* Take(size_t nBytes)
+                {
+                    if(nBytes > remaining())
+                        throw std::out_of_range("message_reader: read past the end of the message");
+
+                    const uint8_t* p = m_pData + m_nCursor;
+                    m_nCursor += nBytes;
+                    return p;
+                }
+
+                const uint8_t* m_pData;
+                size_t m_nSize;
+                size_t m_nCursor = 0;
+        };
+
+        // Read-only message that refers to the bytes it was received into instead of
+        // owning a copy of them. Fields are read in place, nothing is allocated. A view
+        // keeps its buffer alive for as long as it exists - a pooled receive block goes
+        // back to its pool once the last view on it is released - so views can be kept,
+        // though holding many pins the blocks they came from.
+        template <typename T>
+        class message_view
+        {
+            public:
+                message_view() = default;
+
+                //Over an owned message, which must outlive the view
+                explicit message_view(const message<T>& msg)
+                : header(msg.header), m_pData(msg.body.data()), m_nSize(msg.body.size())
+                {
+
+                }
+
+                //Over nSize bytes at pData, kept alive by pData itself
+                message_view(const message_header<T>& h, std::shared_ptr<const uint8_t> pData, size_t nSize)
+                : header(h), m_pOwner(std::move(pData)), m_pData(m_pOwner.get()), m_nSize(nSize)
+                {
+
+                }
+
+                message_header<T> header{};
+
+                size_t size() const
+                {
+                    return m_nSize;
+                }
+
+                const uint8_t* data() const
+                {
+                    return m_pData;
+                }
+
+                //The field of type DataType starting nOffset bytes into the body
+                template <typename DataType>
+                DataType get(size_t nOffset) const
+                {
+                    static_assert(std::is_trivially_copyable<DataType>::value, "Data is too complex to be read from the message");
+                    if(nOffset > m_nSize || sizeof(DataType) > m_nSize - nOffset)
+                        throw std::out_of_range("message_view: field runs past the end of the message");
+
+                    DataType data;
+                    std::memcpy(&data, m_pData + nOffset, sizeof(DataType));
+                    return data;
+                }
+
+                //Read the body front to back, as written by a message_writer
+                message_reader<T> reader() const
+                {
+                    return message_reader<T>(m_pData, m_nSize);
+                }
+
+                //An owned copy, for when the message has to be changed or queued
+                message<T> to_message() const
+                {
+                    message<T> msg;
+                    msg.header = header;
+                    msg.body.assign(m_pData, m_pData + m_nSize);
+                    return msg;
+                }
+
+                //Let go of the buffer early
+                void release()
+                {
+                    m_pOwner.reset();
+                    m_pData = nullptr;
+                    m_nSize = 0;
+                }
+
+            private:
+                std::shared_ptr<const uint8_t> m_pOwner;
+                const uint8_t* m_pData = nullptr;
+                size_t m_nSize = 0;
+        };
+
         // An "owned" message is identical to a regular message, but it is associated with
 		// a connection. On a server, the owner would be the client that sent the message, 
 		// on a client the owner would be the server.
@@ -0,0 +1,178 @@
+#pragma once
+#include "net_common.h"
+
+namespace olc
+{
+    namespace net
+    {
+        // A receive block is a fixed size buffer a connection reads socket data into.
+        // Many frames can arrive in one read, they are then cut out of the block.
+        struct recv_block
+        {
+            uint8_t* data = nullptr;
+            size_t capacity = 0;
+        };
+
+        // Pool of receive blocks carved out of one slab, allocated up front and reused
+        // for the lifetime of the pool. Blocks are handed out as shared pointers which
+        // return themselves to the pool when released. The pointers' control blocks are
+        // recycled by the pool as well, so once it is warm Acquire() does not touch the
+        // heap. If the pool runs dry a block is allocated on the heap instead, so a busy
+        // server degrades rather than fails.
+        class recv_pool : public std::enable_shared_from_this<recv_pool>
+        {
+            public:
+                static std::shared_ptr<recv_pool> Create(size_t nBlocks, size_t nBlockSize = 64 * 1024)
+                {
+                    return std::shared_ptr<recv_pool>(new recv_pool(nBlocks, nBlockSize));
+                }
+
+                recv_pool(const recv_pool&) = delete;
+                recv_pool& operator=(const recv_pool&) = delete;
+
+                ~recv_pool()
+                {
+                    for(void* pSlot : m_vSpareSlots)
+                        ::operator delete(pSlot);
+                }
+
+                //Take a block, it goes back to the pool once the last reference is dropped
+                std::shared_ptr<recv_block> Acquire()
+                {
+                    recv_block* pBlock = nullptr;
+                    {
+                        std::scoped_lock lock(m_mux);
+                        if(!m_vFree.empty())
+                        {
+                            pBlock = m_vFree.back();
+                            m_vFree.pop_back();
+                        }
+                    }
+
+                    if(pBlock)
+                    {
+                        //the allocator keeps the pool alive until the control block is gone
+                        return std::shared_ptr<recv_block>(pBlock, [this](recv_block* p){ Release(p); },
+                            slot_allocator<recv_block>(this->shared_from_this()));
+                    }
+
+                    //Pool exhausted, fall back to the heap
+                    m_nOverflows++;
+                    auto* pData = new uint8_t[m_nBlockSize];
+                    return std::shared_ptr<recv_block>(new recv_block{pData, m_nBlockSize}, [](recv_block* p)
+                    {
+                        delete[] p->data;
+                        delete p;
+                    });
+                }
+
+                size_t BlockSize() const
+                {
+                    return m_nBlockSize;
+                }
+
+                //Number of blocks currently sitting in the pool
+                size_t Available()
+                {
+                    std::scoped_lock lock(m_mux);
+                    return m_vFree.size();
+                }
+
+                //Number of times a block had to come from the heap
+                size_t Overflows() const
+                {
+                    return m_nOverflows;
+                }
+
+            private:
+                // Hands the shared pointer control blocks out of the pool's spare slots
+                template <typename U>
+                struct slot_allocator
+                {
+                    using value_type = U;
+
+                    explicit slot_allocator(std::shared_ptr<recv_pool> pPool) : pool(std::move(pPool)) {}
+                    template <typename V>
+                    slot_allocator(const slot_allocator<V>& other) : pool(other.pool) {}
+
+                    U* allocate(size_t n)
+                    {
+                        return static_cast<U*>(pool->AllocateSlot(n * sizeof(U)));
+                    }
+
+                    void deallocate(U* p, size_t n)
+                    {
+                        pool->FreeSlot(p, n * sizeof(U));
+                    }
+
+                    template <typename V>
+                    bool operator==(const slot_allocator<V>& other) const { return pool == other.pool; }
+                    template <typename V>
+                    bool operator!=(const slot_allocator<V>& other) const { return pool != other.pool; }
+
+                    std::shared_ptr<recv_pool> pool;
+                };
+
+                void* AllocateSlot(size_t nBytes)
+                {
+                    if(nBytes > nSlotSize)
+                        return ::operator new(nBytes);
+
+                    {
+                        std::scoped_lock lock(m_mux);
+                        if(!m_vSpareSlots.empty())
+                        {
+                            void* pSlot = m_vSpareSlots.back();
+                            m_vSpareSlots.pop_back();
+                            return pSlot;
+                        }
+                    }
+                    return ::operator new(nSlotSize);
+                }
+
+                void FreeSlot(void* pSlot, size_t nBytes)
+                {
+                    if(nBytes > nSlotSize)
+                    {
+                        ::operator delete(pSlot);
+                        return;
+                    }
+
+                    std::scoped_lock lock(m_mux);
+                    m_vSpareSlots.push_back(pSlot);
+                }
+
+                recv_pool(size_t nBlocks, size_t nBlockSize)
+                : m_nBlockSize(nBlockSize), m_vSlab(nBlocks * nBlockSize), m_vBlocks(nBlocks)
+                {
+                    //one control block per pooled block at most, so neither list ever grows
+                    m_vFree.reserve(nBlocks);
+                    m_vSpareSlots.reserve(nBlocks);
+
+                    for(size_t i = 0; i < nBlocks; i++)
+                    {
+                        m_vBlocks[i] = { m_vSlab.data() + i * nBlockSize, nBlockSize };
+                        m_vFree.push_back(&m_vBlocks[i]);
+                    }
+                }
+
+                void Release(recv_block* pBlock)
+                {
+                    std::scoped_lock lock(m_mux);
+                    m_vFree.push_back(pBlock);
+                }
+
+                size_t m_nBlockSize;
+                std::vector<uint8_t> m_vSlab;
+                std::vector<recv_block> m_vBlocks;
+
+                std::mutex m_mux;
+                std::vector<recv_block*> m_vFree;
+                std::atomic<size_t> m_nOverflows{0};
+
+                //recycled control blocks, big enough for a shared_ptr with deleter and allocator
+                static constexpr size_t nSlotSize = 128;
+                std::vector<void*> m_vSpareSlots;
+        };
+    }
+}
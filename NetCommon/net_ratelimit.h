@@ -0,0 +1,204 @@
+#pragma once
+#include "net_common.h"
+#include "net_message.h"
+
+#include <array>
+
+namespace olc
+{
+    namespace net
+    {
+        // How fast a remote may send, checked as soon as each frame header has been read.
+        // Budgets are token buckets counting frames and body bytes per second: one for all
+        // frames together, and optionally one per message ID charged on top of it. A bucket
+        // holds dBurst seconds worth, so short bursts pass untouched. A frame that doesn't
+        // fit every budget it is charged to gets the action.
+        template <typename T>
+        class rate_limits
+        {
+            public:
+                // What happens to a frame over its budget
+                enum class action
+                {
+                    delay,      //stop reading until the budget allows it, the sender sees backpressure
+                    drop,       //skip its body and carry on
+                    disconnect  //treat the remote as abusive
+                };
+
+                // Per second, zero leaves that side unlimited
+                struct limit
+                {
+                    double dMessages = 0;
+                    double dBytes = 0;
+                };
+
+                rate_limits(action onExceed = action::delay, double dBurst = 1.0)
+                : m_onExceed(onExceed), m_dBurst(dBurst)
+                {
+
+                }
+
+                // Budget shared by every frame
+                rate_limits& total(double dMessages, double dBytes = 0)
+                {
+                    m_total = { dMessages, dBytes };
+                    return *this;
+                }
+
+                // Budget for frames with this ID, charged as well as the total
+                rate_limits& per_id(T id, double dMessages, double dBytes = 0)
+                {
+                    size_t i = IdSlot(id);
+                    if(i >= m_vIds.size())
+                        m_vIds.resize(i + 1);
+                    m_vIds[i] = { dMessages, dBytes };
+                    return *this;
+                }
+
+                const limit& total_limit() const
+                {
+                    return m_total;
+                }
+
+                // Limits by ID value, IDs past the end have none of their own
+                const std::vector<limit>& id_limits() const
+                {
+                    return m_vIds;
+                }
+
+                action on_exceed() const
+                {
+                    return m_onExceed;
+                }
+
+                double burst() const
+                {
+                    return m_dBurst;
+                }
+
+                static size_t index(T id)
+                {
+                    return IdIndex(id);
+                }
+
+            private:
+                limit m_total;
+                std::vector<limit> m_vIds;
+                action m_onExceed;
+                double m_dBurst;
+        };
+
+        // One connection's buckets for a set of rate_limits. Only ever used by the thread
+        // reading the connection
+        template <typename T>
+        class rate_meter
+        {
+            public:
+                using clock = std::chrono::steady_clock;
+
+                enum class verdict
+                {
+                    pass,
+                    delay,      //try again after the wait charge() gave
+                    drop,
+                    disconnect
+                };
+
+                // Start with full buckets, null turns metering off
+                void reset(std::shared_ptr<const rate_limits<T>> pLimits)
+                {
+                    m_pLimits = std::move(pLimits);
+                    m_vBuckets.clear();
+                    if(!m_pLimits)
+                        return;
+
+                    auto now = clock::now();
+                    auto add = [&](double dRate, double dMinimum)
+                    {
+                        double dCapacity = std::max(dRate * m_pLimits->burst(), dMinimum);
+                        m_vBuckets.push_back({ dCapacity, dRate, dCapacity, now });
+                    };
+                    add(m_pLimits->total_limit().dMessages, 1);
+                    add(m_pLimits->total_limit().dBytes, 0);
+                    for(auto& limit : m_pLimits->id_limits())
+                    {
+                        add(limit.dMessages, 1);
+                        add(limit.dBytes, 0);
+                    }
+                }
+
+                explicit operator bool() const
+                {
+                    return m_pLimits != nullptr;
+                }
+
+                // Charge a frame to its buckets if it fits all of them. On delay, tWait
+                // says how long until it will. Frames whose ID isn't a T, such as control
+                // frames, only go against the total
+                verdict charge(const message_header<T>& header, clock::duration& tWait, bool bPerId = true)
+                {
+                    std::array<std::pair<bucket*, double>, 4> aCharges;
+                    size_t nCharges = 0;
+                    auto charge_to = [&](size_t i, double dCost)
+                    {
+                        if(m_vBuckets[i].dRate > 0)
+                            aCharges[nCharges++] = { &m_vBuckets[i], dCost };
+                    };
+                    charge_to(0, 1);
+                    charge_to(1, header.size);
+                    size_t nId = rate_limits<T>::index(header.id);
+                    if(bPerId && 2 + 2 * nId < m_vBuckets.size())
+                    {
+                        charge_to(2 + 2 * nId, 1);
+                        charge_to(3 + 2 * nId, header.size);
+                    }
+
+                    //a frame bigger than a bucket passes once the bucket is full, and
+                    //leaves it in debt
+                    auto now = clock::now();
+                    double dWait = 0;
+                    for(size_t i = 0; i < nCharges; i++)
+                    {
+                        bucket& b = *aCharges[i].first;
+                        b.dTokens = std::min(b.dCapacity, b.dTokens + b.dRate * std::chrono::duration<double>(now - b.tLast).count());
+                        b.tLast = now;
+                        double dNeed = std::min(aCharges[i].second, b.dCapacity);
+                        if(b.dTokens < dNeed)
+                            dWait = std::max(dWait, (dNeed - b.dTokens) / b.dRate);
+                    }
+
+                    if(dWait > 0)
+                    {
+                        switch(m_pLimits->on_exceed())
+                        {
+                            case rate_limits<T>::action::delay:
+                                tWait = std::chrono::ceil<std::chrono::microseconds>(std::chrono::duration<double>(dWait));
+                                return verdict::delay;
+                            case rate_limits<T>::action::drop:
+                                return verdict::drop;
+                            default:
+                                return verdict::disconnect;
+                        }
+                    }
+
+                    for(size_t i = 0; i < nCharges; i++)
+                        aCharges[i].first->dTokens -= aCharges[i].second;
+                    return verdict::pass;
+                }
+
+            private:
+                struct bucket
+                {
+                    double dTokens;
+                    double dRate;
+                    double dCapacity;
+                    clock::time_point tLast;
+                };
+
+                std::shared_ptr<const rate_limits<T>> m_pLimits;
+
+                //all frames (count, bytes), then the same pair for every ID value
+                std::vector<bucket> m_vBuckets;
+        };
+    }
+}
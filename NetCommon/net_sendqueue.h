@@ -0,0 +1,370 @@
+#pragma once
+#include "net_common.h"
+#include "net_message.h"
+
+#include <array>
+#include <unordered_map>
+
+namespace olc
+{
+    namespace net
+    {
+        // Lanes of a connection's outgoing queue, highest first. Within a lane messages
+        // keep the order they were sent in
+        enum class send_priority : uint8_t
+        {
+            control,        //heartbeats, acks, anything that must not wait behind data
+            interactive,    //the default
+            bulk,           //large transfers such as snapshots
+        };
+
+        // Message IDs whose queued messages are only worth sending in their latest
+        // version. Each such ID has a key function, and a message pushed while one with
+        // the same ID and key is still queued replaces it in place
+        template <typename T>
+        class conflation
+        {
+            public:
+                using key_function = std::function<uint64_t(const message<T>&)>;
+
+                // Conflate messages with this ID that have the same fnKey(msg), e.g.
+                // an entity ID read from the body
+                conflation& by_key(T id, key_function fnKey)
+                {
+                    size_t i = IdSlot(id);
+                    if(i >= m_vKeys.size())
+                        m_vKeys.resize(i + 1);
+                    m_vKeys[i] = std::move(fnKey);
+                    return *this;
+                }
+
+                // Conflate all messages with this ID, only the latest one is kept
+                conflation& latest(T id)
+                {
+                    return by_key(id, [](const message<T>&){ return uint64_t(0); });
+                }
+
+                // The key function for this ID, null if its messages don't conflate
+                const key_function* key_for(T id) const
+                {
+                    size_t i = index(id);
+                    return i < m_vKeys.size() && m_vKeys[i] ? &m_vKeys[i] : nullptr;
+                }
+
+                static size_t index(T id)
+                {
+                    return IdIndex(id);
+                }
+
+            private:
+                std::vector<key_function> m_vKeys;
+        };
+
+        // A connection's outgoing messages. The writer claims messages from the front of
+        // the highest lane that has any, and a claimed message stays at the front (in
+        // claim order) until it is popped, whatever is pushed meanwhile, so a message
+        // being written is never disturbed. Bulk is still claimed every so often while
+        // the lanes above are busy, so it can't be starved. A message whose deadline has
+        // passed by the time it would be claimed is dropped instead. With a conflation
+        // set, a waiting message can be replaced by a newer one with the same key, so
+        // the queue holds at most one per key. Only ever touched from the asio thread
+        template <typename T>
+        class send_queue
+        {
+            public:
+                // pDone, if given, is set once the message has left the queue, written,
+                // expired or replaced. A replacement takes the place, lane included, of
+                // the message it replaces. nFlags are wire::flags feature bits for the
+                // frame. pKeyFrom, if given, is the message the conflation key is read
+                // from instead of msg, such as the state a snapshot frame encodes
+                void push(const message<T>& msg, send_priority nPriority, std::shared_ptr<bool> pDone = nullptr, uint8_t nFlags = 0, const message<T>* pKeyFrom = nullptr)
+                {
+                    entry e;
+                    e.msg = msg;
+                    e.pDone = std::move(pDone);
+                    e.nFlags = nFlags;
+                    if(pKeyFrom && m_pConflation)
+                        if(auto* fnKey = m_pConflation->key_for(pKeyFrom->header.id))
+                            e.nKeyFrom = (*fnKey)(*pKeyFrom);
+                    Park(std::move(e), nPriority);
+                }
+
+                // A message shared with other queues, such as one published to many
+                // clients. It is written straight from pMsg, never copied
+                void push(std::shared_ptr<const message<T>> pMsg, send_priority nPriority)
+                {
+                    entry e;
+                    e.pShared = std::move(pMsg);
+                    Park(std::move(e), nPriority);
+                }
+
+                // As push(), but queued even while the queue is held, and never conflated
+                void push_ahead(const message<T>& msg, send_priority nPriority, std::shared_ptr<bool> pDone = nullptr, uint8_t nFlags = 0)
+                {
+                    entry e;
+                    e.msg = msg;
+                    e.pDone = std::move(pDone);
+                    e.nFlags = nFlags;
+                    m_aLanes[size_t(nPriority)].push_back(std::move(e));
+                }
+
+                // Park the messages pushed from now on instead of queueing them, for a
+                // transfer that has to reach the remote before anything sent after it
+                // started. Its own frames go in with push_ahead()
+                void hold()
+                {
+                    m_bHeld = true;
+                }
+
+                // Queue the parked messages in the order they came, as though they were
+                // only now pushed, so they expire and conflate as usual
+                void release()
+                {
+                    m_bHeld = false;
+                    for(auto& parked : m_dqParked)
+                        Push(std::move(parked.first), parked.second);
+                    m_dqParked.clear();
+                }
+
+                bool held() const
+                {
+                    return m_bHeld;
+                }
+
+                // Messages waiting for release()
+                size_t parked() const
+                {
+                    return m_dqParked.size();
+                }
+
+                // Nothing waiting or claimed
+                bool empty() const
+                {
+                    return m_qClaimed.empty() && m_aLanes[0].empty() && m_aLanes[1].empty() && m_aLanes[2].empty();
+                }
+
+                size_t size() const
+                {
+                    return m_qClaimed.size() + m_aLanes[0].size() + m_aLanes[1].size() + m_aLanes[2].size();
+                }
+
+                // Claim messages until nMax are claimed or none are left, returns how
+                // many are claimed. Expired messages met on the way are dropped, so zero
+                // means the queue is empty
+                size_t claim(size_t nMax)
+                {
+                    //the clock is only read once a message with a deadline turns up
+                    std::chrono::steady_clock::time_point tNow;
+                    while(m_qClaimed.size() < nMax)
+                    {
+                        size_t nLane = NextLane();
+                        if(nLane == m_aLanes.size())
+                            break;
+                        entry& e = m_aLanes[nLane].front();
+                        if(e.bKeyed)
+                            m_mapWaiting.erase(e.key);
+                        if(e.get().deadline != std::chrono::steady_clock::time_point::max())
+                        {
+                            if(tNow == std::chrono::steady_clock::time_point())
+                                tNow = std::chrono::steady_clock::now();
+                            if(e.get().deadline <= tNow)
+                            {
+                                Expire(e);
+                                m_aLanes[nLane].pop_front();
+                                continue;
+                            }
+                        }
+                        m_qClaimed.push_back(std::move(e));
+                        m_aLanes[nLane].pop_front();
+                    }
+                    return m_qClaimed.size();
+                }
+
+                // The i-th claimed message
+                const message<T>& claimed(size_t i) const
+                {
+                    return m_qClaimed[i].get();
+                }
+
+                // The wire flags the i-th claimed message is written with
+                uint8_t claimed_flags(size_t i) const
+                {
+                    return m_qClaimed[i].nFlags;
+                }
+
+                // The next message to write, claiming it if need be. claim(1) must not
+                // have come back empty
+                const message<T>& front()
+                {
+                    claim(1);
+                    return m_qClaimed.front().get();
+                }
+
+                // The front claimed message has been written
+                void pop_front()
+                {
+                    Retire(m_qClaimed.front());
+                    m_qClaimed.pop_front();
+                }
+
+                // Messages dropped for their deadline, in total or with this ID
+                uint64_t expired() const
+                {
+                    return m_nExpired;
+                }
+
+                uint64_t expired(T id) const
+                {
+                    size_t i = IdIndex(id);
+                    return i < m_vExpired.size() ? m_vExpired[i] : 0;
+                }
+
+                // Messages replaced by a newer one with the same key
+                uint64_t conflated() const
+                {
+                    return m_nConflated;
+                }
+
+                // Conflate the messages pushed from now on, null turns it off
+                void set_conflation(std::shared_ptr<const conflation<T>> pConflation)
+                {
+                    m_pConflation = std::move(pConflation);
+                }
+
+                // While bulk has messages waiting, every nth claim takes one of them
+                void set_bulk_share(size_t nEvery)
+                {
+                    m_nBulkEvery = std::max<size_t>(nEvery, 1);
+                }
+
+            private:
+                // Message ID value and key
+                struct slot
+                {
+                    size_t nId;
+                    uint64_t nKey;
+
+                    bool operator==(const slot& other) const
+                    {
+                        return nId == other.nId && nKey == other.nKey;
+                    }
+                };
+
+                struct slot_hash
+                {
+                    size_t operator()(const slot& s) const
+                    {
+                        return std::hash<uint64_t>()(s.nKey * 0x9E3779B97F4A7C15ull ^ s.nId);
+                    }
+                };
+
+                struct entry
+                {
+                    message<T> msg;
+                    std::shared_ptr<const message<T>> pShared;  //used instead of msg if set
+                    std::shared_ptr<bool> pDone;
+                    uint8_t nFlags = 0;
+                    bool bKeyed = false;    //listed in m_mapWaiting under key
+                    slot key{};
+                    std::optional<uint64_t> nKeyFrom;   //key read from another message at push
+
+                    const message<T>& get() const
+                    {
+                        return pShared ? *pShared : msg;
+                    }
+                };
+
+                void Park(entry&& e, send_priority nPriority)
+                {
+                    if(m_bHeld)
+                        m_dqParked.emplace_back(std::move(e), nPriority);
+                    else
+                        Push(std::move(e), nPriority);
+                }
+
+                void Push(entry&& e, send_priority nPriority)
+                {
+                    auto& lane = m_aLanes[size_t(nPriority)];
+                    const message<T>& msg = e.get();
+                    auto* fnKey = m_pConflation ? m_pConflation->key_for(msg.header.id) : nullptr;
+                    if(!fnKey)
+                    {
+                        lane.push_back(std::move(e));
+                        return;
+                    }
+
+                    //deque elements stay put while the ends change, so the slot can point
+                    //straight at the waiting entry
+                    slot key{ conflation<T>::index(msg.header.id), e.nKeyFrom ? *e.nKeyFrom : (*fnKey)(msg) };
+                    auto it = m_mapWaiting.find(key);
+                    if(it != m_mapWaiting.end())
+                    {
+                        entry& waiting = *it->second;
+                        Retire(waiting);
+                        waiting.msg = std::move(e.msg);
+                        waiting.pShared = std::move(e.pShared);
+                        waiting.pDone = std::move(e.pDone);
+                        waiting.nFlags = e.nFlags;
+                        m_nConflated++;
+                        return;
+                    }
+                    e.bKeyed = true;
+                    e.key = key;
+                    lane.push_back(std::move(e));
+                    m_mapWaiting.emplace(key, &lane.back());
+                }
+
+                static void Retire(entry& e)
+                {
+                    if(e.pDone)
+                        *e.pDone = true;
+                }
+
+                void Expire(entry& e)
+                {
+                    //only counted by ID for IDs a table could be kept for
+                    size_t i = IdIndex(e.get().header.id);
+                    if(i < nMaxIdIndex)
+                    {
+                        if(i >= m_vExpired.size())
+                            m_vExpired.resize(i + 1);
+                        m_vExpired[i]++;
+                    }
+                    m_nExpired++;
+                    Retire(e);
+                }
+
+                // Highest lane with messages, unless bulk is due its turn. One past the
+                // last lane if all are empty
+                size_t NextLane()
+                {
+                    const size_t nBulk = size_t(send_priority::bulk);
+                    for(size_t i = 0; i < nBulk; i++)
+                    {
+                        if(m_aLanes[i].empty())
+                            continue;
+                        if(m_aLanes[nBulk].empty() || ++m_nBulkSkips < m_nBulkEvery)
+                            return i;
+                        break;
+                    }
+                    m_nBulkSkips = 0;
+                    return m_aLanes[nBulk].empty() ? m_aLanes.size() : nBulk;
+                }
+
+                std::array<std::deque<entry>, 3> m_aLanes;
+                std::deque<entry> m_qClaimed;
+                size_t m_nBulkEvery = 8;
+                size_t m_nBulkSkips = 0;
+                uint64_t m_nExpired = 0;
+                std::vector<uint64_t> m_vExpired;
+
+                std::shared_ptr<const conflation<T>> m_pConflation;
+                //conflated messages still waiting in a lane, by key
+                std::unordered_map<slot, entry*, slot_hash> m_mapWaiting;
+                uint64_t m_nConflated = 0;
+
+                bool m_bHeld = false;
+                std::deque<std::pair<entry, send_priority>> m_dqParked;
+        };
+    }
+}
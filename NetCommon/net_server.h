@@ -4,6 +4,9 @@
 #include "net_tsqueue.h"
 #include "net_message.h"
 #include "net_connection.h"
+#include "net_topics.h"
+#include "net_groups.h"
+#include "net_interest.h"
 
 namespace olc
 {
@@ -13,15 +16,51 @@ namespace olc
         class server_interface
         {
             public:
+                using endpoint_type = typename connection<T>::endpoint_type;
+                using handshake_result = typename connection<T>::handshake_result;
+                using admission_handler = typename connection<T>::admission_handler;
+
+                // Clients between accept and validation, and those turned away on the way
+                struct handshake_stats
+                {
+                    size_t nPending = 0;        //accepted, not yet validated
+                    uint64_t nRejected = 0;     //closed straight after accept, too many pending
+                    uint64_t nTimedOut = 0;     //dropped for not validating in time
+                    uint64_t nFailed = 0;       //wrong answer, or gone before validating
+                    uint64_t nRefused = 0;      //turned away by OnClientAdmission()
+                };
+
             // Create a server, ready to listen on specified port
-                server_interface(uint16_t port):m_asioAcceptor(m_asioContext, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(),port))
+                server_interface(uint16_t port):m_asioAcceptor(m_asioContext, endpoint_type(boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(),port)))
+                {
+
+                }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+            // Create a server, ready to listen on a local (AF_UNIX) stream socket. Same host
+            // clients skip the TCP/IP stack entirely, everything else behaves as over TCP
+                server_interface(const std::string& sLocalPath):m_asioAcceptor(m_asioContext, LocalEndpoint(sLocalPath)),m_sLocalPath(sLocalPath)
                 {
 
                 }
+#endif
 
                 virtual ~server_interface()
                 {
                     Stop();
+
+                    //Connections own sockets and timers on m_asioContext, so they must
+                    //go before it does
+                    std::deque<std::shared_ptr<connection<T>>> deqConnections;
+                    {
+                        std::scoped_lock lock(m_muxConnections);
+                        deqConnections.swap(m_deqConnections);
+                    }
+                    deqConnections.clear();
+
+                    //A local socket leaves its path behind, tidy it up
+                    if(!m_sLocalPath.empty())
+                        ::unlink(m_sLocalPath.c_str());
                 }
                 // Starts the server!
                 bool Start()
@@ -33,7 +72,11 @@ namespace olc
 					// from exiting immediately. Since this is a server, we 
 					// want it primed ready to handle clients trying to
 					// connect.
-                        WaitForClientConnection();
+                        //Batched draining takes connections off the listen queue with
+                        //plain accept() calls, which must not block
+                        m_asioAcceptor.non_blocking(true);
+                        for(size_t i = 0; i < m_nOutstandingAccepts; i++)
+                            WaitForClientConnection();
 
                         // Launch the asio context in its own thread
 
@@ -60,11 +103,142 @@ namespace olc
                     if(m_threadContext.joinable())
                         m_threadContext.join();
 
+                    //Shared memory readers have their own threads, and would carry on
+                    //calling OnMessage(). They may be in it waiting on the connection
+                    //list, so they are joined without holding it
+                    std::deque<std::shared_ptr<connection<T>>> deqConnections;
+                    {
+                        std::scoped_lock lock(m_muxConnections);
+                        deqConnections = m_deqConnections;
+                    }
+                    for(auto& client : deqConnections)
+                        if(client)
+                            client->JoinSharedMemory();
+
                     //Inform someone, anybody, if they care...
                     std::cout<<"[SERVER] Stopped!\n";
                     return true;
                 }
 
+                //Batched socket I/O for every connection accepted from now on, see
+                //connection::EnableBatchedIO(). All connections share one pool of
+                //receive blocks
+                void SetBatchedIO(bool bEnable, size_t nBlocks = 64)
+                {
+                    m_pRecvPool = bEnable ? recv_pool::Create(nBlocks) : nullptr;
+                }
+
+                //Inline dispatch for every connection accepted from now on. OnMessage() is
+                //called straight from the read completion instead of going through the
+                //incoming queue and Update(), which saves a thread hand-off and usually a
+                //wake up per message. Threading rules in this mode:
+                // - OnMessage() runs on the asio thread, or for shared memory connections
+                //   on that connection's reader thread, so calls for different clients can
+                //   overlap. Guard anything they share.
+                // - Calls for any one client never overlap and arrive in order.
+                // - It must not block, every other connection on the thread waits for it.
+                // - Send(), MessageClient() and MessageAllClients() are safe to call from it,
+                //   they hold m_muxConnections while they use the connection list. Code of
+                //   its own that walks m_deqConnections must hold it too, as connections are
+                //   added from the asio thread meanwhile.
+                // - Update() has nothing to do and need not be called.
+                void SetInlineDispatch(bool bEnable)
+                {
+                    m_bInlineDispatch = bEnable;
+                }
+
+                //Inline dispatch of message views for every connection accepted from now
+                //on. OnMessageView() is called instead of OnMessage(), with the same
+                //threading rules as SetInlineDispatch(). Bodies are read into blocks from
+                //a pool (the batched I/O pool when that is on) and the view refers to them
+                //directly, so a handler that only reads fields allocates nothing
+                void SetViewDispatch(bool bEnable, size_t nBlocks = 64)
+                {
+                    m_bViewDispatch = bEnable;
+                    m_pViewPool = bEnable ? recv_pool::Create(nBlocks) : nullptr;
+                }
+
+                //Turn away unwanted frames on every connection accepted from now on, see
+                //connection::SetMessageFilter(). dispatcher::filter() builds one from the
+                //registered handlers
+                void SetMessageFilter(std::shared_ptr<const message_filter<T>> pFilter)
+                {
+                    m_pFilter = std::move(pFilter);
+                }
+
+                //Limit how fast each client accepted from now on may send, see rate_limits.
+                //Every client gets its own budgets, over-limit counts are in its io_stats
+                void SetRateLimits(std::shared_ptr<const rate_limits<T>> pLimits)
+                {
+                    m_pRateLimits = std::move(pLimits);
+                }
+
+                //Conflate keyed updates queued for every client accepted from now on, see
+                //conflation. Each client's queue then holds one message per key at most
+                void SetConflation(std::shared_ptr<const conflation<T>> pConflation)
+                {
+                    m_pConflation = std::move(pConflation);
+                }
+
+                //How accepts are issued. nOutstanding accepts are kept waiting at once, and
+                //each completion also takes up to nBatch - 1 more connections that are
+                //already queued, without a trip through the io loop for each. Both help a
+                //reconnect storm drain faster. Set before Start()
+                void SetAcceptConcurrency(size_t nOutstanding, size_t nBatch = 16)
+                {
+                    m_nOutstandingAccepts = std::max<size_t>(nOutstanding, 1);
+                    m_nAcceptBatch = std::max<size_t>(nBatch, 1);
+                }
+
+                //Length of the kernel's queue of connections not yet accepted, beyond which
+                //new ones are refused or have to retry. The default is the system maximum
+                //(SOMAXCONN). Set before Start()
+                void SetListenBacklog(int nBacklog)
+                {
+                    m_asioAcceptor.listen(nBacklog);
+                }
+
+                //Bound what unvalidated clients can hold on to. A client has tTimeout from
+                //accept to validation (zero waits forever), and while nMaxPending clients
+                //are in that state (zero for no limit) new sockets are closed as soon as
+                //they are accepted, before a connection object is made for them. Applies
+                //to clients accepted from now on
+                void SetHandshakeLimits(std::chrono::milliseconds tTimeout, size_t nMaxPending)
+                {
+                    m_tHandshakeTimeout = tTimeout;
+                    m_nMaxPending = nMaxPending;
+                }
+
+                //Safe to call from any thread
+                handshake_stats GetHandshakeStats() const
+                {
+                    handshake_stats stats;
+                    stats.nPending = m_nPending;
+                    stats.nRejected = m_nRejected;
+                    stats.nTimedOut = m_nTimedOut;
+                    stats.nFailed = m_nFailed;
+                    stats.nRefused = m_nRefused;
+                    return stats;
+                }
+
+#if defined(OLC_NET_TLS)
+                //Accept clients over TLS from now on, see tls_context::CreateServer()
+                void SetTls(std::shared_ptr<tls_context> pContext)
+                {
+                    m_pTls = std::move(pContext);
+                }
+#endif
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+                //Run one coroutine per client instead of queueing its messages for Update().
+                //The handler is spawned on the asio thread once the client is validated and
+                //talks to it through connection::AsyncReceive()/AsyncSend()
+                void SetSessionHandler(typename connection<T>::session_handler fnSession)
+                {
+                    m_fnSession = std::move(fnSession);
+                }
+#endif
+
                 //ASYNC - Instruct asio to wait for connection
                 void WaitForClientConnection()
                 {
@@ -72,84 +246,425 @@ namespace olc
 				// is the purpose of an "acceptor" object. It will provide a unique socket
 				// for each incoming connection attempt
                     m_asioAcceptor.async_accept(
-                        [this](std::error_code ec, boost::asio::ip::tcp::socket socket)
+                        [this](std::error_code ec, typename connection<T>::socket_type socket)
                         {
                             // Triggered by incoming connection request
                             if(!ec)
                             {
-                                std::cout<<"[SERVER] New Connection: "<<socket.remote_endpoint()<<"\n";
-
-                                std::shared_ptr<connection<T>> newconn=std::make_shared<connection<T>>(connection<T>::owner::server,m_asioContext, std::move(socket),m_qMessagesIn);
-
-                                //Give the user server a chance to deny connection
-                                if(OnClientConnect(newconn))
-                                {
-                                    //Connection allowed, so add to container of new connections
-                                    m_deqConnections.push_back(std::move(newconn));
-
-                                    // And very important! Issue a task to the connection's
-								// asio context to sit and wait for bytes to arrive!
-                                    m_deqConnections.back()->ConnectToClient(this,nIDCounter++);
-
-                                    std::cout<<"["<<m_deqConnections.back()->GetID()<<"] Connection Aproved\n";
-                                }
-                                else
-                                {
-                                    std::cout<<"[-----] Connection Denied\n";
-                                }
+                                //take whatever else is queued, then wait for more before
+                                //spending any time on the new clients
+                                m_tAcceptBackoff = std::chrono::milliseconds(0);
+                                std::vector<typename connection<T>::socket_type> vSockets;
+                                vSockets.push_back(std::move(socket));
+                                DrainAcceptQueue(vSockets);
+                                WaitForClientConnection();
+
+                                for(auto& accepted : vSockets)
+                                    OnAccepted(std::move(accepted));
                             }
-                            else
+                            else if(ec != std::errc::operation_canceled)
                             {
-                                //Error has occurred during acceptance
-                                std::cout<<"[SERVER] New Connection Error: "<<ec.message()<<"\n";
+                                //Error has occurred during acceptance, typically out of
+                                //descriptors, which fails again at once. Wait a little
+                                //before trying again rather than spin
+                                RetryAccept(ec);
                             }
+                        }
+                    );
+
+                }
+
+            private:
+                //Re-arm a failed accept after a backoff that doubles, up to a second, for
+                //as long as accepts keep failing. Accepts failing meanwhile wait for the
+                //same timer, and only the first of them is reported
+                void RetryAccept(const std::error_code& ec)
+                {
+                    if(m_nAcceptRetries++ > 0)
+                        return;
 
-                            //Prime the asio context with more work - again simply wait for
-                            //another connection...
+                    m_tAcceptBackoff = std::clamp(m_tAcceptBackoff * 2, std::chrono::milliseconds(10), std::chrono::milliseconds(1000));
+                    std::cout<<"[SERVER] New Connection Error: "<<ec.message()<<", retrying in "<<m_tAcceptBackoff.count()<<"ms\n";
+                    m_timerAcceptRetry.expires_after(m_tAcceptBackoff);
+                    m_timerAcceptRetry.async_wait([this](std::error_code ec)
+                    {
+                        size_t nRetries = std::exchange(m_nAcceptRetries, 0);
+                        if(ec)
+                            return;
+                        for(size_t i = 0; i < nRetries; i++)
                             WaitForClientConnection();
+                    });
+                }
+
+                //Accept up to the batch size from connections already in the listen queue,
+                //stops as soon as the queue is empty
+                void DrainAcceptQueue(std::vector<typename connection<T>::socket_type>& vSockets)
+                {
+                    while(vSockets.size() < m_nAcceptBatch)
+                    {
+                        typename connection<T>::socket_type socket(m_asioContext);
+                        boost::system::error_code ec;
+                        m_asioAcceptor.accept(socket, ec);
+                        if(ec)
+                            break;
+                        vSockets.push_back(std::move(socket));
+                    }
+                }
+
+                //Set up a connection for a freshly accepted socket
+                void OnAccepted(typename connection<T>::socket_type socket)
+                {
+                    if(m_nMaxPending > 0 && m_nPending >= m_nMaxPending)
+                    {
+                        //too many clients still validating, don't spend anything on this one
+                        socket.close();
+                        m_nRejected++;
+                        return;
+                    }
+
+                    //a client that gave up while queued has no endpoint left, and its
+                    //connection fails on the first read
+                    boost::system::error_code ec;
+                    auto endpoint = socket.remote_endpoint(ec);
+                    std::cout<<"[SERVER] New Connection: "<<(ec ? std::string("gone") : DescribeEndpoint(endpoint))<<"\n";
+
+                    std::shared_ptr<connection<T>> newconn=std::make_shared<connection<T>>(connection<T>::owner::server,m_asioContext, std::move(socket),m_qMessagesIn);
+                    if(m_pRecvPool)
+                        newconn->EnableBatchedIO(m_pRecvPool);
+                    if(m_pFilter)
+                        newconn->SetMessageFilter(m_pFilter);
+                    if(m_pRateLimits)
+                        newconn->SetRateLimits(m_pRateLimits);
+                    if(m_pConflation)
+                        newconn->SetConflation(m_pConflation);
+#if defined(OLC_NET_TLS)
+                    if(m_pTls)
+                        newconn->EnableTls(m_pTls);
+#endif
+                    newconn->SetCloseHandler([this](std::shared_ptr<connection<T>> client){ ForgetClient(client); });
+                    newconn->SetControlHandler([this](std::shared_ptr<connection<T>> client, typename connection<T>::control nCode, const std::string& sPattern){ OnControl(client, nCode, sPattern); });
+                    if(m_bInlineDispatch)
+                        newconn->SetMessageHandler([this](std::shared_ptr<connection<T>> client, message<T>& msg){ OnMessage(client, msg); });
+                    if(m_bViewDispatch)
+                        newconn->SetViewHandler([this](std::shared_ptr<connection<T>> client, message_view<T>& view){ OnMessageView(client, view); },
+                            m_pRecvPool ? m_pRecvPool : m_pViewPool);
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+                    if(m_fnSession)
+                        newconn->EnableCoroutines(m_fnSession);
+#endif
+
+                    //Give the user server a chance to deny connection
+                    if(OnClientConnect(newconn))
+                    {
+                        //Connection allowed, so add to container of new connections
+                        m_nPending++;
+                        newconn->SetHandshakeHandler(m_tHandshakeTimeout, [this](handshake_result nResult){ OnHandshakeDone(nResult); });
+                        {
+                            std::scoped_lock lock(m_muxConnections);
+                            m_deqConnections.push_back(newconn);
                         }
-                    );
 
+                        // And very important! Issue a task to the connection's
+                        // asio context to sit and wait for bytes to arrive!
+                        newconn->ConnectToClient(this,nIDCounter++);
+
+                        std::cout<<"["<<newconn->GetID()<<"] Connection Aproved\n";
+                    }
+                    else
+                    {
+                        std::cout<<"[-----] Connection Denied\n";
+                    }
+                }
+
+                //A client asked to (un)subscribe, on the thread that read the request
+                void OnControl(std::shared_ptr<connection<T>> client, typename connection<T>::control nCode, const std::string& sPattern)
+                {
+                    if(nCode == connection<T>::control::subscribe)
+                    {
+                        if(!OnSubscribe(client, sPattern))
+                            return;
+                        std::scoped_lock lock(m_muxTopics);
+                        m_topics.subscribe(client, sPattern);
+                    }
+                    else if(nCode == connection<T>::control::unsubscribe)
+                    {
+                        std::scoped_lock lock(m_muxTopics);
+                        m_topics.unsubscribe(client, sPattern);
+                    }
+                }
+
+                //A client that has gone keeps no subscriptions or group memberships
+                void ForgetClient(const std::shared_ptr<connection<T>>& client)
+                {
+                    {
+                        std::scoped_lock lock(m_muxTopics);
+                        m_topics.remove(client);
+                    }
+                    {
+                        std::scoped_lock lock(m_muxGroups);
+                        m_groups.remove(client);
+                    }
+                    std::scoped_lock lock(m_muxInterest);
+                    m_interest.remove(client);
+                }
+
+                //A client left the pending state
+                void OnHandshakeDone(handshake_result nResult)
+                {
+                    m_nPending--;
+                    if(nResult == handshake_result::timed_out)
+                        m_nTimedOut++;
+                    else if(nResult == handshake_result::failed)
+                        m_nFailed++;
+                    else if(nResult == handshake_result::refused)
+                        m_nRefused++;
+                }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+                //Binding fails if a previous run left the socket file behind, so remove it first
+                static endpoint_type LocalEndpoint(const std::string& sPath)
+                {
+                    ::unlink(sPath.c_str());
+                    return endpoint_type(boost::asio::local::stream_protocol::endpoint(sPath));
+                }
+#endif
+
+                //Friendly description of a protocol agnostic endpoint
+                static std::string DescribeEndpoint(const endpoint_type& endpoint)
+                {
+                    std::ostringstream os;
+                    int nFamily=endpoint.protocol().family();
+                    if(nFamily==AF_INET || nFamily==AF_INET6)
+                    {
+                        boost::asio::ip::tcp::endpoint ep;
+                        std::memcpy(ep.data(),endpoint.data(),endpoint.size());
+                        ep.resize(endpoint.size());
+                        os<<ep;
+                    }
+                    else
+                    {
+                        os<<"local";
+                    }
+                    return os.str();
                 }
 
+            public:
                 //Send a message to a specific client
-                void MessageClient(std::shared_ptr<connection<T>> client, const message<T>& msg)
+                void MessageClient(std::shared_ptr<connection<T>> client, const message<T>& msg, send_priority nPriority = send_priority::interactive)
                 {
                     if(client && client->IsConnected())
                     {
-                        client->Send(msg);
+                        client->Send(msg, nPriority);
                     }
                     else
                     {
                         OnClientDisconnect(client);
-                        client.reset();
+                        ForgetClient(client);
+
+                        std::scoped_lock lock(m_muxConnections);
                         m_deqConnections.erase(std::remove(m_deqConnections.begin(),m_deqConnections.end(),client),m_deqConnections.end());
                     }
                 }
 
+                //Send state to a client as a snapshot: in full the first time, then as a
+                //delta against the last state it acked, see net_snapshot.h. Every client
+                //has its own baseline for each message ID. Its OnMessage gets the whole
+                //state. Returns false if the client has gone
+                bool SnapshotClient(std::shared_ptr<connection<T>> client, const message<T>& state, send_priority nPriority = send_priority::interactive)
+                {
+                    if(client && client->IsConnected())
+                    {
+                        client->SendSnapshot(state, nPriority);
+                        return true;
+                    }
+
+                    //sends nothing, but clears up after the client as usual
+                    MessageClient(client, state, nPriority);
+                    return false;
+                }
+
+                //Bring a client that joins mid-session up to date, e.g. from
+                //OnClientValidated(). pState is streamed to it in chunks of nChunk bytes,
+                //one at a time, so neither the asio thread nor the other clients wait on
+                //a large state. Messages already queued for the client go first. Anything
+                //sent to it after this call is held back until the last chunk is written,
+                //then replayed in order, so the client gets the state as one message
+                //followed by every update since. Joining clients can share one state
+                void BootstrapClient(std::shared_ptr<connection<T>> client, std::shared_ptr<const message<T>> pState, size_t nChunk = 64 * 1024)
+                {
+                    if(client && client->IsConnected())
+                        client->SendBootstrap(std::move(pState), nChunk);
+                }
+
                 //Send message to all clients
-                void MessageAllClients(const message<T>& msg, std::shared_ptr<connection<T>> pIgnoreClient=nullptr)
+                void MessageAllClients(const message<T>& msg, std::shared_ptr<connection<T>> pIgnoreClient=nullptr, send_priority nPriority = send_priority::interactive)
+                {
+                    //clients found gone are told about once the list is let go, so
+                    //OnClientDisconnect() may message others
+                    std::vector<std::shared_ptr<connection<T>>> vGone;
+                    {
+                        std::scoped_lock lock(m_muxConnections);
+                        bool bInvalidClientExists=false;
+                        for(auto& client : m_deqConnections)
+                        {
+                            //Check client is connected...
+                            if(client && client->IsConnected())
+                            {
+                                //..it is!
+                                if(client!=pIgnoreClient)
+                                    client->Send(msg, nPriority);
+                            }
+                            else
+                            {
+                                //The client couldnt be contacted, so assume it has disconnected
+                                vGone.push_back(std::move(client));
+                                bInvalidClientExists=true;
+                            }
+                        }
+                        if(bInvalidClientExists)
+                            m_deqConnections.erase(std::remove(m_deqConnections.begin(),m_deqConnections.end(),nullptr),m_deqConnections.end());
+                    }
+
+                    for(auto& client : vGone)
+                    {
+                        OnClientDisconnect(client);
+                        ForgetClient(client);
+                    }
+                }
+
+                //How many subscriptions each client may hold, and how long a pattern may
+                //be. Subscriptions past them are turned down. Only before any client
+                //subscribes
+                void SetTopicLimits(size_t nMaxPatterns, size_t nMaxLength)
+                {
+                    std::scoped_lock lock(m_muxTopics);
+                    m_topics = topic_index<std::shared_ptr<connection<T>>>(nMaxPatterns, nMaxLength);
+                }
+
+                //Send a message to every client subscribed to sTopic, see topic_index for
+                //the patterns clients can use. Only subscribers are visited, and they all
+                //share one copy of the message. Clients lose their subscriptions as they
+                //close, any found gone meanwhile are unsubscribed here. Returns how many
+                //clients it went to
+                size_t Publish(const std::string& sTopic, const message<T>& msg, send_priority nPriority = send_priority::interactive)
                 {
-                    bool bInvalidClientExists=false;
-                    for(auto& client : m_deqConnections)
+                    auto pShared = std::make_shared<const message<T>>(msg);
+                    std::vector<std::shared_ptr<connection<T>>> vGone;
+                    size_t nSent = 0;
+
+                    std::scoped_lock lock(m_muxTopics);
+                    m_topics.for_each(sTopic, [&](const std::shared_ptr<connection<T>>& client)
                     {
-                        //Check client is connected...
-                        if(client && client->IsConnected())
+                        if(client->IsConnected())
                         {
-                            //..it is!
-                            if(client!=pIgnoreClient)
-                                client->Send(msg);
+                            client->Send(pShared, nPriority);
+                            nSent++;
                         }
                         else
                         {
-                            //The client couldnt be contacted, so assume it has disconnected
-                            OnClientDisconnect(client);
-                            client.reset();
-                            bInvalidClientExists=true;
+                            vGone.push_back(client);
                         }
+                    });
+                    for(auto& client : vGone)
+                        m_topics.remove(client);
+                    return nSent;
+                }
+
+                //Put a client in a group, e.g. a room. Clients leave all their groups when
+                //they disconnect. False if it was already a member
+                bool JoinGroup(uint32_t nGroup, std::shared_ptr<connection<T>> client)
+                {
+                    std::scoped_lock lock(m_muxGroups);
+                    return client && client->IsConnected() && m_groups.join(nGroup, client);
+                }
+
+                //False if the client wasn't a member
+                bool LeaveGroup(uint32_t nGroup, std::shared_ptr<connection<T>> client)
+                {
+                    std::scoped_lock lock(m_muxGroups);
+                    return m_groups.leave(nGroup, client);
+                }
+
+                size_t GetGroupSize(uint32_t nGroup)
+                {
+                    std::scoped_lock lock(m_muxGroups);
+                    return m_groups.members(nGroup).size();
+                }
+
+                //Send a message to every member of a group but pIgnoreClient, typically the
+                //sender. Costs the size of the group, not of the server, and the members
+                //share one copy of the message
+                void MessageGroup(uint32_t nGroup, const message<T>& msg, std::shared_ptr<connection<T>> pIgnoreClient=nullptr, send_priority nPriority = send_priority::interactive)
+                {
+                    auto pShared = std::make_shared<const message<T>>(msg);
+                    std::scoped_lock lock(m_muxGroups);
+                    for(auto& client : m_groups.members(nGroup))
+                        if(client != pIgnoreClient)
+                            client->Send(pShared, nPriority);
+                }
+
+                //Where a client is, for MessageNearby() and UpdateInterest(). Clients drop
+                //out when they disconnect. Set the cell size first with SetInterestCellSize().
+                //False if the position isn't finite or the client has gone
+                bool SetClientPosition(std::shared_ptr<connection<T>> client, grid_position pos)
+                {
+                    if(!std::isfinite(pos.x) || !std::isfinite(pos.y))
+                        return false;
+
+                    std::scoped_lock lock(m_muxInterest);
+                    if(!client || !client->IsConnected())
+                        return false;
+                    m_interest.set_position(client, pos);
+                    return true;
+                }
+
+                //Cells of the interest grid, about the usual radius. Only before any
+                //position is set
+                void SetInterestCellSize(float fCellSize)
+                {
+                    std::scoped_lock lock(m_muxInterest);
+                    m_interest = interest_grid<std::shared_ptr<connection<T>>>(fCellSize);
+                }
+
+                //Send a message to every client within fRadius of pos but pIgnoreClient.
+                //Only the grid cells around pos are looked at, and the clients found share
+                //one copy of the message
+                void MessageNearby(grid_position pos, float fRadius, const message<T>& msg, std::shared_ptr<connection<T>> pIgnoreClient=nullptr, send_priority nPriority = send_priority::interactive)
+                {
+                    //positions often come from clients, a bad one reaches nobody
+                    if(!std::isfinite(pos.x) || !std::isfinite(pos.y) || !std::isfinite(fRadius) || fRadius < 0)
+                        return;
+
+                    auto pShared = std::make_shared<const message<T>>(msg);
+                    std::scoped_lock lock(m_muxInterest);
+                    m_interest.for_each_near(pos, fRadius, [&](const std::shared_ptr<connection<T>>& client)
+                    {
+                        if(client != pIgnoreClient)
+                            client->Send(pShared, nPriority);
+                    });
+                }
+
+                //Once per tick - work out which clients each client can see, those within
+                //fRadius, and call OnInterestEnter()/OnInterestLeave() for the changes
+                //since the last call. The calls are made after the grid is unlocked, so
+                //they may send or move clients
+                void UpdateInterest(float fRadius)
+                {
+                    if(!std::isfinite(fRadius) || fRadius < 0)
+                        return;
+
+                    using client_ptr = std::shared_ptr<connection<T>>;
+                    std::vector<std::pair<client_ptr, client_ptr>> vEnter, vLeave;
+                    {
+                        std::scoped_lock lock(m_muxInterest);
+                        m_interest.update_visibility(fRadius,
+                            [&](const client_ptr& observer, const client_ptr& target){ vEnter.push_back({ observer, target }); },
+                            [&](const client_ptr& observer, const client_ptr& target){ vLeave.push_back({ observer, target }); });
                     }
-                    if(bInvalidClientExists)
-                        m_deqConnections.erase(std::remove(m_deqConnections.begin(),m_deqConnections.end(),nullptr),m_deqConnections.end());
+                    for(auto& leave : vLeave)
+                        OnInterestLeave(leave.first, leave.second);
+                    for(auto& enter : vEnter)
+                        OnInterestEnter(enter.first, enter.second);
                 }
 
                 void Update(size_t nMaxMessages=-1, bool bWait=false)
@@ -183,12 +698,52 @@ namespace olc
                     return false;
                 }
 
+                //Called when a client asks to subscribe to a topic or prefix pattern, on the
+                //thread that read the request. Return false to turn it down
+                virtual bool OnSubscribe(std::shared_ptr<connection<T>> client, const std::string& sPattern)
+                {
+                    return true;
+                }
+
+                //Called from UpdateInterest() when target comes within sight of observer,
+                //typically to send observer what target looks like
+                virtual void OnInterestEnter(std::shared_ptr<connection<T>> observer, std::shared_ptr<connection<T>> target)
+                {
+
+                }
+
+                //Called from UpdateInterest() when target moves out of sight of observer,
+                //or disconnects
+                virtual void OnInterestLeave(std::shared_ptr<connection<T>> observer, std::shared_ptr<connection<T>> target)
+                {
+
+                }
+
                 //Called when a message arrives
                 virtual void OnMessage(std::shared_ptr<connection<T>> client, message<T>& msg)
                 {
 
                 }
+
+                //Called when a message arrives in view dispatch mode. By default the view is
+                //copied into a message for OnMessage(), override it to read in place
+                virtual void OnMessageView(std::shared_ptr<connection<T>> client, message_view<T>& view)
+                {
+                    message<T> msg = view.to_message();
+                    OnMessage(client, msg);
+                }
             public:
+                //Called once a client has passed validation, to decide whether it gets in.
+                //Answer through fnAdmit, from any thread and whenever the decision is made:
+                //the client stays pending meanwhile (the handshake deadline still runs)
+                //while the asio thread carries on with everyone else. Slow checks such as
+                //an auth lookup belong here rather than in OnClientConnect(), handed to a
+                //worker thread. Admits everyone by default
+                virtual void OnClientAdmission(std::shared_ptr<connection<T>> client, admission_handler fnAdmit)
+                {
+                    fnAdmit(true);
+                }
+
                  //called when a client is validated
                 virtual void OnClientValidated(std::shared_ptr<connection<T>> client)
                 {
@@ -198,7 +753,9 @@ namespace olc
                 //Thread Safe Queue for incoming message packets
                 tsqueue<owned_message<T>> m_qMessagesIn;
             public:
-                //Container of active validated connections
+                //Container of active validated connections. Added to from the asio thread,
+                //so hold m_muxConnections to use it while the server runs
+                std::mutex m_muxConnections;
                 std::deque<std::shared_ptr<connection<T>>> m_deqConnections;
             protected:
                 //Order of declaration is important - it is also the order of initialisation
@@ -206,7 +763,69 @@ namespace olc
                 std::thread m_threadContext;
 
                 //These things need an asio context
-                boost::asio::ip::tcp::acceptor m_asioAcceptor;
+                boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> m_asioAcceptor;
+
+                //Path of the local socket, if the server listens on one
+                std::string m_sLocalPath;
+
+                //Receive blocks for batched I/O, null when disabled
+                std::shared_ptr<recv_pool> m_pRecvPool;
+
+                //OnMessage() is called from the reading thread rather than Update()
+                bool m_bInlineDispatch = false;
+
+                //OnMessageView() is called from the reading thread, with bodies in m_pViewPool
+                bool m_bViewDispatch = false;
+                std::shared_ptr<recv_pool> m_pViewPool;
+
+                //Frames every connection accepts, null for all of them
+                std::shared_ptr<const message_filter<T>> m_pFilter;
+
+                //How fast each client may send, null for no limit
+                std::shared_ptr<const rate_limits<T>> m_pRateLimits;
+
+                //Messages only worth sending in their latest version, null for none
+                std::shared_ptr<const conflation<T>> m_pConflation;
+
+                //Topic subscriptions, changed from the reading threads and read by Publish()
+                std::mutex m_muxTopics;
+                topic_index<std::shared_ptr<connection<T>>> m_topics;
+
+                //Group memberships, members leave from the asio thread as they close
+                std::mutex m_muxGroups;
+                group_index<std::shared_ptr<connection<T>>> m_groups;
+
+                //Client positions, for area of interest
+                std::mutex m_muxInterest;
+                interest_grid<std::shared_ptr<connection<T>>> m_interest;
+
+#if defined(OLC_NET_TLS)
+                //Certificate and key for TLS, null for plain connections
+                std::shared_ptr<tls_context> m_pTls;
+#endif
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+                //Per client coroutine, empty when messages go through Update()
+                typename connection<T>::session_handler m_fnSession;
+#endif
+
+                //Accepts kept outstanding, and connections one accept completion may take
+                size_t m_nOutstandingAccepts = 1;
+                size_t m_nAcceptBatch = 16;
+
+                //Failed accepts waiting to be re-armed, and how long they wait
+                boost::asio::steady_timer m_timerAcceptRetry{m_asioContext};
+                size_t m_nAcceptRetries = 0;
+                std::chrono::milliseconds m_tAcceptBackoff{0};
+
+                //Handshake limits and counters, the counters are read from other threads
+                std::chrono::milliseconds m_tHandshakeTimeout{10000};
+                size_t m_nMaxPending = 1024;
+                std::atomic<size_t> m_nPending{0};
+                std::atomic<uint64_t> m_nRejected{0};
+                std::atomic<uint64_t> m_nTimedOut{0};
+                std::atomic<uint64_t> m_nFailed{0};
+                std::atomic<uint64_t> m_nRefused{0};
 
                 //Clients will be identified in the "wider system" via an ID
                 uint32_t nIDCounter=10000;
@@ -0,0 +1,325 @@
+#pragma once
+#include "net_common.h"
+
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <linux/futex.h>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+
+namespace olc
+{
+    namespace net
+    {
+        // Same host connections can move their frames through shared memory instead of
+        // a socket. A region holds two single producer / single consumer byte rings, one
+        // per direction. The rings carry exactly the bytes a socket would, so framing is
+        // unchanged - the ring is simply a faster pipe.
+        namespace shm
+        {
+            // Size of each ring in bytes, must be a power of two
+            constexpr uint64_t nRingCapacity = 1 << 20;
+
+            // Control block of one ring. Producer and consumer indices live on their own
+            // cache lines so the two sides do not fight over them
+            struct ring_header
+            {
+                // Total bytes ever written, only the producer moves it
+                alignas(64) std::atomic<uint64_t> nHead{0};
+                // Total bytes ever read, only the consumer moves it
+                alignas(64) std::atomic<uint64_t> nTail{0};
+                // Futex word the consumer sleeps on, bumped on every wake up
+                alignas(64) std::atomic<uint32_t> nWakeSeq{0};
+                // Set while the consumer is (about to be) asleep
+                std::atomic<uint32_t> nSleeping{0};
+            };
+
+            struct region_layout
+            {
+                ring_header toServer;
+                ring_header toClient;
+            };
+
+            inline size_t RegionSize()
+            {
+                return sizeof(region_layout) + 2 * nRingCapacity;
+            }
+
+            inline long futex(std::atomic<uint32_t>* pWord, int nOp, uint32_t nValue, const timespec* pTimeout)
+            {
+                // Not FUTEX_PRIVATE_FLAG, the word is shared with another process
+                return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(pWord), nOp, nValue, pTimeout, nullptr, 0);
+            }
+
+            // One direction of the region, seen from either end
+            class ring
+            {
+                public:
+                    ring() = default;
+                    ring(ring_header* pHeader, uint8_t* pData) : m_pHeader(pHeader), m_pData(pData) {}
+
+                    // Producer - copy as many bytes as fit, returns how many were taken.
+                    // Nothing once the ring is corrupt()
+                    size_t write(const uint8_t* pSrc, size_t nBytes)
+                    {
+                        const uint64_t nHead = m_pHeader->nHead.load(std::memory_order_relaxed);
+                        const uint64_t nTail = m_pHeader->nTail.load(std::memory_order_acquire);
+                        if(!Valid(nHead, nTail))
+                            return 0;
+                        size_t n = std::min<uint64_t>(nBytes, nRingCapacity - (nHead - nTail));
+                        if(n == 0)
+                            return 0;
+
+                        size_t nOffset = nHead & (nRingCapacity - 1);
+                        size_t nFirst = std::min<size_t>(n, nRingCapacity - nOffset);
+                        std::memcpy(m_pData + nOffset, pSrc, nFirst);
+                        std::memcpy(m_pData, pSrc + nFirst, n - nFirst);
+                        m_pHeader->nHead.store(nHead + n, std::memory_order_release);
+
+                        // Only pay for the syscall when the consumer has gone to sleep
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        if(m_pHeader->nSleeping.load(std::memory_order_relaxed))
+                            wake();
+                        return n;
+                    }
+
+                    // Consumer - copy up to nBytes out, returns how many were available.
+                    // Nothing once the ring is corrupt()
+                    size_t read(uint8_t* pDst, size_t nBytes)
+                    {
+                        const uint64_t nTail = m_pHeader->nTail.load(std::memory_order_relaxed);
+                        const uint64_t nHead = m_pHeader->nHead.load(std::memory_order_acquire);
+                        if(!Valid(nHead, nTail))
+                            return 0;
+                        size_t n = std::min<uint64_t>(nBytes, nHead - nTail);
+                        if(n == 0)
+                            return 0;
+
+                        size_t nOffset = nTail & (nRingCapacity - 1);
+                        size_t nFirst = std::min<size_t>(n, nRingCapacity - nOffset);
+                        std::memcpy(pDst, m_pData + nOffset, nFirst);
+                        std::memcpy(pDst + nFirst, m_pData, n - nFirst);
+                        m_pHeader->nTail.store(nTail + n, std::memory_order_release);
+                        return n;
+                    }
+
+                    // The indices are in memory the other process can write. Once they
+                    // have been seen to hold more than the ring, or run backwards, its
+                    // peer is not to be trusted and the ring is left alone
+                    bool corrupt() const
+                    {
+                        return m_bCorrupt;
+                    }
+
+                    bool empty() const
+                    {
+                        return m_pHeader->nHead.load(std::memory_order_acquire) == m_pHeader->nTail.load(std::memory_order_relaxed);
+                    }
+
+                    // Consumer - adaptive spin-then-block until bytes arrive, a wake() or
+                    // the timeout. Spinning only pays off when the producer is running on
+                    // another core at the same time, so the spin budget grows while data
+                    // keeps turning up during the spin and shrinks whenever we had to sleep
+                    void wait(std::chrono::microseconds timeout)
+                    {
+                        for(uint32_t i = 0; i < m_nSpinBudget; i++)
+                        {
+                            if(!empty())
+                            {
+                                m_nSpinBudget = std::min<uint32_t>(m_nSpinBudget * 2 + 1, nMaxSpin);
+                                return;
+                            }
+                            Relax();
+                        }
+                        m_nSpinBudget /= 2;
+
+                        uint32_t nSeq = m_pHeader->nWakeSeq.load(std::memory_order_acquire);
+                        m_pHeader->nSleeping.store(1, std::memory_order_relaxed);
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        if(empty())
+                        {
+                            timespec ts{ long(timeout.count() / 1000000), long(timeout.count() % 1000000) * 1000 };
+                            futex(&m_pHeader->nWakeSeq, FUTEX_WAIT, nSeq, &ts);
+                        }
+                        m_pHeader->nSleeping.store(0, std::memory_order_relaxed);
+                    }
+
+                    // Wake the consumer, a changed sequence also stops it from going to sleep
+                    void wake()
+                    {
+                        m_pHeader->nWakeSeq.fetch_add(1, std::memory_order_release);
+                        futex(&m_pHeader->nWakeSeq, FUTEX_WAKE, INT_MAX, nullptr);
+                    }
+
+                private:
+                    bool Valid(uint64_t nHead, uint64_t nTail)
+                    {
+                        //unsigned, so a tail past the head shows up as a huge fill
+                        if(nHead - nTail > nRingCapacity)
+                            m_bCorrupt = true;
+                        return !m_bCorrupt;
+                    }
+
+                    static void Relax()
+                    {
+#if defined(__x86_64__) || defined(__i386__)
+                        __builtin_ia32_pause();
+#else
+                        std::this_thread::yield();
+#endif
+                    }
+
+                    // On a single core the producer cannot run while we spin
+                    static inline const uint32_t nMaxSpin = std::thread::hardware_concurrency() > 1 ? 4096 : 0;
+
+                    ring_header* m_pHeader = nullptr;
+                    uint8_t* m_pData = nullptr;
+                    uint32_t m_nSpinBudget = nMaxSpin;
+                    bool m_bCorrupt = false;
+            };
+
+            // 64 bits from the kernel's random pool. Region names come from it, so another
+            // user on the host can neither guess one nor create it first
+            inline uint64_t Random()
+            {
+                uint64_t n = 0;
+                uint8_t* p = reinterpret_cast<uint8_t*>(&n);
+                size_t nGot = 0;
+                while(nGot < sizeof(n))
+                {
+                    ssize_t r = ::getrandom(p + nGot, sizeof(n) - nGot, 0);
+                    if(r < 0)
+                    {
+                        if(errno == EINTR)
+                            continue;
+                        throw std::runtime_error("shm: getrandom failed");
+                    }
+                    nGot += size_t(r);
+                }
+                return n;
+            }
+
+            // Who is at the other end of a local socket, false if it can't be told
+            inline bool PeerUid(int fd, uid_t& nUid)
+            {
+                struct ucred cred;
+                socklen_t nLength = sizeof(cred);
+                if(::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &nLength) != 0 || nLength != sizeof(cred))
+                    return false;
+                nUid = cred.uid;
+                return true;
+            }
+
+            // A mapped shared memory region. The client creates it under a name derived
+            // from the handshake, the server opens it and removes the name, after which
+            // only the two mappings keep it alive
+            class region
+            {
+                public:
+                    region() = default;
+                    region(const region&) = delete;
+                    region& operator=(const region&) = delete;
+
+                    ~region()
+                    {
+                        Unlink();
+                        if(m_pBase)
+                            ::munmap(m_pBase, RegionSize());
+                    }
+
+                    static std::string Name(uint64_t nHandshake)
+                    {
+                        char sName[32];
+                        std::snprintf(sName, sizeof(sName), "/olc-net-%016llx", (unsigned long long)nHandshake);
+                        return sName;
+                    }
+
+                    // Client side, fails if the name is taken. The name stays until the
+                    // server opens the region or Unlink() is called
+                    bool Create(const std::string& sName)
+                    {
+                        int fd = ::shm_open(sName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+                        if(fd < 0)
+                            return false;
+
+                        bool bMapped = ::ftruncate(fd, RegionSize()) == 0 && Map(fd);
+                        ::close(fd);
+                        if(!bMapped)
+                        {
+                            ::shm_unlink(sName.c_str());
+                            return false;
+                        }
+
+                        new (m_pBase) region_layout();
+                        m_sName = sName;
+                        return true;
+                    }
+
+                    // Server side, the name is removed once mapped. The region must belong
+                    // to nOwner, the peer of the socket, and be closed to everyone else,
+                    // or it is not the one the client made
+                    bool Open(const std::string& sName, uid_t nOwner)
+                    {
+                        int fd = ::shm_open(sName.c_str(), O_RDWR, 0600);
+                        if(fd < 0)
+                            return false;
+
+                        struct stat st;
+                        bool bMapped = ::fstat(fd, &st) == 0 && st.st_uid == nOwner && (st.st_mode & 0077) == 0
+                                    && size_t(st.st_size) == RegionSize() && Map(fd);
+                        ::close(fd);
+                        if(bMapped)
+                            ::shm_unlink(sName.c_str());
+                        return bMapped;
+                    }
+
+                    // Client side, drop the name of a region the server never opened
+                    void Unlink()
+                    {
+                        if(m_sName.empty())
+                            return;
+                        ::shm_unlink(m_sName.c_str());
+                        m_sName.clear();
+                    }
+
+                    // The ring this end writes to
+                    ring Outgoing(bool bServer)
+                    {
+                        return bServer ? Ring(1) : Ring(0);
+                    }
+
+                    // The ring this end reads from
+                    ring Incoming(bool bServer)
+                    {
+                        return bServer ? Ring(0) : Ring(1);
+                    }
+
+                private:
+                    bool Map(int fd)
+                    {
+                        void* p = ::mmap(nullptr, RegionSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                        if(p == MAP_FAILED)
+                            return false;
+                        m_pBase = static_cast<uint8_t*>(p);
+                        return true;
+                    }
+
+                    ring Ring(int nIndex)
+                    {
+                        auto* pLayout = reinterpret_cast<region_layout*>(m_pBase);
+                        uint8_t* pData = m_pBase + sizeof(region_layout) + nIndex * nRingCapacity;
+                        return ring(nIndex == 0 ? &pLayout->toServer : &pLayout->toClient, pData);
+                    }
+
+                    uint8_t* m_pBase = nullptr;
+                    std::string m_sName;
+            };
+        }
+    }
+}
@@ -0,0 +1,294 @@
+#pragma once
+#include "net_common.h"
+#include "net_message.h"
+#include "net_wire.h"
+
+#include <deque>
+
+namespace olc
+{
+    namespace net
+    {
+        // Snapshots are whole states, such as the world a client can see, sent over and
+        // over as they change. Each one is numbered, and the client acks those it has
+        // rebuilt. Against the newest acked one, the baseline, a snapshot goes out as a
+        // delta: the state is cut into 8 byte blocks, a bitmask says which blocks differ
+        // from the baseline, and only those follow, XORed with it. Without a baseline it
+        // goes out in full. A snapshot frame's body is
+        //
+        //  [seq: 4 bytes][baseline seq, 0 if full: 4 bytes][state size: 4 bytes]
+        //  full    [state]
+        //  delta   [mask: one bit per block][changed blocks XOR baseline]
+        //
+        // all little endian, and the frame has the state's message ID
+        namespace snapshot
+        {
+            constexpr size_t nHeader = 12;
+            constexpr size_t nBlock = 8;
+
+            inline size_t Blocks(size_t nSize)
+            {
+                return (nSize + nBlock - 1) / nBlock;
+            }
+
+            // Block i of p, zero past nSize, so states of different sizes still diff
+            inline uint64_t Block(const uint8_t* p, size_t nSize, size_t i)
+            {
+                uint64_t n = 0;
+                size_t nOffset = i * nBlock;
+                if(nOffset + nBlock <= nSize)
+                    std::memcpy(&n, p + nOffset, nBlock);
+                else if(nOffset < nSize)
+                    std::memcpy(&n, p + nOffset, nSize - nOffset);
+                return n;
+            }
+        }
+
+        // The sending side of one stream of snapshots to one client. Not thread safe
+        template <typename T>
+        class snapshot_sender
+        {
+            public:
+                // A client that leaves nWindow snapshots unacked has fallen behind or
+                // lost them, and gets the next one in full
+                explicit snapshot_sender(size_t nWindow = 32)
+                : m_nWindow(nWindow)
+                {
+
+                }
+
+                // The frame that carries state, a delta if that is smaller than the state
+                message<T> encode(const message<T>& state)
+                {
+                    if(m_dqSent.size() >= m_nWindow)
+                        reset();
+
+                    const uint32_t nSeq = m_nNext++;
+                    const uint8_t* pState = state.body.data();
+                    const size_t nSize = state.body.size();
+
+                    //the delta is worked out in scratch space first, so the frame is
+                    //allocated once at its final size
+                    size_t nLength = 0;
+                    if(m_base.nSeq != 0)
+                    {
+                        m_vScratch.resize(nSize);
+                        nLength = Delta(pState, nSize, m_vScratch.data());
+                    }
+                    const uint8_t* pPayload = nLength > 0 ? m_vScratch.data() : pState;
+                    if(nLength > 0)
+                        m_nDeltas++;
+                    else
+                        nLength = nSize, m_nFull++;
+
+                    message<T> frame;
+                    frame.header.id = state.header.id;
+                    frame.body.resize(snapshot::nHeader + nLength);
+                    uint8_t* pOut = frame.body.data();
+                    wire::Put(pOut, nSeq, 4);
+                    wire::Put(pOut + 4, pPayload == pState ? 0 : m_base.nSeq, 4);
+                    wire::Put(pOut + 8, nSize, 4);
+                    if(nLength > 0)
+                        std::memcpy(pOut + snapshot::nHeader, pPayload, nLength);
+                    frame.header.size = frame.size();
+
+                    m_dqSent.push_back({ nSeq, std::vector<uint8_t>(pState, pState + nSize) });
+                    return frame;
+                }
+
+                // The client has rebuilt snapshot nSeq, it becomes the baseline. Acks
+                // for snapshots no longer held are ignored
+                void ack(uint32_t nSeq)
+                {
+                    auto it = std::find_if(m_dqSent.begin(), m_dqSent.end(), [nSeq](const sent& s){ return s.nSeq == nSeq; });
+                    if(it == m_dqSent.end())
+                        return;
+
+                    m_base = std::move(*it);
+                    m_dqSent.erase(m_dqSent.begin(), it + 1);
+                }
+
+                // Forget the baseline, the next snapshot goes out in full
+                void reset()
+                {
+                    m_base = sent();
+                    m_dqSent.clear();
+                }
+
+                // Sequence number of the baseline, 0 for none
+                uint32_t baseline() const
+                {
+                    return m_base.nSeq;
+                }
+
+                uint64_t full() const
+                {
+                    return m_nFull;
+                }
+
+                uint64_t deltas() const
+                {
+                    return m_nDeltas;
+                }
+
+            private:
+                struct sent
+                {
+                    uint32_t nSeq = 0;
+                    std::vector<uint8_t> vState;
+                };
+
+                // Writes the delta against the baseline to pOut, which has room for as
+                // much as the state. Returns its length, 0 if it would be no smaller
+                size_t Delta(const uint8_t* pState, size_t nSize, uint8_t* pOut) const
+                {
+                    const size_t nBlocks = snapshot::Blocks(nSize);
+                    const size_t nMask = (nBlocks + 7) / 8;
+                    if(nMask >= nSize)
+                        return 0;
+
+                    std::memset(pOut, 0, nMask);
+                    size_t nLength = nMask;
+                    const uint8_t* pBase = m_base.vState.data();
+                    const size_t nBase = m_base.vState.size();
+                    const size_t nSame = std::min(nSize, nBase);
+                    for(size_t i = 0; i < nBlocks; i++)
+                    {
+                        //most of a state doesn't change, skip it a mask byte at a time
+                        const size_t nOffset = i * snapshot::nBlock;
+                        if(i % 8 == 0 && nOffset + 64 <= nSame && std::memcmp(pState + nOffset, pBase + nOffset, 64) == 0)
+                        {
+                            i += 7;
+                            continue;
+                        }
+
+                        uint64_t nDiff = snapshot::Block(pState, nSize, i) ^ snapshot::Block(pBase, nBase, i);
+                        if(nDiff == 0)
+                            continue;
+
+                        size_t nBytes = std::min(snapshot::nBlock, nSize - nOffset);
+                        if(nLength + nBytes >= nSize)
+                            return 0;
+                        pOut[i / 8] |= uint8_t(1u << (i % 8));
+                        std::memcpy(pOut + nLength, &nDiff, nBytes);
+                        nLength += nBytes;
+                    }
+                    return nLength;
+                }
+
+                size_t m_nWindow;
+                uint32_t m_nNext = 1;
+                sent m_base;
+                //sent since the baseline and not acked yet, oldest first
+                std::deque<sent> m_dqSent;
+                std::vector<uint8_t> m_vScratch;
+                uint64_t m_nFull = 0;
+                uint64_t m_nDeltas = 0;
+        };
+
+        // The receiving side of one stream of snapshots. Keeps the states it has
+        // rebuilt until the sender has moved its baseline past them, but no more
+        // than nMaxStates, enough for a sender's window. Not thread safe
+        template <typename T>
+        class snapshot_receiver
+        {
+            public:
+                explicit snapshot_receiver(size_t nMaxStates = 64)
+                : m_nMaxStates(nMaxStates)
+                {
+
+                }
+
+                // Replace a snapshot frame's body with the state it carries. Returns
+                // its sequence number, for the ack, or 0 if the frame is malformed or
+                // its baseline is gone, and the sender should start over in full
+                uint32_t decode(message<T>& frame)
+                {
+                    const uint8_t* pIn = frame.body.data();
+                    const size_t nIn = frame.body.size();
+                    if(nIn < snapshot::nHeader)
+                        return 0;
+
+                    const uint32_t nSeq = uint32_t(wire::Get(pIn, 4));
+                    const uint32_t nBase = uint32_t(wire::Get(pIn + 4, 4));
+                    const size_t nSize = size_t(wire::Get(pIn + 8, 4));
+                    const uint8_t* pData = pIn + snapshot::nHeader;
+                    const size_t nData = nIn - snapshot::nHeader;
+                    if(nSeq == 0)
+                        return 0;
+
+                    std::vector<uint8_t> vState;
+                    if(nBase == 0)
+                    {
+                        if(nData != nSize)
+                            return 0;
+                        vState.assign(pData, pData + nData);
+                        m_dqStates.clear();
+                    }
+                    else
+                    {
+                        //the sender's baseline only moves forward, older states are done with
+                        while(!m_dqStates.empty() && m_dqStates.front().first < nBase)
+                            m_dqStates.pop_front();
+                        if(m_dqStates.empty() || m_dqStates.front().first != nBase || !Apply(m_dqStates.front().second, pData, nData, nSize, vState))
+                            return 0;
+                    }
+
+                    frame.body.assign(vState.data(), vState.data() + vState.size());
+                    frame.header.size = frame.size();
+                    //a sender that never moves its baseline doesn't get to grow this
+                    if(m_dqStates.size() >= m_nMaxStates)
+                        m_dqStates.pop_front();
+                    m_dqStates.push_back({ nSeq, std::move(vState) });
+                    return nSeq;
+                }
+
+            private:
+                static bool Apply(const std::vector<uint8_t>& vBase, const uint8_t* pData, size_t nData, size_t nSize, std::vector<uint8_t>& vState)
+                {
+                    const size_t nBlocks = snapshot::Blocks(nSize);
+                    const size_t nMask = (nBlocks + 7) / 8;
+                    if(nData < nMask)
+                        return false;
+
+                    //the mask says how many bytes follow, check them before nSize,
+                    //which is only the sender's word, is allocated
+                    size_t nChanged = 0;
+                    for(size_t i = 0; i < nMask; i++)
+                        nChanged += size_t(__builtin_popcount(pData[i]));
+                    const size_t nTail = nBlocks % 8;
+                    if(nTail != 0 && (pData[nMask - 1] >> nTail) != 0)
+                        return false;
+                    size_t nExpected = nChanged * snapshot::nBlock;
+                    if(nBlocks > 0 && (pData[(nBlocks - 1) / 8] & (1u << ((nBlocks - 1) % 8))) != 0)
+                        nExpected -= nBlocks * snapshot::nBlock - nSize;
+                    if(nMask + nExpected != nData)
+                        return false;
+
+                    vState.assign(vBase.begin(), vBase.begin() + std::min(vBase.size(), nSize));
+                    vState.resize(nSize, 0);
+                    size_t nOffset = nMask;
+                    for(size_t i = 0; i < nBlocks; i++)
+                    {
+                        if(i % 8 == 0 && pData[i / 8] == 0)
+                        {
+                            i += 7;
+                            continue;
+                        }
+                        if((pData[i / 8] & (1u << (i % 8))) == 0)
+                            continue;
+
+                        size_t nBytes = std::min(snapshot::nBlock, nSize - i * snapshot::nBlock);
+                        uint8_t* pBlock = vState.data() + i * snapshot::nBlock;
+                        for(size_t b = 0; b < nBytes; b++)
+                            pBlock[b] ^= pData[nOffset + b];
+                        nOffset += nBytes;
+                    }
+                    return nOffset == nData;
+                }
+
+                size_t m_nMaxStates;
+                std::deque<std::pair<uint32_t, std::vector<uint8_t>>> m_dqStates;
+        };
+    }
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "olc_net.h"
+#include <future>
 
 using namespace std::chrono_literals;
 
@@ -12,10 +13,24 @@ enum class CustomMsgTypes : uint32_t{   //defining custom message types
     ServerMessage
 };
 
+//same protocol, but with bodies of up to 16 bytes kept inside the message
+enum class SmallMsgTypes : uint32_t{
+
+    ServerAccept,
+    ServerPing
+};
+
+template <>
+struct olc::net::message_body<SmallMsgTypes>
+{
+    using type = olc::net::small_body<16>;
+};
+
 class CustomServer : public olc::net::server_interface<CustomMsgTypes>
 {
     public:
         CustomServer(uint16_t nPort) : olc::net::server_interface<CustomMsgTypes>(nPort){};
+        CustomServer(const std::string& sPath) : olc::net::server_interface<CustomMsgTypes>(sPath){};
 
     public:
         //finally, all it does is provide implementations for the three functions we expect the user to override
@@ -31,6 +46,13 @@ class CustomServer : public olc::net::server_interface<CustomMsgTypes>
             return true;
         }
 
+        virtual void OnMessage(std::shared_ptr<olc::net::connection<CustomMsgTypes>> client, olc::net::message<CustomMsgTypes>& msg){
+
+            //simply bounce pings back to the client
+            if(msg.header.id == CustomMsgTypes::ServerPing)
+                client -> Send(msg);
+        }
+
 };
 
 class CustomClient : public olc::net::client_interface<CustomMsgTypes>
@@ -182,7 +204,2241 @@ TEST(TestClientConnect, ClientsIDsCheck)
     delete client3;
 }
 
-int main(int argc, char **argv) 
+/*
+    @brief Local socket transport
+    Testing a client can connect through an AF_UNIX socket path and that messages
+    make the round trip exactly as they do over TCP
+*/
+TEST(TestLocalConnect, LocalPingCheck)
+{
+
+    CustomServer *serverpointer = new CustomServer(std::string("/tmp/olc_net_test.sock"));
+    CustomClient *client = new CustomClient;
+
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_TRUE(client -> ConnectLocal("/tmp/olc_net_test.sock"));
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_TRUE(client -> IsConnected());
+    ASSERT_EQ(10000, serverpointer -> m_deqConnections.back() -> GetID());
+
+    olc::net::message<CustomMsgTypes> msg;
+    msg.header.id = CustomMsgTypes::ServerPing;
+    msg << uint64_t(0xC0FFEE);
+    client -> Send(msg);
+    std::this_thread::sleep_for(500ms);
+
+    serverpointer -> Update();
+    std::this_thread::sleep_for(500ms);
+
+    //first the accept message, then the bounced ping
+    ASSERT_EQ(2, client -> Incoming().count());
+    ASSERT_EQ(CustomMsgTypes::ServerAccept, client -> Incoming().pop_front().msg.header.id);
+
+    auto reply = client -> Incoming().pop_front().msg;
+    uint64_t nValue = 0;
+    reply >> nValue;
+    ASSERT_EQ(CustomMsgTypes::ServerPing, reply.header.id);
+    ASSERT_EQ(0xC0FFEE, nValue);
+
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+
+/*
+    @brief Shared memory transport
+    Testing a local client that asks for shared memory gets it, and that messages
+    still arrive through the same queues and callbacks
+*/
+TEST(TestLocalConnect, SharedMemoryPingCheck)
+{
+
+    CustomServer *serverpointer = new CustomServer(std::string("/tmp/olc_net_test.sock"));
+    CustomClient *client = new CustomClient;
+
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_TRUE(client -> ConnectSharedMemory("/tmp/olc_net_test.sock"));
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_TRUE(client -> IsConnected());
+    ASSERT_TRUE(serverpointer -> m_deqConnections.back() -> GetFeatures() & olc::net::connection<CustomMsgTypes>::shared_memory);
+    ASSERT_TRUE(client -> m_connection -> GetFeatures() & olc::net::connection<CustomMsgTypes>::shared_memory);
+
+    olc::net::message<CustomMsgTypes> msg;
+    msg.header.id = CustomMsgTypes::ServerPing;
+    msg.body.resize(3 * olc::net::shm::nRingCapacity);    //more than the ring holds at once
+    msg.body.back() = 42;
+    msg << uint64_t(0xC0FFEE);
+    client -> Send(msg);
+    std::this_thread::sleep_for(500ms);
+
+    serverpointer -> Update();
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_EQ(2, client -> Incoming().count());
+    ASSERT_EQ(CustomMsgTypes::ServerAccept, client -> Incoming().pop_front().msg.header.id);
+
+    auto reply = client -> Incoming().pop_front().msg;
+    uint64_t nValue = 0;
+    reply >> nValue;
+    ASSERT_EQ(0xC0FFEE, nValue);
+    ASSERT_EQ(3 * olc::net::shm::nRingCapacity, reply.body.size());
+    ASSERT_EQ(42, reply.body.back());
+
+    //the server notices the client going away through the socket
+    client -> Disconnect();
+    std::this_thread::sleep_for(500ms);
+    ASSERT_FALSE(serverpointer -> m_deqConnections.back() -> IsConnected());
+
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+
+/*
+    @brief Shared memory region ownership
+    Testing the server only maps a region owned by the socket's peer and closed to
+    everyone else, and a region nobody opened loses its name with the client
+*/
+TEST(TestLocalConnect, SharedMemoryRegionCheck)
+{
+    const std::string sName = olc::net::shm::region::Name(olc::net::shm::Random());
+
+    {
+        olc::net::shm::region client;
+        ASSERT_TRUE(client.Create(sName));
+
+        olc::net::shm::region stranger;
+        ASSERT_FALSE(stranger.Open(sName, ::getuid() + 1));
+
+        //opened up to the group, it could have been written by someone else
+        int fd = ::shm_open(sName.c_str(), O_RDWR, 0);
+        ASSERT_GE(fd, 0);
+        ::fchmod(fd, 0660);
+        olc::net::shm::region loose;
+        ASSERT_FALSE(loose.Open(sName, ::getuid()));
+        ::fchmod(fd, 0600);
+        ::close(fd);
+
+        olc::net::shm::region server;
+        ASSERT_TRUE(server.Open(sName, ::getuid()));
+        ASSERT_LT(::shm_open(sName.c_str(), O_RDWR, 0), 0);
+    }
+
+    {
+        olc::net::shm::region client;
+        ASSERT_TRUE(client.Create(sName));
+        client.Unlink();
+        ASSERT_LT(::shm_open(sName.c_str(), O_RDWR, 0), 0);
+    }
+}
+
+/*
+    @brief Shared memory shutdown
+    Testing a server stops while its shared memory readers are busy in inline
+    handlers that message every client
+*/
+TEST(TestLocalConnect, SharedMemoryInlineStopCheck)
+{
+
+    CustomServer *serverpointer = new CustomServer(std::string("/tmp/olc_net_test.sock"));
+    serverpointer -> SetInlineDispatch(true);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    std::vector<std::unique_ptr<CustomClient>> vClients;
+    for(size_t i = 0; i < 2; i++)
+    {
+        vClients.push_back(std::make_unique<CustomClient>());
+        ASSERT_TRUE(vClients.back() -> ConnectSharedMemory("/tmp/olc_net_test.sock"));
+    }
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::message<CustomMsgTypes> msg;
+    msg.header.id = CustomMsgTypes::MessageAll;
+    for(size_t i = 0; i < 2000; i++)
+        vClients[i % 2] -> Send(msg);
+    std::this_thread::sleep_for(5ms);
+
+    //must not hang on a reader that is waiting for the connection list
+    serverpointer -> Stop();
+    delete serverpointer;
+
+    for(auto& client : vClients)
+        client -> Disconnect();
+}
+
+/*
+    @brief Shared memory ring indices
+    Testing a ring whose indices the other process has pushed out of range moves
+    no bytes and reports itself corrupt, rather than copying past its end
+*/
+TEST(TestLocalConnect, SharedMemoryCorruptRingCheck)
+{
+    std::vector<uint8_t> vData(olc::net::shm::nRingCapacity);
+    std::vector<uint8_t> vBytes(3 * olc::net::shm::nRingCapacity);
+
+    //a tail past the head, as if more was read than was ever written
+    olc::net::shm::ring_header header;
+    header.nTail = uint64_t(1) << 63;
+    olc::net::shm::ring producer(&header, vData.data());
+    ASSERT_EQ(0, producer.write(vBytes.data(), vBytes.size()));
+    ASSERT_TRUE(producer.corrupt());
+
+    //a head further ahead than the ring holds
+    olc::net::shm::ring_header header2;
+    header2.nHead = 2 * olc::net::shm::nRingCapacity;
+    olc::net::shm::ring consumer(&header2, vData.data());
+    ASSERT_EQ(0, consumer.read(vBytes.data(), vBytes.size()));
+    ASSERT_TRUE(consumer.corrupt());
+
+    //and it stays that way once the indices look sane again
+    header2.nHead = 0;
+    ASSERT_EQ(0, consumer.read(vBytes.data(), 1));
+
+    //a ring in order still works
+    olc::net::shm::ring_header header3;
+    olc::net::shm::ring sane(&header3, vData.data());
+    ASSERT_EQ(olc::net::shm::nRingCapacity, sane.write(vBytes.data(), vBytes.size()));
+    ASSERT_FALSE(sane.corrupt());
+}
+
+/*
+    @brief Batched socket I/O
+    Testing frames of every shape - empty, small and larger than a receive block -
+    arrive whole and in order when both ends read in batches and gather writes
+*/
+TEST(TestBatchedIO, BatchedRoundTripCheck)
+{
+
+    CustomServer *serverpointer = new CustomServer(60000);
+    CustomClient *client = new CustomClient;
+
+    serverpointer -> SetBatchedIO(true);
+    client -> SetBatchedIO(true);
+
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(500ms);
+
+    for(uint32_t i = 0; i < 200; i++){
+
+        olc::net::message<CustomMsgTypes> msg;
+        msg.header.id = CustomMsgTypes::ServerPing;
+        if(i % 50 == 7)
+            msg.body.resize(100 * 1024, uint8_t(i));
+        if(i % 10 != 3)
+            msg << i;
+        client -> Send(msg);
+    }
+    std::this_thread::sleep_for(500ms);
+
+    serverpointer -> Update();
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_EQ(201, client -> Incoming().count());
+    ASSERT_EQ(CustomMsgTypes::ServerAccept, client -> Incoming().pop_front().msg.header.id);
+
+    for(uint32_t i = 0; i < 200; i++){
+
+        auto reply = client -> Incoming().pop_front().msg;
+        ASSERT_EQ(CustomMsgTypes::ServerPing, reply.header.id);
+
+        if(i % 10 == 3){
+            ASSERT_EQ(0, reply.body.size());
+            continue;
+        }
+
+        uint32_t nValue = 0;
+        reply >> nValue;
+        ASSERT_EQ(i, nValue);
+        ASSERT_EQ(i % 50 == 7 ? 100 * 1024 : 0, reply.body.size());
+    }
+
+    //many frames were cut out of each read
+    auto& stats = serverpointer -> m_deqConnections.back() -> GetIOStats();
+    ASSERT_EQ(200, stats.nMessagesIn);
+    ASSERT_LT(stats.nReads, stats.nMessagesIn);
+
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+/*
+    @brief Coroutine API
+    Testing a server running one coroutine per client and a client driving the
+    connection with co_await, without either side touching the incoming queue
+*/
+TEST(TestCoroutines, EchoSessionCheck)
+{
+
+    CustomServer *serverpointer = new CustomServer(60000);
+    CustomClient *client = new CustomClient;
+
+    serverpointer -> SetSessionHandler([](std::shared_ptr<olc::net::connection<CustomMsgTypes>> conn) -> boost::asio::awaitable<void> {
+
+        for(;;){
+            auto msg = co_await conn -> AsyncReceive();
+            msg.header.id = CustomMsgTypes::ServerMessage;
+            co_await conn -> AsyncSend(msg);
+        }
+    });
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    std::promise<std::vector<uint32_t>> results;
+    client -> Spawn([&]() -> boost::asio::awaitable<void> {
+
+        std::vector<uint32_t> vReplies;
+        if(co_await client -> AsyncConnect("127.0.0.1", 60000)){
+
+            //the server says hello from OnClientConnect first
+            auto accept = co_await client -> AsyncReceive();
+            vReplies.push_back(uint32_t(accept.header.id));
+
+            for(uint32_t i = 0; i < 3; i++){
+
+                olc::net::message<CustomMsgTypes> msg;
+                msg.header.id = CustomMsgTypes::ServerPing;
+                msg << i;
+                co_await client -> AsyncSend(msg);
+
+                auto reply = co_await client -> AsyncReceive();
+                uint32_t nValue = 0;
+                reply >> nValue;
+                vReplies.push_back(nValue);
+            }
+        }
+        results.set_value(vReplies);
+    });
+
+    auto future = results.get_future();
+    ASSERT_EQ(std::future_status::ready, future.wait_for(5s));
+    ASSERT_EQ(std::vector<uint32_t>({uint32_t(CustomMsgTypes::ServerAccept), 0, 1, 2}), future.get());
+    ASSERT_TRUE(client -> Incoming().empty());
+
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+
+/*
+    @brief Coroutine bootstrap
+    Testing AsyncReceive() reads through a bootstrap of over a thousand pieces and
+    completes once, with the whole state
+*/
+TEST(TestCoroutines, BootstrapCheck)
+{
+
+    CustomServer *serverpointer = new CustomServer(60000);
+    CustomClient *client = new CustomClient;
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    auto pState = std::make_shared<olc::net::message<CustomMsgTypes>>();
+    pState -> header.id = CustomMsgTypes::ServerMessage;
+    pState -> body.resize(100000);
+    for(size_t i = 0; i < pState -> body.size(); i++)
+        pState -> body[i] = uint8_t(i * 11);
+    pState -> header.size = pState -> size();
+
+    std::promise<olc::net::message<CustomMsgTypes>> result;
+    client -> Spawn([&]() -> boost::asio::awaitable<void> {
+
+        if(co_await client -> AsyncConnect("127.0.0.1", 60000)){
+
+            co_await client -> AsyncReceive();
+            result.set_value(co_await client -> AsyncReceive());
+        }
+    });
+    std::this_thread::sleep_for(500ms);
+
+    serverpointer -> BootstrapClient(serverpointer -> m_deqConnections.front(), pState, 64);
+    auto future = result.get_future();
+    ASSERT_EQ(std::future_status::ready, future.wait_for(5s));
+    auto state = future.get();
+    ASSERT_EQ(CustomMsgTypes::ServerMessage, state.header.id);
+    ASSERT_EQ(pState -> body.size(), state.body.size());
+    ASSERT_TRUE(std::equal(state.body.begin(), state.body.end(), pState -> body.begin()));
+
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+#endif
+
+/*
+    @brief Inline dispatch
+    Testing OnMessage runs on the reading thread for both the server and the client,
+    so a round trip completes without Update() and without touching Incoming()
+*/
+class InlineClient : public olc::net::client_interface<CustomMsgTypes>
+{
+    public:
+        std::mutex mux;
+        std::vector<CustomMsgTypes> vReceived;
+        std::thread::id threadReader;
+
+    protected:
+        virtual void OnMessage(olc::net::message<CustomMsgTypes>& msg){
+
+            std::scoped_lock lock(mux);
+            vReceived.push_back(msg.header.id);
+            threadReader = std::this_thread::get_id();
+        }
+};
+
+TEST(TestInlineDispatch, InlineRoundTripCheck)
+{
+
+    CustomServer *serverpointer = new CustomServer(60000);
+    InlineClient *client = new InlineClient;
+
+    serverpointer -> SetInlineDispatch(true);
+    client -> SetInlineDispatch(true);
+
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::message<CustomMsgTypes> msg;
+    msg.header.id = CustomMsgTypes::ServerPing;
+    client -> Send(msg);
+    std::this_thread::sleep_for(500ms);
+
+    //no Update(), the server bounced the ping straight from its asio thread
+    {
+        std::scoped_lock lock(client -> mux);
+        ASSERT_EQ(std::vector<CustomMsgTypes>({CustomMsgTypes::ServerAccept, CustomMsgTypes::ServerPing}), client -> vReceived);
+        ASSERT_NE(std::this_thread::get_id(), client -> threadReader);
+    }
+    ASSERT_TRUE(client -> Incoming().empty());
+
+    client -> Disconnect();
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+
+/*
+    @brief Message dispatch and filtering
+    Testing frames the dispatcher has no handler for are turned away at read time,
+    on the plain and the batched read path, while known ones still get through
+*/
+TEST(TestDispatcher, UnknownFrameFilterCheck)
+{
+
+    for(bool bBatched : {false, true}){
+
+        olc::net::dispatcher<CustomMsgTypes> dispatch;
+        dispatch.on<CustomMsgTypes::ServerPing>([](auto client, auto& msg){ client -> Send(msg); });
+
+        CustomServer *serverpointer = new CustomServer(60000);
+        CustomClient *client = new CustomClient;
+
+        serverpointer -> SetBatchedIO(bBatched);
+        serverpointer -> SetMessageFilter(dispatch.filter());
+
+        ASSERT_TRUE(serverpointer -> Start());
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+        std::this_thread::sleep_for(500ms);
+
+        //a large frame nobody handles, a ping, then a bodyless unknown frame
+        olc::net::message<CustomMsgTypes> msgJunk;
+        msgJunk.header.id = CustomMsgTypes::ServerDeny;
+        msgJunk.body.resize(1024 * 1024);
+        msgJunk.header.size = msgJunk.body.size();
+        client -> Send(msgJunk);
+
+        olc::net::message<CustomMsgTypes> msgPing;
+        msgPing.header.id = CustomMsgTypes::ServerPing;
+        msgPing << uint32_t(42);
+        client -> Send(msgPing);
+
+        olc::net::message<CustomMsgTypes> msgAll;
+        msgAll.header.id = CustomMsgTypes::MessageAll;
+        client -> Send(msgAll);
+        std::this_thread::sleep_for(500ms);
+
+        //only the ping made it into the queue
+        ASSERT_EQ(1, serverpointer -> m_deqConnections.back() -> GetIOStats().nMessagesIn);
+        ASSERT_EQ(2, serverpointer -> m_deqConnections.back() -> GetIOStats().nRejected);
+
+        serverpointer -> Update();
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_EQ(2, client -> Incoming().count());
+        client -> Incoming().pop_front();
+        auto reply = client -> Incoming().pop_front().msg;
+        uint32_t nValue = 0;
+        reply >> nValue;
+        ASSERT_EQ(CustomMsgTypes::ServerPing, reply.header.id);
+        ASSERT_EQ(42, nValue);
+
+        //and the dispatcher itself counts what it cannot route
+        ASSERT_FALSE(dispatch(nullptr, msgAll));
+        ASSERT_EQ(1, dispatch.unknown());
+
+        client -> Disconnect();
+        serverpointer -> Stop();
+
+        delete client;
+        delete serverpointer;
+    }
+}
+
+/*
+    @brief Message writer/reader
+    Testing fields come back in the order they were written, strings and vectors
+    included, and that reading past the end throws rather than overrunning
+*/
+TEST(TestMessage, WriterReaderRoundTripCheck)
+{
+
+    olc::net::message<CustomMsgTypes> msg;
+    olc::net::message_writer<CustomMsgTypes> writer(msg);
+    writer.reserve(64);
+    writer << uint32_t(7) << std::string("hello") << std::vector<float>({1.0f, 2.5f, -3.0f}) << "lit" << uint8_t(0xAB);
+
+    ASSERT_EQ(msg.body.size(), msg.header.size);
+    ASSERT_EQ(4 + 4 + 5 + 4 + 12 + 4 + 3 + 1, msg.body.size());
+
+    olc::net::message_reader<CustomMsgTypes> reader(msg);
+    uint32_t nValue = 0;
+    std::string sText, sLiteral;
+    std::vector<float> vFloats;
+    reader >> nValue >> sText >> vFloats >> sLiteral;
+
+    ASSERT_EQ(7, nValue);
+    ASSERT_EQ("hello", sText);
+    ASSERT_EQ(std::vector<float>({1.0f, 2.5f, -3.0f}), vFloats);
+    ASSERT_EQ("lit", sLiteral);
+    ASSERT_EQ(0xAB, reader.read<uint8_t>());
+    ASSERT_EQ(0, reader.remaining());
+
+    //nothing left, and a length prefix claiming more than there is
+    ASSERT_THROW(reader.read<uint8_t>(), std::out_of_range);
+
+    olc::net::message<CustomMsgTypes> msgShort;
+    olc::net::message_writer<CustomMsgTypes>(msgShort) << uint32_t(1000);
+    olc::net::message_reader<CustomMsgTypes> readerShort(msgShort);
+    ASSERT_THROW(readerShort >> vFloats, std::out_of_range);
+}
+
+/*
+    @brief Message views
+    Testing a server reading fields in place from views, on the plain and the batched
+    read path, and that a kept view holds its receive block until it is released
+*/
+class ViewServer : public CustomServer
+{
+    public:
+        ViewServer(uint16_t nPort) : CustomServer(nPort){}
+
+        std::mutex mux;
+        std::vector<std::string> vNames;
+        std::vector<uint32_t> vIndices;
+        olc::net::message_view<CustomMsgTypes> viewKept;
+
+        size_t BlocksAvailable(){
+
+            return (m_pRecvPool ? m_pRecvPool : m_pViewPool) -> Available();
+        }
+
+    protected:
+        virtual void OnMessageView(std::shared_ptr<olc::net::connection<CustomMsgTypes>> client, olc::net::message_view<CustomMsgTypes>& view){
+
+            std::scoped_lock lock(mux);
+            auto reader = view.reader();
+            vIndices.push_back(view.get<uint32_t>(0));
+            reader.read<uint32_t>();
+            std::string sName;
+            reader >> sName;
+            vNames.push_back(sName);
+
+            viewKept = view;
+        }
+};
+
+TEST(TestMessageView, ViewDispatchCheck)
+{
+
+    for(bool bBatched : {false, true}){
+
+        ViewServer *serverpointer = new ViewServer(60000);
+        CustomClient *client = new CustomClient;
+
+        serverpointer -> SetBatchedIO(bBatched);
+        serverpointer -> SetViewDispatch(true);
+
+        ASSERT_TRUE(serverpointer -> Start());
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+        std::this_thread::sleep_for(500ms);
+
+        for(uint32_t i = 0; i < 3; i++){
+
+            olc::net::message<CustomMsgTypes> msg;
+            msg.header.id = CustomMsgTypes::ServerPing;
+            olc::net::message_writer<CustomMsgTypes>(msg) << i << ("view" + std::to_string(i));
+            client -> Send(msg);
+        }
+        std::this_thread::sleep_for(500ms);
+
+        {
+            std::scoped_lock lock(serverpointer -> mux);
+            ASSERT_EQ(std::vector<uint32_t>({0, 1, 2}), serverpointer -> vIndices);
+            ASSERT_EQ(std::vector<std::string>({"view0", "view1", "view2"}), serverpointer -> vNames);
+            ASSERT_THROW(serverpointer -> viewKept.get<uint64_t>(serverpointer -> viewKept.size() - 4), std::out_of_range);
+
+            //the kept view is all that still holds its block back
+            size_t nAvailable = serverpointer -> BlocksAvailable();
+            serverpointer -> viewKept.release();
+            ASSERT_EQ(nAvailable + 1, serverpointer -> BlocksAvailable());
+        }
+
+        //nothing went through the incoming queue, only the accept came back
+        serverpointer -> Update();
+        std::this_thread::sleep_for(200ms);
+        ASSERT_EQ(1, client -> Incoming().count());
+
+        client -> Disconnect();
+        serverpointer -> Stop();
+
+        delete client;
+        delete serverpointer;
+    }
+}
+
+/*
+    @brief Small buffer message bodies
+    Testing a body selected through message_body stays inline while small, spills to
+    the heap as it grows, and that such messages cross the network intact
+*/
+class SmallServer : public olc::net::server_interface<SmallMsgTypes>
+{
+    public:
+        SmallServer(uint16_t nPort) : olc::net::server_interface<SmallMsgTypes>(nPort){}
+
+    protected:
+        virtual bool OnClientConnect(std::shared_ptr<olc::net::connection<SmallMsgTypes>> client){
+
+            return true;
+        }
+
+        virtual void OnMessage(std::shared_ptr<olc::net::connection<SmallMsgTypes>> client, olc::net::message<SmallMsgTypes>& msg){
+
+            client -> Send(msg);
+        }
+};
+
+TEST(TestMessage, SmallBodyCheck)
+{
+
+    olc::net::message<SmallMsgTypes> msg;
+    msg << uint64_t(1) << uint64_t(2);
+    const uint8_t* pInline = msg.body.data();
+    ASSERT_EQ(16, msg.body.capacity());
+
+    //past 16 bytes it moves to the heap
+    msg << uint32_t(3);
+    ASSERT_NE(pInline, msg.body.data());
+    ASSERT_EQ(20, msg.header.size);
+
+    olc::net::message<SmallMsgTypes> msgCopy = msg;
+    olc::net::message<SmallMsgTypes> msgMoved = std::move(msgCopy);
+
+    uint64_t a = 0, b = 0;
+    uint32_t c = 0;
+    msgMoved >> c >> b >> a;
+    ASSERT_EQ(1, a);
+    ASSERT_EQ(2, b);
+    ASSERT_EQ(3, c);
+    ASSERT_EQ(20, msg.body.size());
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    serverpointer -> SetInlineDispatch(true);
+    olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::message<SmallMsgTypes> msgSmall;
+    msgSmall.header.id = SmallMsgTypes::ServerPing;
+    msgSmall << uint32_t(0xABCD);
+    client -> Send(msgSmall);
+
+    olc::net::message<SmallMsgTypes> msgLarge;
+    msgLarge.header.id = SmallMsgTypes::ServerPing;
+    msgLarge.body.resize(1000, 7);
+    msgLarge.header.size = msgLarge.size();
+    client -> Send(msgLarge);
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_EQ(2, client -> Incoming().count());
+    auto reply = client -> Incoming().pop_front().msg;
+    uint32_t nValue = 0;
+    reply >> nValue;
+    ASSERT_EQ(0xABCD, nValue);
+
+    reply = client -> Incoming().pop_front().msg;
+    ASSERT_EQ(1000, reply.body.size());
+    ASSERT_EQ(7, reply.body.back());
+
+    client -> Disconnect();
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+
+/*
+    @brief Portable wire header
+    Testing the encoded header against hand written bytes, that the ID type's width
+    does not change them, and that compact headers cross the network intact
+*/
+enum class TinyMsgTypes : uint8_t{
+
+    ServerAccept,
+    ServerPing
+};
+
+TEST(TestWire, HeaderLayoutCheck)
+{
+
+    olc::net::message_header<CustomMsgTypes> header;
+    header.id = CustomMsgTypes::ServerMessage;
+    header.size = 300;
+
+    std::array<uint8_t, olc::net::wire::nMaxHeader> aBytes{};
+    const uint8_t aFull[] = { olc::net::wire::nVersion, 0x00, 0x04, 0x00, 0x00, 0x00, 0x2C, 0x01, 0x00, 0x00 };
+    ASSERT_EQ(sizeof(aFull), olc::net::wire::Encode(header, false, aBytes.data()));
+    ASSERT_EQ(0, std::memcmp(aFull, aBytes.data(), sizeof(aFull)));
+
+    //a build with a narrower ID type puts the same bytes on the wire
+    olc::net::message_header<TinyMsgTypes> tiny;
+    tiny.id = TinyMsgTypes::ServerPing;
+    tiny.size = 300;
+    std::array<uint8_t, olc::net::wire::nMaxHeader> aTiny{};
+    olc::net::wire::Encode(tiny, false, aTiny.data());
+    olc::net::message_header<CustomMsgTypes> wide;
+    ASSERT_TRUE(olc::net::wire::Decode(aTiny.data(), false, wide));
+    ASSERT_EQ(CustomMsgTypes::ServerDeny, wide.id);
+    ASSERT_EQ(300, wide.size);
+
+    //but an ID too wide for it is refused rather than cut down
+    wide.id = static_cast<CustomMsgTypes>(0x1234);
+    for(bool bCompact : { false, true })
+    {
+        olc::net::wire::Encode(wide, bCompact, aTiny.data());
+        ASSERT_FALSE(olc::net::wire::Decode(aTiny.data(), bCompact, tiny));
+    }
+    wide.id = static_cast<CustomMsgTypes>(0x34);
+    olc::net::wire::Encode(wide, true, aTiny.data());
+    ASSERT_TRUE(olc::net::wire::Decode(aTiny.data(), true, tiny));
+    ASSERT_EQ(0x34, uint8_t(tiny.id));
+
+    //compact: one byte of ID, size code 2 (two bytes)
+    const uint8_t aCompact[] = { olc::net::wire::nVersion, 0x80, 0x04, 0x2C, 0x01 };
+    ASSERT_EQ(sizeof(aCompact), olc::net::wire::Encode(header, true, aBytes.data()));
+    ASSERT_EQ(0, std::memcmp(aCompact, aBytes.data(), sizeof(aCompact)));
+    ASSERT_EQ(sizeof(aCompact), olc::net::wire::Length(aBytes.data(), true));
+
+    olc::net::message_header<CustomMsgTypes> decoded;
+    ASSERT_TRUE(olc::net::wire::Decode(aBytes.data(), true, decoded));
+    ASSERT_EQ(CustomMsgTypes::ServerMessage, decoded.id);
+    ASSERT_EQ(300, decoded.size);
+
+    //a bodyless frame needs no size bytes at all
+    header.size = 0;
+    ASSERT_EQ(3, olc::net::wire::Encode(header, true, aBytes.data()));
+
+    aBytes[0] = olc::net::wire::nVersion + 1;
+    ASSERT_FALSE(olc::net::wire::Decode(aBytes.data(), true, decoded));
+
+    //features this build knows pass, the reserved compression bit doesn't
+    olc::net::wire::Encode(header, true, aBytes.data(), olc::net::wire::control);
+    ASSERT_TRUE(olc::net::wire::Decode(aBytes.data(), true, decoded));
+    olc::net::wire::Encode(header, true, aBytes.data(), olc::net::wire::compressed);
+    ASSERT_FALSE(olc::net::wire::Decode(aBytes.data(), true, decoded));
+    olc::net::wire::Encode(header, false, aBytes.data());
+    aBytes[1] = 0x40;
+    ASSERT_FALSE(olc::net::wire::Decode(aBytes.data(), false, decoded));
+
+    for(bool bBatched : { false, true })
+    {
+        SmallServer *serverpointer = new SmallServer(60000);
+        serverpointer -> SetInlineDispatch(true);
+        serverpointer -> SetBatchedIO(bBatched);
+        olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+        client -> SetCompactHeaders(true);
+        client -> SetBatchedIO(bBatched);
+
+        ASSERT_TRUE(serverpointer -> Start());
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+        std::this_thread::sleep_for(500ms);
+        ASSERT_TRUE(client -> m_connection -> GetFeatures() & olc::net::connection<SmallMsgTypes>::feature::compact_header);
+
+        olc::net::message<SmallMsgTypes> msgEmpty;
+        msgEmpty.header.id = SmallMsgTypes::ServerPing;
+        client -> Send(msgEmpty);
+
+        olc::net::message<SmallMsgTypes> msgLarge;
+        msgLarge.header.id = SmallMsgTypes::ServerPing;
+        msgLarge.body.resize(70000, 9);
+        msgLarge.header.size = msgLarge.size();
+        client -> Send(msgLarge);
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_EQ(2, client -> Incoming().count());
+        ASSERT_EQ(0, client -> Incoming().pop_front().msg.size());
+        auto reply = client -> Incoming().pop_front().msg;
+        ASSERT_EQ(70000, reply.size());
+        ASSERT_EQ(9, reply.body.back());
+
+        client -> Disconnect();
+        serverpointer -> Stop();
+
+        delete client;
+        delete serverpointer;
+    }
+}
+
+/*
+    @brief Frame checksums
+    Testing CRC32C against its check value on both implementations, that checksummed
+    frames cross the network intact, and that a frame with a bad trailer is caught
+*/
+TEST(TestWire, FrameChecksumCheck)
+{
+
+    const char* sCheck = "123456789";
+    ASSERT_EQ(0xE3069283, olc::net::crc32c(reinterpret_cast<const uint8_t*>(sCheck), 9));
+
+    std::vector<uint8_t> vData(1000);
+    for(size_t i = 0; i < vData.size(); i++)
+        vData[i] = uint8_t(i * 7 + 3);
+    for(size_t n : { 0, 1, 7, 8, 9, 63, 1000 })
+    {
+        uint32_t nCrc = olc::net::crc32c(vData.data(), n);
+        ASSERT_EQ(nCrc, ~olc::net::detail::crc32c_portable(vData.data(), n, ~0u));
+        ASSERT_EQ(nCrc, olc::net::crc32c(vData.data() + n / 2, n - n / 2, olc::net::crc32c(vData.data(), n / 2)));
+    }
+
+    for(bool bBatched : { false, true })
+    {
+        SmallServer *serverpointer = new SmallServer(60000);
+        serverpointer -> SetInlineDispatch(true);
+        serverpointer -> SetBatchedIO(bBatched);
+        olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+        client -> SetFrameChecksums(true);
+        client -> SetCompactHeaders(bBatched);
+        client -> SetBatchedIO(bBatched);
+
+        ASSERT_TRUE(serverpointer -> Start());
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+        std::this_thread::sleep_for(500ms);
+        ASSERT_TRUE(client -> m_connection -> GetFeatures() & olc::net::connection<SmallMsgTypes>::feature::frame_checksum);
+
+        olc::net::message<SmallMsgTypes> msgEmpty;
+        msgEmpty.header.id = SmallMsgTypes::ServerPing;
+        client -> Send(msgEmpty);
+
+        olc::net::message<SmallMsgTypes> msgLarge;
+        msgLarge.header.id = SmallMsgTypes::ServerPing;
+        msgLarge.body.resize(70000, 5);
+        msgLarge.header.size = msgLarge.size();
+        client -> Send(msgLarge);
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_EQ(2, client -> Incoming().count());
+        ASSERT_EQ(0, client -> Incoming().pop_front().msg.size());
+        ASSERT_EQ(70000, client -> Incoming().pop_front().msg.size());
+        ASSERT_EQ(0, client -> m_connection -> GetIOStats().nCorrupt);
+
+        client -> Disconnect();
+        serverpointer -> Stop();
+
+        delete client;
+        delete serverpointer;
+    }
+
+    //a hand rolled client that answers the handshake, then damages a frame
+    SmallServer *serverpointer = new SmallServer(60000);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    boost::asio::io_context context;
+    boost::asio::ip::tcp::socket socket(context);
+    socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 60000));
+
+    uint8_t aValidation[12];
+    boost::asio::read(socket, boost::asio::buffer(aValidation));
+    uint64_t nAnswer = olc::net::wire::Get(aValidation, 8) ^ 0xDEADBEEFC0DECAFE;
+    nAnswer = (nAnswer & 0xF0F0F0F0F0F0F0) >> 4 | (nAnswer & 0x0F0F0F0F0F0F0F) << 4;
+    olc::net::wire::Put(aValidation, nAnswer ^ 0xC0DEFACE12345678, 8);
+    olc::net::wire::Put(aValidation + 8, olc::net::connection<SmallMsgTypes>::feature::frame_checksum, 4);
+    boost::asio::write(socket, boost::asio::buffer(aValidation));
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::message<SmallMsgTypes> msg;
+    msg.header.id = SmallMsgTypes::ServerPing;
+    msg << uint32_t(42);
+    uint8_t aFrame[olc::net::wire::nMaxHeader + 4 + olc::net::wire::nTrailer];
+    size_t nHeader = olc::net::wire::Encode(msg.header, false, aFrame);
+    std::memcpy(aFrame + nHeader, msg.body.data(), 4);
+    olc::net::wire::Put(aFrame + nHeader + 4, olc::net::crc32c(aFrame, nHeader + 4), olc::net::wire::nTrailer);
+    aFrame[nHeader] ^= 0x01;
+    boost::asio::write(socket, boost::asio::buffer(aFrame, nHeader + 4 + olc::net::wire::nTrailer));
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_EQ(1, serverpointer -> m_deqConnections.size());
+    ASSERT_EQ(1, serverpointer -> m_deqConnections.front() -> GetIOStats().nCorrupt);
+    ASSERT_FALSE(serverpointer -> m_deqConnections.front() -> IsConnected());
+
+    socket.close();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+/*
+    @brief Handshake limits
+    Testing that clients which never answer validation are dropped at the deadline,
+    that sockets over the pending limit are closed straight after accept, and that
+    a well behaved client still gets in afterwards
+*/
+TEST(TestServerConnect, HandshakeLimitCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    serverpointer -> SetHandshakeLimits(700ms, 2);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    //connect and go quiet
+    boost::asio::io_context context;
+    std::vector<boost::asio::ip::tcp::socket> vSockets;
+    for(int i = 0; i < 3; i++)
+    {
+        vSockets.emplace_back(context);
+        vSockets.back().connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 60000));
+        std::this_thread::sleep_for(100ms);
+    }
+
+    auto stats = serverpointer -> GetHandshakeStats();
+    ASSERT_EQ(2, stats.nPending);
+    ASSERT_EQ(1, stats.nRejected);
+    ASSERT_EQ(2, serverpointer -> m_deqConnections.size());
+
+    //the rejected socket is closed before any validation data is sent
+    uint8_t aValidation[12];
+    boost::system::error_code ec;
+    boost::asio::read(vSockets[2], boost::asio::buffer(aValidation), ec);
+    ASSERT_EQ(boost::asio::error::eof, ec);
+
+    std::this_thread::sleep_for(800ms);
+    stats = serverpointer -> GetHandshakeStats();
+    ASSERT_EQ(0, stats.nPending);
+    ASSERT_EQ(2, stats.nTimedOut);
+    ASSERT_FALSE(serverpointer -> m_deqConnections.front() -> IsConnected());
+
+    olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+    ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(500ms);
+    ASSERT_TRUE(client -> IsConnected());
+    stats = serverpointer -> GetHandshakeStats();
+    ASSERT_EQ(0, stats.nPending);
+    ASSERT_EQ(0, stats.nFailed);
+    ASSERT_EQ(1, stats.nRejected);
+
+    client -> Disconnect();
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+
+/*
+    @brief Accept bursts
+    Testing that a burst of clients queued up before the server gets to them is
+    taken off the listen queue in batches by several outstanding accepts, and that
+    each of them is served
+*/
+TEST(TestServerConnect, AcceptBurstCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    serverpointer -> SetAcceptConcurrency(4, 8);
+    serverpointer -> SetListenBacklog(128);
+
+    //queue the burst up before the first accept is issued
+    boost::asio::io_context context;
+    std::vector<boost::asio::ip::tcp::socket> vSockets;
+    for(int i = 0; i < 100; i++)
+    {
+        vSockets.emplace_back(context);
+        vSockets.back().connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 60000));
+    }
+
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+    ASSERT_EQ(100, serverpointer -> GetHandshakeStats().nPending);
+
+    uint8_t aValidation[12];
+    for(auto& socket : vSockets)
+        ASSERT_EQ(12, boost::asio::read(socket, boost::asio::buffer(aValidation)));
+
+    vSockets.clear();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+//decides admission on a worker thread after a slow "lookup", letting even IDs in
+class AdmissionServer : public SmallServer
+{
+    public:
+        AdmissionServer(uint16_t nPort) : SmallServer(nPort){}
+
+        void OnClientAdmission(std::shared_ptr<olc::net::connection<SmallMsgTypes>> client, admission_handler fnAdmit) override{
+
+            bool bAdmit = client -> GetID() % 2 == 0;
+            vLookups.push_back(std::async(std::launch::async, [fnAdmit, bAdmit](){
+                std::this_thread::sleep_for(300ms);
+                fnAdmit(bAdmit);
+            }));
+        }
+
+        std::vector<std::future<void>> vLookups;
+};
+
+/*
+    @brief Asynchronous admission
+    Testing that clients wait in the pending state while admission is decided on
+    another thread, without holding up other accepts, and are let in or turned
+    away by the answer
+*/
+TEST(TestServerConnect, AsyncAdmissionCheck)
+{
+
+    AdmissionServer *serverpointer = new AdmissionServer(60000);
+    serverpointer -> SetInlineDispatch(true);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::client_interface<SmallMsgTypes> *clientAdmitted = new olc::net::client_interface<SmallMsgTypes>;
+    olc::net::client_interface<SmallMsgTypes> *clientRefused = new olc::net::client_interface<SmallMsgTypes>;
+    ASSERT_TRUE(clientAdmitted -> Connect("127.0.0.1", 60000));
+    ASSERT_TRUE(clientRefused -> Connect("127.0.0.1", 60000));
+
+    //both validated and waiting on their lookups at the same time
+    std::this_thread::sleep_for(150ms);
+    ASSERT_EQ(2, serverpointer -> GetHandshakeStats().nPending);
+
+    olc::net::message<SmallMsgTypes> msg;
+    msg.header.id = SmallMsgTypes::ServerPing;
+    msg << uint32_t(7);
+    clientAdmitted -> Send(msg);
+    std::this_thread::sleep_for(500ms);
+
+    auto stats = serverpointer -> GetHandshakeStats();
+    ASSERT_EQ(0, stats.nPending);
+    ASSERT_EQ(1, stats.nRefused);
+    ASSERT_TRUE(clientAdmitted -> IsConnected());
+    ASSERT_FALSE(clientRefused -> IsConnected());
+    ASSERT_EQ(1, clientAdmitted -> Incoming().count());
+
+    clientAdmitted -> Disconnect();
+    clientRefused -> Disconnect();
+    for(auto& lookup : serverpointer -> vLookups)
+        lookup.wait();
+    serverpointer -> Stop();
+
+    delete clientAdmitted;
+    delete clientRefused;
+    delete serverpointer;
+}
+
+/*
+    @brief Rate limits
+    Testing that pings over a client's budget are held back and then delivered
+    (plain and batched reads), dropped, or end the connection, as the policy says
+*/
+TEST(TestRateLimit, TokenBucketCheck)
+{
+
+    using limits = olc::net::rate_limits<SmallMsgTypes>;
+
+    olc::net::message<SmallMsgTypes> msg;
+    msg.header.id = SmallMsgTypes::ServerPing;
+    msg.body.resize(400);
+    msg.header.size = msg.size();
+
+    //20 pings a second with room for a burst of 10, so 30 take about a second
+    for(bool bBatched : { false, true })
+    {
+        SmallServer *serverpointer = new SmallServer(60000);
+        serverpointer -> SetInlineDispatch(true);
+        serverpointer -> SetBatchedIO(bBatched);
+        serverpointer -> SetRateLimits(std::make_shared<limits>(std::move(limits(limits::action::delay, 0.5).per_id(SmallMsgTypes::ServerPing, 20))));
+        olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+        client -> SetBatchedIO(bBatched);
+
+        ASSERT_TRUE(serverpointer -> Start());
+        std::this_thread::sleep_for(500ms);
+        ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+        std::this_thread::sleep_for(500ms);
+
+        for(int i = 0; i < 30; i++)
+            client -> Send(msg);
+        std::this_thread::sleep_for(300ms);
+        ASSERT_LT(client -> Incoming().count(), 25);
+
+        std::this_thread::sleep_for(1200ms);
+        ASSERT_EQ(30, client -> Incoming().count());
+        auto& stats = serverpointer -> m_deqConnections.front() -> GetIOStats();
+        ASSERT_GT(stats.nOverLimit, 0);
+        ASSERT_GT(stats.nThrottledUs, 500000);
+
+        client -> Disconnect();
+        serverpointer -> Stop();
+
+        delete client;
+        delete serverpointer;
+    }
+
+    //1000 body bytes a second: two 400 byte pings fit and the rest are dropped. Then
+    //one ping a second: the second ping ends the connection
+    for(auto onExceed : { limits::action::drop, limits::action::disconnect })
+    {
+        bool bDrop = onExceed == limits::action::drop;
+        limits rates(onExceed);
+        if(bDrop)
+            rates.total(0, 1000);
+        else
+            rates.per_id(SmallMsgTypes::ServerPing, 1);
+
+        SmallServer *serverpointer = new SmallServer(60000);
+        serverpointer -> SetInlineDispatch(true);
+        serverpointer -> SetRateLimits(std::make_shared<limits>(rates));
+        olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+
+        ASSERT_TRUE(serverpointer -> Start());
+        std::this_thread::sleep_for(500ms);
+        ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+        std::this_thread::sleep_for(500ms);
+
+        for(int i = 0; i < 5; i++)
+            client -> Send(msg);
+        std::this_thread::sleep_for(500ms);
+
+        //a disconnect leaves unread frames behind, the reset may beat the one echo
+        if(bDrop)
+        {
+            ASSERT_EQ(2, client -> Incoming().count());
+        }
+        ASSERT_EQ(bDrop, client -> IsConnected());
+        ASSERT_EQ(bDrop ? 3 : 1, serverpointer -> m_deqConnections.front() -> GetIOStats().nOverLimit);
+
+        client -> Disconnect();
+        serverpointer -> Stop();
+
+        delete client;
+        delete serverpointer;
+    }
+}
+
+/*
+    @brief Priority lanes
+    Testing that the outgoing queue serves the highest lane first, that bulk still
+    gets a turn while the lanes above are busy, and that a claimed message keeps its
+    place whatever is pushed after it
+*/
+TEST(TestSendQueue, PriorityLaneCheck)
+{
+
+    using olc::net::send_priority;
+    olc::net::send_queue<SmallMsgTypes> queue;
+    auto push = [&](uint32_t nTag, send_priority nPriority)
+    {
+        olc::net::message<SmallMsgTypes> msg;
+        msg << nTag;
+        queue.push(msg, nPriority);
+    };
+    auto pop = [&]()
+    {
+        uint32_t nTag = 0;
+        std::memcpy(&nTag, queue.front().body.data(), sizeof(nTag));
+        queue.pop_front();
+        return nTag;
+    };
+
+    push(1, send_priority::bulk);
+    push(2, send_priority::interactive);
+    push(3, send_priority::control);
+    push(4, send_priority::interactive);
+    ASSERT_EQ(3, pop());
+    ASSERT_EQ(2, pop());
+    ASSERT_EQ(4, pop());
+    ASSERT_EQ(1, pop());
+    ASSERT_TRUE(queue.empty());
+
+    //with bulk waiting, every 4th claim is a bulk one
+    queue.set_bulk_share(4);
+    for(uint32_t i = 0; i < 8; i++)
+        push(100 + i, send_priority::interactive);
+    push(200, send_priority::bulk);
+    push(201, send_priority::bulk);
+    std::vector<uint32_t> vOrder;
+    while(!queue.empty())
+        vOrder.push_back(pop());
+    ASSERT_EQ(std::vector<uint32_t>({ 100, 101, 102, 200, 103, 104, 105, 201, 106, 107 }), vOrder);
+
+    //a message being written stays at the front
+    push(1, send_priority::bulk);
+    ASSERT_EQ(1, queue.claim(1));
+    push(2, send_priority::control);
+    ASSERT_EQ(1, pop());
+    ASSERT_EQ(2, pop());
+}
+
+/*
+    @brief Message deadlines
+    Testing that messages past their deadline are dropped when claimed and counted by ID,
+    that their senders are told, and that a claimed message is never dropped
+*/
+TEST(TestSendQueue, ExpiryCheck)
+{
+
+    olc::net::send_queue<SmallMsgTypes> queue;
+    auto push = [&](SmallMsgTypes id, std::chrono::milliseconds tTtl, std::shared_ptr<bool> pDone = nullptr)
+    {
+        olc::net::message<SmallMsgTypes> msg;
+        msg.header.id = id;
+        if(tTtl.count() != 0)
+            msg.expire_after(tTtl);
+        queue.push(msg, olc::net::send_priority::interactive, std::move(pDone));
+    };
+
+    auto pDone = std::make_shared<bool>(false);
+    push(SmallMsgTypes::ServerAccept, std::chrono::milliseconds(-1), pDone);
+    push(SmallMsgTypes::ServerAccept, std::chrono::milliseconds(-1));
+    push(SmallMsgTypes::ServerAccept, std::chrono::milliseconds(0));
+    push(SmallMsgTypes::ServerPing, std::chrono::milliseconds(-1));
+    push(SmallMsgTypes::ServerPing, std::chrono::hours(1));
+
+    ASSERT_EQ(2, queue.claim(4));
+    ASSERT_EQ(SmallMsgTypes::ServerAccept, queue.claimed(0).header.id);
+    ASSERT_EQ(SmallMsgTypes::ServerPing, queue.claimed(1).header.id);
+    ASSERT_EQ(3, queue.expired());
+    ASSERT_EQ(2, queue.expired(SmallMsgTypes::ServerAccept));
+    ASSERT_EQ(1, queue.expired(SmallMsgTypes::ServerPing));
+    ASSERT_TRUE(*pDone);
+
+    //once claimed, a message goes out even if its deadline passes meanwhile
+    queue.pop_front();
+    queue.pop_front();
+    push(SmallMsgTypes::ServerAccept, std::chrono::milliseconds(20));
+    ASSERT_EQ(1, queue.claim(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    ASSERT_EQ(1, queue.claim(1));
+    queue.pop_front();
+    ASSERT_EQ(0, queue.claim(1));
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(3, queue.expired());
+
+    //an ID too large for a per ID table only counts in the total, and can't be
+    //configured for
+    const auto huge = static_cast<SmallMsgTypes>(0xFFFFFFFF);
+    push(huge, std::chrono::milliseconds(-1));
+    ASSERT_EQ(0, queue.claim(1));
+    ASSERT_EQ(4, queue.expired());
+    ASSERT_EQ(0, queue.expired(huge));
+    ASSERT_THROW(olc::net::conflation<SmallMsgTypes>().latest(huge), std::out_of_range);
+    ASSERT_THROW(olc::net::rate_limits<SmallMsgTypes>().per_id(huge, 1), std::out_of_range);
+    ASSERT_THROW(olc::net::message_filter<SmallMsgTypes>().allow(huge), std::out_of_range);
+}
+
+/*
+    @brief Conflation
+    Testing that a keyed message replaces the waiting one with the same ID and key in
+    its place, that other IDs and keys are untouched, and that a claimed message is not
+    replaced
+*/
+TEST(TestSendQueue, ConflationCheck)
+{
+
+    auto pConflation = std::make_shared<olc::net::conflation<SmallMsgTypes>>();
+    pConflation->by_key(SmallMsgTypes::ServerPing, [](const olc::net::message<SmallMsgTypes>& msg)
+    {
+        uint32_t nKey = 0;
+        std::memcpy(&nKey, msg.body.data(), sizeof(nKey));
+        return uint64_t(nKey);
+    });
+
+    olc::net::send_queue<SmallMsgTypes> queue;
+    queue.set_conflation(pConflation);
+    auto push = [&](SmallMsgTypes id, uint32_t nKey, uint32_t nValue, std::shared_ptr<bool> pDone = nullptr)
+    {
+        olc::net::message<SmallMsgTypes> msg;
+        msg.header.id = id;
+        msg << nKey << nValue;
+        queue.push(msg, olc::net::send_priority::interactive, std::move(pDone));
+    };
+    auto pop = [&]()
+    {
+        uint32_t nValue = 0;
+        std::memcpy(&nValue, queue.front().body.data() + sizeof(uint32_t), sizeof(nValue));
+        queue.pop_front();
+        return nValue;
+    };
+
+    auto pDone = std::make_shared<bool>(false);
+    push(SmallMsgTypes::ServerPing, 1, 10, pDone);
+    push(SmallMsgTypes::ServerAccept, 1, 20);
+    push(SmallMsgTypes::ServerPing, 2, 30);
+    push(SmallMsgTypes::ServerPing, 1, 11);
+    push(SmallMsgTypes::ServerAccept, 1, 21);
+    push(SmallMsgTypes::ServerPing, 1, 12);
+    ASSERT_EQ(4, queue.size());
+    ASSERT_EQ(2, queue.conflated());
+    ASSERT_TRUE(*pDone);
+
+    ASSERT_EQ(12, pop());
+    ASSERT_EQ(1, queue.claim(1));
+    push(SmallMsgTypes::ServerAccept, 1, 22);
+    push(SmallMsgTypes::ServerPing, 2, 31);
+    ASSERT_EQ(20, pop());
+    ASSERT_EQ(31, pop());
+    ASSERT_EQ(21, pop());
+    ASSERT_EQ(22, pop());
+    ASSERT_TRUE(queue.empty());
+
+    //a message that has left the queue no longer takes replacements
+    push(SmallMsgTypes::ServerPing, 2, 32);
+    ASSERT_EQ(1, queue.claim(1));
+    push(SmallMsgTypes::ServerPing, 2, 33);
+    ASSERT_EQ(32, pop());
+    ASSERT_EQ(33, pop());
+    ASSERT_EQ(3, queue.conflated());
+
+    //a frame pushed with the message it encodes is keyed by that message
+    auto frame = [&](uint32_t nKey, uint32_t nValue)
+    {
+        olc::net::message<SmallMsgTypes> state, msg;
+        state.header.id = msg.header.id = SmallMsgTypes::ServerPing;
+        state << nKey;
+        msg << nValue << nValue;
+        queue.push(msg, olc::net::send_priority::interactive, nullptr, 0, &state);
+    };
+    frame(3, 40);
+    frame(4, 40);
+    frame(3, 41);
+    ASSERT_EQ(2, queue.size());
+    ASSERT_EQ(41, pop());
+    ASSERT_EQ(40, pop());
+    ASSERT_EQ(4, queue.conflated());
+}
+
+/*
+    @brief Holding the queue
+    Testing that a held queue parks what is pushed, still takes push_ahead(), and
+    queues the parked messages in order once released
+*/
+TEST(TestSendQueue, HoldCheck)
+{
+
+    using olc::net::send_priority;
+    olc::net::send_queue<SmallMsgTypes> queue;
+    auto push = [&](uint32_t nTag, send_priority nPriority, bool bAhead = false)
+    {
+        olc::net::message<SmallMsgTypes> msg;
+        msg << nTag;
+        if(bAhead)
+            queue.push_ahead(msg, nPriority);
+        else
+            queue.push(msg, nPriority);
+    };
+    auto pop = [&]()
+    {
+        uint32_t nTag = 0;
+        std::memcpy(&nTag, queue.front().body.data(), sizeof(nTag));
+        queue.pop_front();
+        return nTag;
+    };
+
+    push(1, send_priority::interactive);
+    queue.hold();
+    push(2, send_priority::control);
+    push(3, send_priority::interactive);
+    push(4, send_priority::bulk, true);
+    ASSERT_EQ(2, queue.size());
+    ASSERT_EQ(2, queue.parked());
+    ASSERT_EQ(1, pop());
+    ASSERT_EQ(4, pop());
+    ASSERT_TRUE(queue.empty());
+
+    queue.release();
+    ASSERT_FALSE(queue.held());
+    ASSERT_EQ(0, queue.parked());
+    ASSERT_EQ(2, pop());
+    ASSERT_EQ(3, pop());
+    ASSERT_TRUE(queue.empty());
+}
+
+/*
+    @brief Topic index
+    Testing that exact and prefix subscriptions find their clients, each client
+    only once, and that unsubscribing and removing a client take it out
+*/
+TEST(TestTopics, IndexCheck)
+{
+
+    olc::net::topic_index<int> topics;
+    ASSERT_TRUE(topics.subscribe(1, "prices/eur"));
+    ASSERT_FALSE(topics.subscribe(1, "prices/eur"));
+    ASSERT_TRUE(topics.subscribe(2, "prices/*"));
+    ASSERT_TRUE(topics.subscribe(2, "prices/eur"));
+    ASSERT_TRUE(topics.subscribe(3, "*"));
+    ASSERT_TRUE(topics.subscribe(4, "news/sport"));
+
+    auto find = [&](const std::string& sTopic)
+    {
+        std::vector<int> vFound;
+        size_t nFound = topics.for_each(sTopic, [&](int nClient){ vFound.push_back(nClient); });
+        EXPECT_EQ(nFound, vFound.size());
+        std::sort(vFound.begin(), vFound.end());
+        return vFound;
+    };
+
+    ASSERT_EQ(std::vector<int>({ 1, 2, 3 }), find("prices/eur"));
+    ASSERT_EQ(std::vector<int>({ 2, 3 }), find("prices/usd"));
+    ASSERT_EQ(std::vector<int>({ 2, 3 }), find("prices/"));
+    ASSERT_EQ(std::vector<int>({ 3 }), find("prices"));
+    ASSERT_EQ(std::vector<int>({ 3, 4 }), find("news/sport"));
+
+    ASSERT_TRUE(topics.unsubscribe(2, "prices/*"));
+    ASSERT_FALSE(topics.unsubscribe(2, "prices/*"));
+    ASSERT_EQ(std::vector<int>({ 3 }), find("prices/usd"));
+    ASSERT_EQ(std::vector<int>({ 1, 2, 3 }), find("prices/eur"));
+
+    topics.remove(3);
+    topics.remove(1);
+    ASSERT_EQ(std::vector<int>({ 2 }), find("prices/eur"));
+    ASSERT_EQ(2, topics.clients());
+
+    //clients churning through long patterns leave no nodes behind
+    const size_t nBaseline = topics.nodes();
+    for(int nRound = 0; nRound < 3; nRound++)
+    {
+        for(int nClient = 10; nClient < 20; nClient++)
+            for(int i = 0; i < 8; i++)
+                ASSERT_TRUE(topics.subscribe(nClient, std::to_string(nClient) + "/" + std::string(200, char('a' + i)) + "*"));
+        ASSERT_GT(topics.nodes(), nBaseline);
+        for(int nClient = 10; nClient < 15; nClient++)
+            for(int i = 0; i < 8; i++)
+                ASSERT_TRUE(topics.unsubscribe(nClient, std::to_string(nClient) + "/" + std::string(200, char('a' + i)) + "*"));
+        for(int nClient = 15; nClient < 20; nClient++)
+            topics.remove(nClient);
+        ASSERT_EQ(nBaseline, topics.nodes());
+    }
+    ASSERT_EQ(2, topics.clients());
+
+    //and can't hold more than their share
+    olc::net::topic_index<int> capped(2, 8);
+    ASSERT_FALSE(capped.subscribe(1, "123456789*"));
+    ASSERT_TRUE(capped.subscribe(1, "a*"));
+    ASSERT_TRUE(capped.subscribe(1, "b"));
+    ASSERT_FALSE(capped.subscribe(1, "c"));
+    ASSERT_TRUE(capped.unsubscribe(1, "b"));
+    ASSERT_TRUE(capped.subscribe(1, "c"));
+}
+
+/*
+    @brief Publish/subscribe
+    Testing that clients subscribe over the wire, with the message filter in place,
+    and that a publish only reaches the clients subscribed to its topic
+*/
+TEST(TestTopics, PublishCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    olc::net::dispatcher<SmallMsgTypes> dispatcher;
+    dispatcher.on<SmallMsgTypes::ServerPing>([](std::shared_ptr<olc::net::connection<SmallMsgTypes>>, olc::net::message<SmallMsgTypes>&){});
+    serverpointer -> SetMessageFilter(dispatcher.filter());
+    serverpointer -> SetBatchedIO(true);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    std::vector<std::unique_ptr<olc::net::client_interface<SmallMsgTypes>>> vClients;
+    for(size_t i = 0; i < 3; i++)
+    {
+        vClients.push_back(std::make_unique<olc::net::client_interface<SmallMsgTypes>>());
+        ASSERT_TRUE(vClients.back() -> Connect("127.0.0.1", 60000));
+    }
+    std::this_thread::sleep_for(300ms);
+    vClients[0] -> Subscribe("prices/eur");
+    vClients[1] -> Subscribe("prices/*");
+    vClients[1] -> Subscribe("prices/eur");
+    std::this_thread::sleep_for(300ms);
+
+    olc::net::message<SmallMsgTypes> msg;
+    msg.header.id = SmallMsgTypes::ServerPing;
+    msg << uint32_t(7);
+    ASSERT_EQ(2, serverpointer -> Publish("prices/eur", msg));
+    ASSERT_EQ(1, serverpointer -> Publish("prices/usd", msg));
+    ASSERT_EQ(0, serverpointer -> Publish("news", msg));
+
+    vClients[1] -> Unsubscribe("prices/*");
+    std::this_thread::sleep_for(300ms);
+    ASSERT_EQ(0, serverpointer -> Publish("prices/usd", msg));
+
+    ASSERT_EQ(1, vClients[0] -> Incoming().count());
+    ASSERT_EQ(2, vClients[1] -> Incoming().count());
+    ASSERT_EQ(0, vClients[2] -> Incoming().count());
+    ASSERT_EQ(0, serverpointer -> m_deqConnections.front() -> GetIOStats().nRejected);
+
+    //a client that has gone loses its subscriptions
+    vClients[0] -> Disconnect();
+    std::this_thread::sleep_for(300ms);
+    ASSERT_EQ(1, serverpointer -> Publish("prices/eur", msg));
+
+    for(auto& client : vClients)
+        client -> Disconnect();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+/*
+    @brief Group index
+    Testing that members are kept once each and in order, and that leaving one
+    group or all of them updates every list involved
+*/
+TEST(TestGroups, IndexCheck)
+{
+
+    olc::net::group_index<int> groups;
+    ASSERT_TRUE(groups.join(1, 30));
+    ASSERT_TRUE(groups.join(1, 10));
+    ASSERT_TRUE(groups.join(1, 20));
+    ASSERT_FALSE(groups.join(1, 10));
+    ASSERT_TRUE(groups.join(2, 10));
+    ASSERT_EQ(std::vector<int>({ 10, 20, 30 }), groups.members(1));
+
+    ASSERT_TRUE(groups.leave(1, 20));
+    ASSERT_FALSE(groups.leave(1, 20));
+    ASSERT_EQ(std::vector<int>({ 10, 30 }), groups.members(1));
+
+    groups.remove(10);
+    ASSERT_EQ(std::vector<int>({ 30 }), groups.members(1));
+    ASSERT_TRUE(groups.members(2).empty());
+    ASSERT_EQ(1, groups.groups());
+}
+
+/*
+    @brief Group messages
+    Testing that a group message reaches every member but the one ignored and no
+    one else, and that a client leaves its groups when it disconnects
+*/
+TEST(TestGroups, MessageGroupCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    std::vector<std::unique_ptr<olc::net::client_interface<SmallMsgTypes>>> vClients;
+    for(size_t i = 0; i < 4; i++)
+    {
+        vClients.push_back(std::make_unique<olc::net::client_interface<SmallMsgTypes>>());
+        ASSERT_TRUE(vClients.back() -> Connect("127.0.0.1", 60000));
+    }
+    std::this_thread::sleep_for(300ms);
+
+    auto& vConnections = serverpointer -> m_deqConnections;
+    ASSERT_EQ(4, vConnections.size());
+    for(size_t i = 0; i < 3; i++)
+        ASSERT_TRUE(serverpointer -> JoinGroup(7, vConnections[i]));
+    ASSERT_FALSE(serverpointer -> JoinGroup(7, vConnections[0]));
+    ASSERT_TRUE(serverpointer -> JoinGroup(8, vConnections[0]));
+
+    olc::net::message<SmallMsgTypes> msg;
+    msg.header.id = SmallMsgTypes::ServerPing;
+    msg << uint32_t(7);
+    serverpointer -> MessageGroup(7, msg, vConnections[0]);
+    std::this_thread::sleep_for(300ms);
+
+    //connections are accepted in the order the clients connected
+    ASSERT_EQ(0, vClients[0] -> Incoming().count());
+    ASSERT_EQ(1, vClients[1] -> Incoming().count());
+    ASSERT_EQ(1, vClients[2] -> Incoming().count());
+    ASSERT_EQ(0, vClients[3] -> Incoming().count());
+
+    vClients[0] -> Disconnect();
+    std::this_thread::sleep_for(300ms);
+    ASSERT_EQ(2, serverpointer -> GetGroupSize(7));
+    ASSERT_EQ(0, serverpointer -> GetGroupSize(8));
+
+    for(auto& client : vClients)
+        client -> Disconnect();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+/*
+    @brief Interest grid
+    Testing radius queries across cell borders, and that visible sets report
+    enters and leaves as clients move and go
+*/
+TEST(TestInterest, GridCheck)
+{
+
+    olc::net::interest_grid<int> grid(10.0f);
+    grid.set_position(1, { 0, 0 });
+    grid.set_position(2, { 9, 9 });
+    grid.set_position(3, { -12, 3 });
+    grid.set_position(4, { 100, 100 });
+
+    auto near = [&](olc::net::grid_position pos, float fRadius)
+    {
+        std::vector<int> vFound;
+        grid.for_each_near(pos, fRadius, [&](int nClient){ vFound.push_back(nClient); });
+        std::sort(vFound.begin(), vFound.end());
+        return vFound;
+    };
+    ASSERT_EQ(std::vector<int>({ 1, 2, 3 }), near({ 0, 0 }, 13));
+    ASSERT_EQ(std::vector<int>({ 1, 3 }), near({ 0, 0 }, 12.5f));
+    ASSERT_EQ(std::vector<int>({ 4 }), near({ 95, 95 }, 10));
+
+    //boxes far bigger than the occupied cells, and positions past the cell range
+    ASSERT_EQ(std::vector<int>({ 1, 2, 3, 4 }), near({ 0, 0 }, 1e6f));
+    ASSERT_EQ(std::vector<int>({ 1, 2, 3, 4 }), near({ 0, 0 }, std::numeric_limits<float>::infinity()));
+    ASSERT_TRUE(near({ 0, 0 }, std::nanf("")).empty());
+    grid.set_position(5, { 1e30f, -1e30f });
+    ASSERT_EQ(std::vector<int>({ 5 }), near({ 1e30f, -1e30f }, 1));
+    ASSERT_TRUE(grid.remove(5));
+
+    using events = std::vector<std::pair<int, int>>;
+    events vEnter, vLeave;
+    auto update = [&]()
+    {
+        vEnter.clear();
+        vLeave.clear();
+        grid.update_visibility(15.0f,
+            [&](int nObserver, int nTarget){ vEnter.push_back({ nObserver, nTarget }); },
+            [&](int nObserver, int nTarget){ vLeave.push_back({ nObserver, nTarget }); });
+        std::sort(vEnter.begin(), vEnter.end());
+        std::sort(vLeave.begin(), vLeave.end());
+    };
+
+    update();
+    ASSERT_EQ(events({ {1, 2}, {1, 3}, {2, 1}, {3, 1} }), vEnter);
+    ASSERT_TRUE(vLeave.empty());
+    ASSERT_EQ(2, grid.visible_count(1));
+
+    //4 walks over to 2 as 3 walks away, then 1 disconnects
+    grid.set_position(4, { 12, 12 });
+    grid.set_position(3, { -40, 3 });
+    update();
+    ASSERT_EQ(events({ {2, 4}, {4, 2} }), vEnter);
+    ASSERT_EQ(events({ {1, 3}, {3, 1} }), vLeave);
+
+    ASSERT_TRUE(grid.remove(1));
+    ASSERT_FALSE(grid.remove(1));
+    update();
+    ASSERT_TRUE(vEnter.empty());
+    ASSERT_EQ(events({ {2, 1} }), vLeave);
+    ASSERT_EQ(3, grid.size());
+}
+
+class InterestServer : public SmallServer
+{
+    public:
+        InterestServer(uint16_t nPort) : SmallServer(nPort){}
+
+        void OnInterestEnter(std::shared_ptr<olc::net::connection<SmallMsgTypes>> observer, std::shared_ptr<olc::net::connection<SmallMsgTypes>> target) override{
+
+            nEnters++;
+        }
+
+        void OnInterestLeave(std::shared_ptr<olc::net::connection<SmallMsgTypes>> observer, std::shared_ptr<olc::net::connection<SmallMsgTypes>> target) override{
+
+            nLeaves++;
+        }
+
+        size_t nEnters = 0;
+        size_t nLeaves = 0;
+};
+
+/*
+    @brief Nearby messages
+    Testing that a message sent near a point only reaches the clients around it,
+    and that a client's observers hear it leave when it disconnects
+*/
+TEST(TestInterest, MessageNearbyCheck)
+{
+
+    InterestServer *serverpointer = new InterestServer(60000);
+    serverpointer -> SetInterestCellSize(50.0f);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    std::vector<std::unique_ptr<olc::net::client_interface<SmallMsgTypes>>> vClients;
+    for(size_t i = 0; i < 3; i++)
+    {
+        vClients.push_back(std::make_unique<olc::net::client_interface<SmallMsgTypes>>());
+        ASSERT_TRUE(vClients.back() -> Connect("127.0.0.1", 60000));
+    }
+    std::this_thread::sleep_for(300ms);
+
+    auto& vConnections = serverpointer -> m_deqConnections;
+    serverpointer -> SetClientPosition(vConnections[0], { 0, 0 });
+    serverpointer -> SetClientPosition(vConnections[1], { 30, 40 });
+    serverpointer -> SetClientPosition(vConnections[2], { 500, 0 });
+    ASSERT_FALSE(serverpointer -> SetClientPosition(vConnections[2], { std::nanf(""), 0 }));
+    serverpointer -> UpdateInterest(60.0f);
+    ASSERT_EQ(2, serverpointer -> nEnters);
+
+    olc::net::message<SmallMsgTypes> msg;
+    msg.header.id = SmallMsgTypes::ServerPing;
+    msg << uint32_t(7);
+    serverpointer -> MessageNearby({ 10, 10 }, 60.0f, msg);
+    serverpointer -> MessageNearby({ 10, 10 }, 60.0f, msg, vConnections[1]);
+    std::this_thread::sleep_for(300ms);
+    ASSERT_EQ(2, vClients[0] -> Incoming().count());
+    ASSERT_EQ(1, vClients[1] -> Incoming().count());
+    ASSERT_EQ(0, vClients[2] -> Incoming().count());
+
+    vClients[0] -> Disconnect();
+    std::this_thread::sleep_for(300ms);
+    serverpointer -> UpdateInterest(60.0f);
+    ASSERT_EQ(1, serverpointer -> nLeaves);
+
+    for(auto& client : vClients)
+        client -> Disconnect();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+/*
+    @brief Snapshot deltas
+    Testing that snapshots go out in full until one is acked, then as deltas
+    that rebuild the same state, and in full again once the baseline is lost
+*/
+TEST(TestSnapshot, CodecCheck)
+{
+
+    olc::net::snapshot_sender<SmallMsgTypes> sender(4);
+    olc::net::snapshot_receiver<SmallMsgTypes> receiver;
+
+    olc::net::message<SmallMsgTypes> state;
+    state.header.id = SmallMsgTypes::ServerPing;
+    state.body.resize(1000);
+    for(size_t i = 0; i < state.body.size(); i++)
+        state.body[i] = uint8_t(i);
+
+    auto roundtrip = [&](uint32_t nExpectSeq)
+    {
+        auto frame = sender.encode(state);
+        ASSERT_EQ(nExpectSeq, receiver.decode(frame));
+        ASSERT_EQ(state.body.size(), frame.body.size());
+        ASSERT_TRUE(std::equal(state.body.begin(), state.body.end(), frame.body.begin()));
+    };
+
+    //nothing acked yet, so both go in full
+    roundtrip(1);
+    roundtrip(2);
+    ASSERT_EQ(2, sender.full());
+
+    //against 2, two changed blocks and the mask
+    sender.ack(2);
+    state.body[10] ^= 1;
+    state.body[999] ^= 1;
+    auto frame = sender.encode(state);
+    ASSERT_EQ(12 + 16 + 8 + 8, frame.body.size());
+    ASSERT_EQ(3, receiver.decode(frame));
+    ASSERT_EQ(state.body[10], frame.body[10]);
+    ASSERT_EQ(1, sender.deltas());
+
+    //3 isn't acked, the next delta is still against 2. The state grows too
+    state.body.resize(1004, 9);
+    roundtrip(4);
+    ASSERT_EQ(2, sender.baseline());
+    ASSERT_EQ(2, sender.deltas());
+
+    //too many left unacked, start over in full
+    roundtrip(5);
+    roundtrip(6);
+    ASSERT_EQ(2, sender.full());
+    roundtrip(7);
+    ASSERT_EQ(3, sender.full());
+    ASSERT_EQ(0, sender.baseline());
+
+    //a delta whose baseline the receiver never had
+    olc::net::snapshot_receiver<SmallMsgTypes> late;
+    sender.ack(7);
+    frame = sender.encode(state);
+    ASSERT_EQ(0, late.decode(frame));
+
+    //frames from a sender that can't be trusted
+    auto forge = [](uint32_t nSeq, uint32_t nBase, uint32_t nSize, std::vector<uint8_t> vData)
+    {
+        olc::net::message<SmallMsgTypes> forged;
+        forged.header.id = SmallMsgTypes::ServerPing;
+        forged.body.resize(12 + vData.size());
+        olc::net::wire::Put(forged.body.data(), nSeq, 4);
+        olc::net::wire::Put(forged.body.data() + 4, nBase, 4);
+        olc::net::wire::Put(forged.body.data() + 8, nSize, 4);
+        std::copy(vData.begin(), vData.end(), forged.body.begin() + 12);
+        return forged;
+    };
+    olc::net::snapshot_receiver<SmallMsgTypes> wary(4);
+    frame = forge(1, 0, 16, std::vector<uint8_t>(16, 1));
+    ASSERT_EQ(1, wary.decode(frame));
+    frame = forge(2, 1, 64, { 0xFF, 1 });                   //8 changed blocks, 1 byte of them
+    ASSERT_EQ(0, wary.decode(frame));
+    frame = forge(2, 1, 0xFFFFFFF0, { 0x01, 1, 2, 3, 4, 5, 6, 7, 8 });
+    ASSERT_EQ(0, wary.decode(frame));
+
+    //deltas that all lean on 1 only keep so many states, then 1 is gone
+    for(uint32_t nSeq = 2; nSeq <= 5; nSeq++)
+    {
+        frame = forge(nSeq, 1, 16, { 0x00 });
+        ASSERT_EQ(nSeq, wary.decode(frame));
+    }
+    frame = forge(6, 1, 16, { 0x00 });
+    ASSERT_EQ(0, wary.decode(frame));
+}
+
+/*
+    @brief Snapshots to a client
+    Testing that a client gets whole states through SnapshotClient(), and that
+    once it has acked one the next go out as deltas
+*/
+TEST(TestSnapshot, SnapshotClientCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::client_interface<SmallMsgTypes> client;
+    ASSERT_TRUE(client.Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(300ms);
+    auto remote = serverpointer -> m_deqConnections.front();
+
+    olc::net::message<SmallMsgTypes> state;
+    state.header.id = SmallMsgTypes::ServerPing;
+    state.body.resize(4096, 1);
+
+    std::vector<uint64_t> vSent;
+    for(size_t i = 0; i < 3; i++)
+    {
+        state.body[i * 100] = uint8_t(i + 2);
+        ASSERT_TRUE(serverpointer -> SnapshotClient(remote, state));
+        std::this_thread::sleep_for(200ms);
+        vSent.push_back(remote -> GetIOStats().nSnapshotBytes);
+
+        ASSERT_EQ(1, client.Incoming().count());
+        auto msg = client.Incoming().pop_front().msg;
+        ASSERT_EQ(state.body.size(), msg.body.size());
+        ASSERT_TRUE(std::equal(state.body.begin(), state.body.end(), msg.body.begin()));
+    }
+
+    ASSERT_EQ(12 + 4096, vSent[0]);
+    ASSERT_LT(vSent[1] - vSent[0], 100);
+    ASSERT_LT(vSent[2] - vSent[1], 100);
+    ASSERT_EQ(1, remote -> GetIOStats().nSnapshotsFull);
+    ASSERT_EQ(2, remote -> GetIOStats().nSnapshotsDelta);
+
+    //the other way round is refused, and skipped like a filtered frame
+    client.m_connection -> SendSnapshot(state);
+    std::this_thread::sleep_for(200ms);
+    ASSERT_EQ(1, remote -> GetIOStats().nRejected);
+    ASSERT_EQ(0, remote -> GetIOStats().nMessagesIn);
+    ASSERT_TRUE(remote -> IsConnected());
+
+    client.Disconnect();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+/*
+    @brief Snapshots from several threads
+    Testing that snapshots sent to one client from two threads at once all arrive
+    whole, and that a snapshot keeps the deadline of its state
+*/
+TEST(TestSnapshot, ConcurrentSnapshotCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::client_interface<SmallMsgTypes> client;
+    ASSERT_TRUE(client.Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(300ms);
+    auto remote = serverpointer -> m_deqConnections.front();
+
+    //each state is filled with one byte, so any state rebuilt wrong shows
+    const size_t nPerThread = 200;
+    auto sender = [&](uint8_t nFirst)
+    {
+        olc::net::message<SmallMsgTypes> state;
+        state.header.id = SmallMsgTypes::ServerPing;
+        for(size_t i = 0; i < nPerThread; i++)
+        {
+            state.body.resize(1024);
+            std::fill(state.body.begin(), state.body.end(), uint8_t(nFirst + i % 100));
+            serverpointer -> SnapshotClient(remote, state);
+        }
+    };
+    std::thread a(sender, 0), b(sender, 100);
+    a.join();
+    b.join();
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_EQ(2 * nPerThread, client.Incoming().count());
+    while(!client.Incoming().empty())
+    {
+        auto msg = client.Incoming().pop_front().msg;
+        ASSERT_EQ(1024, msg.body.size());
+        ASSERT_TRUE(std::all_of(msg.body.begin(), msg.body.end(), [&](uint8_t n){ return n == msg.body[0]; }));
+    }
+    ASSERT_EQ(2 * nPerThread, remote -> GetIOStats().nSnapshotsFull + remote -> GetIOStats().nSnapshotsDelta);
+
+    olc::net::message<SmallMsgTypes> stale;
+    stale.header.id = SmallMsgTypes::ServerPing;
+    stale.body.resize(1024, 7);
+    stale.expire_after(-1s);
+    ASSERT_TRUE(serverpointer -> SnapshotClient(remote, stale));
+    std::this_thread::sleep_for(200ms);
+    ASSERT_EQ(1, remote -> GetIOStats().nExpired);
+    ASSERT_TRUE(client.Incoming().empty());
+
+    client.Disconnect();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+/*
+    @brief Late join bootstrap
+    Testing that a client gets a bootstrapped state whole, and that messages sent
+    while it streams, even in a higher lane, only follow it
+*/
+TEST(TestBootstrap, BootstrapClientCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::client_interface<SmallMsgTypes> client;
+    ASSERT_TRUE(client.Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(300ms);
+    auto remote = serverpointer -> m_deqConnections.front();
+
+    auto pState = std::make_shared<olc::net::message<SmallMsgTypes>>();
+    pState -> header.id = SmallMsgTypes::ServerAccept;
+    pState -> body.resize(1000000);
+    for(size_t i = 0; i < pState -> body.size(); i++)
+        pState -> body[i] = uint8_t(i * 7);
+    pState -> header.size = pState -> size();
+
+    serverpointer -> BootstrapClient(remote, pState, 16 * 1024);
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        olc::net::message<SmallMsgTypes> update;
+        update.header.id = SmallMsgTypes::ServerPing;
+        update << i;
+        serverpointer -> MessageClient(remote, update, olc::net::send_priority::control);
+    }
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_EQ(4, client.Incoming().count());
+    auto state = client.Incoming().pop_front().msg;
+    ASSERT_EQ(SmallMsgTypes::ServerAccept, state.header.id);
+    ASSERT_EQ(pState -> body.size(), state.body.size());
+    ASSERT_TRUE(std::equal(state.body.begin(), state.body.end(), pState -> body.begin()));
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        auto update = client.Incoming().pop_front().msg;
+        uint32_t nValue = 0;
+        update >> nValue;
+        ASSERT_EQ(i, nValue);
+    }
+    //62 chunks of up to 16KB, then the updates
+    ASSERT_EQ(62 + 3, remote -> GetIOStats().nMessagesOut);
+
+    client.Disconnect();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+/*
+    @brief Bootstrap to a view client
+    Testing a client on view dispatch gets a bootstrapped state whole in
+    OnMessageView(), followed by the updates sent meanwhile
+*/
+class ViewClient : public olc::net::client_interface<SmallMsgTypes>
+{
+    public:
+        std::mutex mux;
+        std::vector<std::pair<SmallMsgTypes, std::vector<uint8_t>>> vViews;
+
+    protected:
+        void OnMessageView(olc::net::message_view<SmallMsgTypes>& view) override{
+
+            std::scoped_lock lock(mux);
+            vViews.push_back({ view.header.id, std::vector<uint8_t>(view.data(), view.data() + view.size()) });
+        }
+};
+
+TEST(TestBootstrap, ViewDispatchCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    ViewClient client;
+    client.SetViewDispatch(true);
+    ASSERT_TRUE(client.Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(300ms);
+    auto remote = serverpointer -> m_deqConnections.front();
+
+    auto pState = std::make_shared<olc::net::message<SmallMsgTypes>>();
+    pState -> header.id = SmallMsgTypes::ServerAccept;
+    pState -> body.resize(100000);
+    for(size_t i = 0; i < pState -> body.size(); i++)
+        pState -> body[i] = uint8_t(i * 5);
+    pState -> header.size = pState -> size();
+
+    serverpointer -> BootstrapClient(remote, pState, 16 * 1024);
+    olc::net::message<SmallMsgTypes> update;
+    update.header.id = SmallMsgTypes::ServerPing;
+    update << uint32_t(9);
+    serverpointer -> MessageClient(remote, update);
+    std::this_thread::sleep_for(500ms);
+
+    std::scoped_lock lock(client.mux);
+    ASSERT_EQ(2, client.vViews.size());
+    ASSERT_EQ(SmallMsgTypes::ServerAccept, client.vViews[0].first);
+    ASSERT_EQ(pState -> body.size(), client.vViews[0].second.size());
+    ASSERT_TRUE(std::equal(client.vViews[0].second.begin(), client.vViews[0].second.end(), pState -> body.begin()));
+    ASSERT_EQ(SmallMsgTypes::ServerPing, client.vViews[1].first);
+    ASSERT_EQ(0, client.Incoming().count());
+
+    client.Disconnect();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+/*
+    @brief Bootstrap behind a busy queue
+    Testing that messages already queued when a bootstrap starts go out ahead of
+    it whole, rather than between its chunks
+*/
+TEST(TestBootstrap, QueuedAheadCheck)
+{
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    olc::net::client_interface<SmallMsgTypes> client;
+    ASSERT_TRUE(client.Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(300ms);
+    auto remote = serverpointer -> m_deqConnections.front();
+
+    auto pState = std::make_shared<olc::net::message<SmallMsgTypes>>();
+    pState -> header.id = SmallMsgTypes::ServerAccept;
+    pState -> body.resize(500000);
+    for(size_t i = 0; i < pState -> body.size(); i++)
+        pState -> body[i] = uint8_t(i * 3);
+    pState -> header.size = pState -> size();
+
+    //big enough that the writer is still busy with them when the bootstrap starts
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        olc::net::message<SmallMsgTypes> update;
+        update.header.id = SmallMsgTypes::ServerPing;
+        update.body.resize(32 * 1024, uint8_t(i));
+        update << i;
+        serverpointer -> MessageClient(remote, update);
+    }
+    serverpointer -> BootstrapClient(remote, pState, 16 * 1024);
+    std::this_thread::sleep_for(500ms);
+
+    ASSERT_EQ(17, client.Incoming().count());
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        auto update = client.Incoming().pop_front().msg;
+        ASSERT_EQ(SmallMsgTypes::ServerPing, update.header.id);
+        ASSERT_EQ(32 * 1024 + 4, update.body.size());
+        uint32_t nValue = 0;
+        update >> nValue;
+        ASSERT_EQ(i, nValue);
+    }
+    auto state = client.Incoming().pop_front().msg;
+    ASSERT_EQ(SmallMsgTypes::ServerAccept, state.header.id);
+    ASSERT_EQ(pState -> body.size(), state.body.size());
+    ASSERT_TRUE(std::equal(state.body.begin(), state.body.end(), pState -> body.begin()));
+
+    client.Disconnect();
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+
+#if defined(OLC_NET_TLS)
+/*
+    @brief TLS transport
+    Testing messages cross a TLS link, that a second connection resumes the session
+    of the first, and that a server with the wrong name is refused
+*/
+TEST(TestTls, EncryptedRoundTripCheck)
+{
+
+    const std::string sCerts = NET_CERTS_DIR;
+    auto pClientTls = olc::net::tls_context::CreateClient(sCerts + "/ca.pem", "localhost");
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    serverpointer -> SetInlineDispatch(true);
+    serverpointer -> SetTls(olc::net::tls_context::CreateServer(sCerts + "/server.pem", sCerts + "/server.key"));
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    for(bool bBatched : { false, true })
+    {
+        olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+        client -> SetTls(pClientTls);
+        client -> SetBatchedIO(bBatched);
+
+        ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+        std::this_thread::sleep_for(500ms);
+        ASSERT_TRUE(client -> IsConnected());
+        ASSERT_TRUE(client -> m_connection -> IsSecure());
+        //the first connection does a full handshake, the second resumes it
+        ASSERT_EQ(bBatched, client -> m_connection -> IsTlsResumed());
+
+        olc::net::message<SmallMsgTypes> msgSmall;
+        msgSmall.header.id = SmallMsgTypes::ServerPing;
+        msgSmall << uint32_t(0x7175);
+        client -> Send(msgSmall);
+
+        olc::net::message<SmallMsgTypes> msgLarge;
+        msgLarge.header.id = SmallMsgTypes::ServerPing;
+        msgLarge.body.resize(70000, 3);
+        msgLarge.header.size = msgLarge.size();
+        client -> Send(msgLarge);
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_EQ(2, client -> Incoming().count());
+        auto reply = client -> Incoming().pop_front().msg;
+        uint32_t nValue = 0;
+        reply >> nValue;
+        ASSERT_EQ(0x7175, nValue);
+        ASSERT_EQ(70000, client -> Incoming().pop_front().msg.size());
+
+        client -> Disconnect();
+        delete client;
+    }
+
+    olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+    client -> SetTls(olc::net::tls_context::CreateClient(sCerts + "/ca.pem", "example.com"));
+    ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+    std::this_thread::sleep_for(500ms);
+    ASSERT_FALSE(client -> IsConnected());
+
+    client -> Disconnect();
+    serverpointer -> Stop();
+
+    delete client;
+    delete serverpointer;
+}
+
+/*
+    @brief Kernel TLS offload
+    Testing a TLS link with kTLS requested on both ends: records are encrypted by the
+    kernel where it supports kTLS, and by OpenSSL as before where it doesn't
+*/
+TEST(TestTls, KernelOffloadCheck)
+{
+
+    const std::string sCerts = NET_CERTS_DIR;
+    auto pClientTls = olc::net::tls_context::CreateClient(sCerts + "/ca.pem", "localhost");
+    pClientTls -> SetKernelOffload(true);
+    auto pServerTls = olc::net::tls_context::CreateServer(sCerts + "/server.pem", sCerts + "/server.key");
+    pServerTls -> SetKernelOffload(true);
+
+    SmallServer *serverpointer = new SmallServer(60000);
+    serverpointer -> SetInlineDispatch(true);
+    serverpointer -> SetTls(pServerTls);
+    ASSERT_TRUE(serverpointer -> Start());
+    std::this_thread::sleep_for(500ms);
+
+    for(bool bBatched : { false, true })
+    {
+        olc::net::client_interface<SmallMsgTypes> *client = new olc::net::client_interface<SmallMsgTypes>;
+        client -> SetTls(pClientTls);
+        client -> SetBatchedIO(bBatched);
+
+        ASSERT_TRUE(client -> Connect("127.0.0.1", 60000));
+        std::this_thread::sleep_for(500ms);
+        ASSERT_TRUE(client -> IsConnected());
+        ASSERT_TRUE(client -> m_connection -> IsSecure());
+        ASSERT_EQ(olc::net::KernelTlsAvailable(), client -> m_connection -> IsKernelTls());
+        ASSERT_EQ(bBatched, client -> m_connection -> IsTlsResumed());
+
+        olc::net::message<SmallMsgTypes> msgLarge;
+        msgLarge.header.id = SmallMsgTypes::ServerPing;
+        msgLarge.body.resize(70000, 5);
+        msgLarge.header.size = msgLarge.size();
+        client -> Send(msgLarge);
+        client -> Send(msgLarge);
+        std::this_thread::sleep_for(500ms);
+
+        ASSERT_EQ(2, client -> Incoming().count());
+        auto reply = client -> Incoming().pop_front().msg;
+        ASSERT_EQ(70000, reply.size());
+        ASSERT_EQ(5, reply.body[69999]);
+
+        client -> Disconnect();
+        delete client;
+    }
+
+    serverpointer -> Stop();
+    delete serverpointer;
+}
+#endif
+
+int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
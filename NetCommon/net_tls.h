@@ -0,0 +1,178 @@
+#pragma once
+#include "net_common.h"
+
+// TLS needs OpenSSL at link time, so it is only compiled in when OLC_NET_TLS is
+// defined (the CMake targets do this and link libssl/libcrypto)
+#if defined(OLC_NET_TLS)
+#include <boost/asio/ssl.hpp>
+
+#if defined(__linux__) && !defined(OPENSSL_NO_KTLS)
+#include <cerrno>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define OLC_NET_KTLS
+#endif
+
+namespace olc
+{
+    namespace net
+    {
+        // True if the kernel can take over TLS record encryption (kTLS): the "tls"
+        // TCP upper layer protocol exists, or its module loads on demand. Checked once
+        // per process. The protocol is looked up before the socket's state is, so an
+        // unconnected socket answers ENOENT only when kTLS is missing
+        inline bool KernelTlsAvailable()
+        {
+#if defined(OLC_NET_KTLS)
+            static const bool bAvailable = []()
+            {
+                int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+                if(fd < 0)
+                    return false;
+                int nResult = ::setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"));
+                int nError = errno;
+                ::close(fd);
+                return nResult == 0 || nError != ENOENT;
+            }();
+            return bAvailable;
+#else
+            return false;
+#endif
+        }
+
+        // TLS settings shared by every connection of a server or a client. Certificates
+        // and keys come from local PEM files, so no network access is needed to set up.
+        // Clients keep the last session ticket the server handed out, and the next
+        // connection offers it, which turns the handshake into an abbreviated one.
+        class tls_context
+        {
+            public:
+                //Server side: present the certificate chain in sCertFile, signed with the
+                //key in sKeyFile. Throws boost::system::system_error if either won't load
+                static std::shared_ptr<tls_context> CreateServer(const std::string& sCertFile, const std::string& sKeyFile)
+                {
+                    auto pContext = std::shared_ptr<tls_context>(new tls_context(true));
+                    pContext->m_context.use_certificate_chain_file(sCertFile);
+                    pContext->m_context.use_private_key_file(sKeyFile, boost::asio::ssl::context::pem);
+                    return pContext;
+                }
+
+                //Client side: only trust servers whose certificate chains up to sCaFile
+                //and, unless sHostName is empty, was issued for sHostName. Throws
+                //boost::system::system_error if the file won't load
+                static std::shared_ptr<tls_context> CreateClient(const std::string& sCaFile, const std::string& sHostName = "")
+                {
+                    auto pContext = std::shared_ptr<tls_context>(new tls_context(false));
+                    pContext->m_context.load_verify_file(sCaFile);
+                    pContext->m_context.set_verify_mode(boost::asio::ssl::verify_peer);
+                    pContext->m_sHostName = sHostName;
+
+                    //sessions are stored by us, not in OpenSSL's cache
+                    SSL_CTX* pCtx = pContext->m_context.native_handle();
+                    SSL_CTX_set_ex_data(pCtx, ContextIndex(), pContext.get());
+                    SSL_CTX_set_session_cache_mode(pCtx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+                    SSL_CTX_sess_set_new_cb(pCtx, &tls_context::OnNewSession);
+                    return pContext;
+                }
+
+                tls_context(const tls_context&) = delete;
+                tls_context& operator=(const tls_context&) = delete;
+
+                ~tls_context()
+                {
+                    if(m_pSession)
+                        SSL_SESSION_free(m_pSession);
+                }
+
+                boost::asio::ssl::context& native()
+                {
+                    return m_context;
+                }
+
+                bool IsServer() const
+                {
+                    return m_bServer;
+                }
+
+                //Hand record encryption to the kernel once the handshake is done (kTLS),
+                //so connections write and read the socket as if it were plain TCP. Only
+                //applies to TCP connections and only where the kernel supports it, the
+                //rest stay on OpenSSL. Set before connecting/starting
+                void SetKernelOffload(bool bEnable)
+                {
+                    m_bKernelOffload = bEnable;
+                }
+
+                bool KernelOffload() const
+                {
+                    return m_bKernelOffload && KernelTlsAvailable();
+                }
+
+                //Client only - get a connection ready for its handshake: name the server
+                //for SNI and the certificate check, and offer the stored session if any
+                void Prepare(SSL* pSsl)
+                {
+                    if(!m_sHostName.empty())
+                    {
+                        SSL_set_tlsext_host_name(pSsl, m_sHostName.c_str());
+                        SSL_set1_host(pSsl, m_sHostName.c_str());
+                    }
+
+                    std::scoped_lock lock(m_mux);
+                    if(m_pSession)
+                        SSL_set_session(pSsl, m_pSession);
+                }
+
+                //Client only - drop the stored session, the next handshake is a full one
+                void ForgetSession()
+                {
+                    std::scoped_lock lock(m_mux);
+                    if(m_pSession)
+                        SSL_SESSION_free(m_pSession);
+                    m_pSession = nullptr;
+                }
+
+            private:
+                tls_context(bool bServer)
+                : m_context(bServer ? boost::asio::ssl::context::tls_server : boost::asio::ssl::context::tls_client), m_bServer(bServer)
+                {
+                    m_context.set_options(boost::asio::ssl::context::default_workarounds
+                        | boost::asio::ssl::context::no_sslv2 | boost::asio::ssl::context::no_sslv3
+                        | boost::asio::ssl::context::no_tlsv1 | boost::asio::ssl::context::no_tlsv1_1);
+                }
+
+                //Where the SSL_CTX keeps a pointer back to us. Not the app data slot, asio
+                //owns that one
+                static int ContextIndex()
+                {
+                    static const int nIndex = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+                    return nIndex;
+                }
+
+                //OpenSSL hands over every session (TLS 1.3 ticket) the server issues, keep
+                //a copy of the latest. Not the session itself: it stays attached to its
+                //connection, and OpenSSL marks it unusable if that connection is dropped
+                //without a TLS shutdown
+                static int OnNewSession(SSL* pSsl, SSL_SESSION* pSession)
+                {
+                    auto pContext = static_cast<tls_context*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(pSsl), ContextIndex()));
+                    SSL_SESSION* pCopy = SSL_SESSION_dup(pSession);
+                    std::scoped_lock lock(pContext->m_mux);
+                    if(pContext->m_pSession)
+                        SSL_SESSION_free(pContext->m_pSession);
+                    pContext->m_pSession = pCopy;
+                    return 0;
+                }
+
+            private:
+                boost::asio::ssl::context m_context;
+                bool m_bServer;
+                bool m_bKernelOffload = false;
+                std::string m_sHostName;
+                std::mutex m_mux;
+                SSL_SESSION* m_pSession = nullptr;
+        };
+    }
+}
+#endif
@@ -0,0 +1,252 @@
+#pragma once
+#include "net_common.h"
+
+#include <unordered_map>
+
+namespace olc
+{
+    namespace net
+    {
+        // Which clients want which topics. A topic is any string, and a subscription is
+        // either a topic or, ending in '*', every topic that starts with what comes
+        // before it ("prices/*", or "*" for all). Exact topics are hashed, prefixes go
+        // into a trie, so finding a topic's subscribers costs its length plus the number
+        // found, whatever the number of topics and clients. Client is any hashable
+        // handle, e.g. std::shared_ptr<connection<T>>. Not thread safe
+        //
+        // Patterns usually come from clients, so each client may hold at most
+        // nMaxPatterns of them, none longer than nMaxLength, and trie nodes no pattern
+        // needs any more are freed
+        template <typename Client>
+        class topic_index
+        {
+            public:
+                explicit topic_index(size_t nMaxPatterns = 64, size_t nMaxLength = 256)
+                : m_nMaxPatterns(nMaxPatterns), m_nMaxLength(nMaxLength)
+                {
+                    m_vNodes.emplace_back();
+                }
+
+                // False if the client already had this subscription, or is at its limits
+                bool subscribe(const Client& client, const std::string& sPattern)
+                {
+                    if(sPattern.size() > m_nMaxLength)
+                        return false;
+
+                    auto it = m_mapClients.try_emplace(client).first;
+                    subscriber& sub = it->second;
+                    if(sub.vPatterns.size() >= m_nMaxPatterns || std::find(sub.vPatterns.begin(), sub.vPatterns.end(), sPattern) != sub.vPatterns.end())
+                    {
+                        if(sub.vPatterns.empty())
+                            m_mapClients.erase(it);
+                        return false;
+                    }
+
+                    sub.vPatterns.push_back(sPattern);
+                    sub.pClient = &it->first;
+                    if(IsPrefix(sPattern))
+                        m_vNodes[Node(sPattern, true)].vSubscribers.push_back(&sub);
+                    else
+                        m_mapTopics[sPattern].push_back(&sub);
+                    return true;
+                }
+
+                // False if the client had no such subscription
+                bool unsubscribe(const Client& client, const std::string& sPattern)
+                {
+                    auto it = m_mapClients.find(client);
+                    if(it == m_mapClients.end())
+                        return false;
+
+                    auto& vPatterns = it->second.vPatterns;
+                    auto itPattern = std::find(vPatterns.begin(), vPatterns.end(), sPattern);
+                    if(itPattern == vPatterns.end())
+                        return false;
+
+                    Detach(&it->second, sPattern);
+                    vPatterns.erase(itPattern);
+                    if(vPatterns.empty())
+                        m_mapClients.erase(it);
+                    return true;
+                }
+
+                // Drop all of a client's subscriptions, e.g. once it has gone
+                void remove(const Client& client)
+                {
+                    auto it = m_mapClients.find(client);
+                    if(it == m_mapClients.end())
+                        return;
+
+                    for(auto& sPattern : it->second.vPatterns)
+                        Detach(&it->second, sPattern);
+                    m_mapClients.erase(it);
+                }
+
+                // Call fn(client) once for every client subscribed to sTopic, however
+                // many of its subscriptions match. fn must not change the index. Returns
+                // how many there were
+                template <typename Fn>
+                size_t for_each(const std::string& sTopic, Fn&& fn)
+                {
+                    const uint64_t nMark = ++m_nMark;
+                    size_t nFound = 0;
+                    auto visit = [&](const std::vector<subscriber*>& vSubscribers)
+                    {
+                        for(subscriber* pSub : vSubscribers)
+                        {
+                            if(pSub->nMark == nMark)
+                                continue;
+                            pSub->nMark = nMark;
+                            nFound++;
+                            fn(*pSub->pClient);
+                        }
+                    };
+
+                    auto it = m_mapTopics.find(sTopic);
+                    if(it != m_mapTopics.end())
+                        visit(it->second);
+
+                    //every node on the topic's path is a prefix of it
+                    size_t nNode = 0;
+                    for(size_t i = 0; ; i++)
+                    {
+                        visit(m_vNodes[nNode].vSubscribers);
+                        if(i == sTopic.size() || (nNode = Child(nNode, sTopic[i])) == 0)
+                            break;
+                    }
+                    return nFound;
+                }
+
+                // Clients with at least one subscription
+                size_t clients() const
+                {
+                    return m_mapClients.size();
+                }
+
+                // Trie nodes in use, the root included
+                size_t nodes() const
+                {
+                    return m_vNodes.size() - m_vFree.size();
+                }
+
+            private:
+                struct subscriber
+                {
+                    const Client* pClient = nullptr;    //the key it is stored under
+                    std::vector<std::string> vPatterns;
+                    uint64_t nMark = 0;                 //last for_each() that reached it
+                };
+
+                // One character of a prefix. Children are few per node, so a short
+                // vector scanned in order beats a map
+                struct node
+                {
+                    std::vector<std::pair<char, uint32_t>> vChildren;
+                    std::vector<subscriber*> vSubscribers;
+                    uint32_t nParent = 0;
+                    char c = 0;                         //its character in the parent
+                };
+
+                static bool IsPrefix(const std::string& sPattern)
+                {
+                    return !sPattern.empty() && sPattern.back() == '*';
+                }
+
+                // 0, the root, if there is none
+                uint32_t Child(size_t nNode, char c) const
+                {
+                    for(auto& child : m_vNodes[nNode].vChildren)
+                        if(child.first == c)
+                            return child.second;
+                    return 0;
+                }
+
+                // The node for a prefix pattern, created on the way if bCreate is set.
+                // 0 if it doesn't exist
+                size_t Node(const std::string& sPattern, bool bCreate)
+                {
+                    size_t nNode = 0;
+                    for(size_t i = 0; i + 1 < sPattern.size(); i++)
+                    {
+                        uint32_t nChild = Child(nNode, sPattern[i]);
+                        if(nChild == 0)
+                        {
+                            if(!bCreate)
+                                return 0;
+                            if(m_vFree.empty())
+                            {
+                                nChild = uint32_t(m_vNodes.size());
+                                m_vNodes.emplace_back();
+                            }
+                            else
+                            {
+                                nChild = m_vFree.back();
+                                m_vFree.pop_back();
+                            }
+                            m_vNodes[nChild].nParent = uint32_t(nNode);
+                            m_vNodes[nChild].c = sPattern[i];
+                            m_vNodes[nNode].vChildren.push_back({ sPattern[i], nChild });
+                        }
+                        nNode = nChild;
+                    }
+                    return nNode;
+                }
+
+                // Free a node nobody subscribes to and nothing hangs off, and so on up
+                // towards the root, which always stays
+                void Prune(size_t nNode)
+                {
+                    while(nNode != 0 && m_vNodes[nNode].vSubscribers.empty() && m_vNodes[nNode].vChildren.empty())
+                    {
+                        node& n = m_vNodes[nNode];
+                        size_t nParent = n.nParent;
+                        auto& vSiblings = m_vNodes[nParent].vChildren;
+                        auto it = std::find(vSiblings.begin(), vSiblings.end(), std::pair<char, uint32_t>(n.c, uint32_t(nNode)));
+                        *it = vSiblings.back();
+                        vSiblings.pop_back();
+
+                        n = node();
+                        m_vFree.push_back(uint32_t(nNode));
+                        nNode = nParent;
+                    }
+                }
+
+                // Take a subscriber off a pattern's list, order doesn't matter
+                void Detach(subscriber* pSub, const std::string& sPattern)
+                {
+                    auto erase = [pSub](std::vector<subscriber*>& vSubscribers)
+                    {
+                        auto it = std::find(vSubscribers.begin(), vSubscribers.end(), pSub);
+                        if(it == vSubscribers.end())
+                            return;
+                        *it = vSubscribers.back();
+                        vSubscribers.pop_back();
+                    };
+
+                    if(IsPrefix(sPattern))
+                    {
+                        size_t nNode = Node(sPattern, false);
+                        erase(m_vNodes[nNode].vSubscribers);
+                        Prune(nNode);
+                        return;
+                    }
+
+                    auto it = m_mapTopics.find(sPattern);
+                    if(it == m_mapTopics.end())
+                        return;
+                    erase(it->second);
+                    if(it->second.empty())
+                        m_mapTopics.erase(it);
+                }
+
+                //node based, so subscribers stay where they are while others come and go
+                std::unordered_map<Client, subscriber> m_mapClients;
+                std::unordered_map<std::string, std::vector<subscriber*>> m_mapTopics;
+                std::vector<node> m_vNodes;
+                std::vector<uint32_t> m_vFree;          //nodes to reuse
+                uint64_t m_nMark = 0;
+                size_t m_nMaxPatterns;
+                size_t m_nMaxLength;
+        };
+    }
+}
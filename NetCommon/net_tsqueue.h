@@ -34,8 +34,12 @@ namespace olc
                 //Adds an item to back of Queue
                 void push_back(const T& item)
                 {
-                    std::scoped_lock lock(muxQueue);
-                    deqQueue.emplace_back(std::move(item));
+                    {
+                        std::scoped_lock lock(muxQueue);
+                        deqQueue.emplace_back(std::move(item));
+                    }
+                    //Notify outside of muxQueue, wait() holds muxBlocking while it checks
+                    //the queue so the wake up cannot slip in between check and sleep
                     std::unique_lock<std::mutex> ul(muxBlocking);
 				    cvBlocking.notify_one();
                 }
@@ -43,8 +47,12 @@ namespace olc
                 //Adds an item to front of Queue
                 void push_front(const T& item)
                 {
-                    std::scoped_lock lock(muxQueue);
-                    deqQueue.emplace_front(std::move(item));
+                    {
+                        std::scoped_lock lock(muxQueue);
+                        deqQueue.emplace_front(std::move(item));
+                    }
+                    //Notify outside of muxQueue, wait() holds muxBlocking while it checks
+                    //the queue so the wake up cannot slip in between check and sleep
                     std::unique_lock<std::mutex> ul(muxBlocking);
 				    cvBlocking.notify_one();
                 }
@@ -89,10 +97,12 @@ namespace olc
                 }
                 void wait()
                 {
+                    std::unique_lock<std::mutex> ul(muxBlocking);
                     while(empty())
                     {
-                        std::unique_lock<std::mutex> ul(muxBlocking);
-                        cvBlocking.wait(ul);
+                        //Bounded sleep, so a waiter re-checks the queue even if it
+                        //was never notified
+                        cvBlocking.wait_for(ul, std::chrono::milliseconds(100));
                     }
                 }
         };
@@ -0,0 +1,182 @@
+#pragma once
+#include "net_common.h"
+#include "net_message.h"
+
+#include <cstddef>
+
+namespace olc
+{
+    namespace net
+    {
+        // How a message_header<T> travels. The in-memory header depends on sizeof(T),
+        // padding and the host's byte order, the wire header does not: every field has
+        // a fixed width and multi-byte values are little endian, so builds with a
+        // different ID type width or on different hosts still understand each other.
+        //
+        //  full    [version][flags][id: 4 bytes][size: 4 bytes]             10 bytes
+        //  compact [version][flags][id: 1-4 bytes][size: 0,1,2 or 4 bytes]  3-10 bytes
+        //
+        // The compact form is only used when both sides agree on it in the handshake.
+        // Its id and size are stored in as few bytes as they need, the widths are kept
+        // in the top bits of the flags byte, so the first two bytes of a frame always
+        // tell how long its header is.
+        namespace wire
+        {
+            // Bumped whenever the layout changes, frames of another version are refused
+            constexpr uint8_t nVersion = 1;
+
+            // Low bits of the flags byte mark frame features, the rest is left for the
+            // compact form's field widths
+            enum flags : uint8_t
+            {
+                compressed = 1 << 0,    //reserved - body is compressed
+                fragment = 1 << 1,      //body is a piece of a larger message, see nFragmentHeader
+                control = 1 << 2,       //addressed to the library rather than the application,
+                                        //the id is a connection<T>::control code
+                snapshot = 1 << 3,      //body is a snapshot or a delta of one, see net_snapshot.h
+                feature_mask = 0x0F,
+                //the features this build implements, frames with any other are refused
+                //rather than handed to the application as ordinary messages
+                understood = fragment | control | snapshot,
+            };
+
+            // A fragment's body starts with the stream it belongs to and the size of the
+            // whole message, then its piece
+            //
+            //  [stream tag: 4 bytes][message size: 4 bytes][piece]
+            //
+            // The message is whole once that many bytes have come. Any other frame,
+            // but a control frame, ends the stream and the pieces so far are dropped
+            constexpr size_t nFragmentHeader = 8;
+
+            struct header
+            {
+                uint8_t version;
+                uint8_t flags;
+                uint8_t id[4];
+                uint8_t size[4];
+            };
+
+            static_assert(sizeof(header) == 10, "Wire header must not be padded");
+            static_assert(offsetof(header, flags) == 1, "Wire header layout changed");
+            static_assert(offsetof(header, id) == 2, "Wire header layout changed");
+            static_assert(offsetof(header, size) == 6, "Wire header layout changed");
+
+            // With the frame_checksum feature every frame ends in the CRC32C of its
+            // header and body bytes, little endian
+            constexpr size_t nTrailer = 4;
+
+            // Bytes needed before the header length is known, and the longest header
+            constexpr size_t nPrefix = 2;
+            constexpr size_t nMaxHeader = sizeof(header);
+
+            inline void Put(uint8_t* p, uint64_t nValue, size_t nBytes)
+            {
+                for(size_t i = 0; i < nBytes; i++)
+                    p[i] = uint8_t(nValue >> (8 * i));
+            }
+
+            inline uint64_t Get(const uint8_t* p, size_t nBytes)
+            {
+                uint64_t nValue = 0;
+                for(size_t i = 0; i < nBytes; i++)
+                    nValue |= uint64_t(p[i]) << (8 * i);
+                return nValue;
+            }
+
+            // Compact field widths, packed into flags bits 4-5 (id) and 6-7 (size)
+            inline size_t IdWidth(uint32_t nId)
+            {
+                return nId < (1u << 8) ? 1 : nId < (1u << 16) ? 2 : nId < (1u << 24) ? 3 : 4;
+            }
+
+            inline uint8_t SizeCode(uint32_t nSize)
+            {
+                return nSize == 0 ? 0 : nSize < (1u << 8) ? 1 : nSize < (1u << 16) ? 2 : 3;
+            }
+
+            inline size_t SizeWidth(uint8_t nCode)
+            {
+                static constexpr size_t aWidths[4] = { 0, 1, 2, 4 };
+                return aWidths[nCode & 3];
+            }
+
+            // Length of the header whose first nPrefix bytes are at p
+            inline size_t Length(const uint8_t* p, bool bCompact)
+            {
+                if(!bCompact)
+                    return sizeof(header);
+                return nPrefix + ((p[1] >> 4) & 3) + 1 + SizeWidth(p[1] >> 6);
+            }
+
+            template <typename T>
+            uint32_t IdValue(T id)
+            {
+                static_assert(sizeof(T) <= 4, "Message IDs wider than 32 bits do not fit the wire header");
+                return uint32_t(static_cast<std::underlying_type_t<T>>(id));
+            }
+
+            // Write h to p, returns the header's length. nFlags may only carry
+            // feature bits
+            template <typename T>
+            size_t Encode(const message_header<T>& h, bool bCompact, uint8_t* p, uint8_t nFlags = 0)
+            {
+                uint32_t nId = IdValue(h.id);
+                p[0] = nVersion;
+
+                if(!bCompact)
+                {
+                    p[1] = nFlags & feature_mask;
+                    Put(p + 2, nId, 4);
+                    Put(p + 6, h.size, 4);
+                    return sizeof(header);
+                }
+
+                size_t nIdWidth = IdWidth(nId);
+                uint8_t nSizeCode = SizeCode(h.size);
+                p[1] = uint8_t((nFlags & feature_mask) | ((nIdWidth - 1) << 4) | (nSizeCode << 6));
+                Put(p + nPrefix, nId, nIdWidth);
+                Put(p + nPrefix + nIdWidth, h.size, SizeWidth(nSizeCode));
+                return nPrefix + nIdWidth + SizeWidth(nSizeCode);
+            }
+
+            // Read the header at p, which must hold Length(p) bytes. False if it is not
+            // a version we understand, uses a feature we don't, or has an ID that T
+            // can't hold
+            template <typename T>
+            bool Decode(const uint8_t* p, bool bCompact, message_header<T>& h, uint8_t* pFlags = nullptr)
+            {
+                if(p[0] != nVersion)
+                    return false;
+                //the full form has no field widths in the flags byte, so its top bits are unused too
+                const uint8_t nUnused = bCompact ? uint8_t(feature_mask & ~understood) : uint8_t(~understood);
+                if(p[1] & nUnused)
+                    return false;
+
+                uint32_t nId, nSize;
+                if(!bCompact)
+                {
+                    nId = uint32_t(Get(p + 2, 4));
+                    nSize = uint32_t(Get(p + 6, 4));
+                }
+                else
+                {
+                    size_t nIdWidth = ((p[1] >> 4) & 3) + 1;
+                    nId = uint32_t(Get(p + nPrefix, nIdWidth));
+                    nSize = uint32_t(Get(p + nPrefix + nIdWidth, SizeWidth(p[1] >> 6)));
+                }
+
+                //an ID cut down to fit would be some other message
+                const T id = static_cast<T>(static_cast<std::underlying_type_t<T>>(nId));
+                if(IdValue(id) != nId)
+                    return false;
+
+                h.id = id;
+                h.size = nSize;
+                if(pFlags)
+                    *pFlags = p[1] & feature_mask;
+                return true;
+            }
+        }
+    }
+}
@@ -5,4 +5,14 @@
 #include "net_client.h"
 #include "net_server.h"
 #include "net_tsqueue.h"
-#include "net_connection.h"
\ No newline at end of file
+#include "net_connection.h"
+#include "net_dispatcher.h"
+#include "net_wire.h"
+#include "net_crc.h"
+#include "net_tls.h"
+#include "net_ratelimit.h"
+#include "net_sendqueue.h"
+#include "net_topics.h"
+#include "net_groups.h"
+#include "net_interest.h"
+#include "net_snapshot.h"
\ No newline at end of file